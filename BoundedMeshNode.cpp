@@ -1,5 +0,0 @@
-#include "BoundedMeshNode.h"
-
-BoundedMeshNode::BoundedMeshNode()
-{
-}
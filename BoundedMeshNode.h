@@ -1,9 +0,0 @@
-#pragma once
-#include "MeshNode.h"
-class BoundedMeshNode :
-	public MeshNode
-{
-public:
-	BoundedMeshNode();
-};
-
@@ -1,5 +1,5 @@
 #pragma once
-#include "core.h"
+#include "Core.h"
 #include "DirectXCore.h"
 #include "SceneNode.h"
 #include "TerrainNode.h"
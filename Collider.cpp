@@ -1,11 +1,23 @@
 #include "Collider.h"
+#include <cmath>
 
 Collider::Collider(float height, float radius, XMFLOAT3 offset, bool pushable) :
-	height_(height),
+	pushable_(pushable),
 	radius_(radius),
+	height_(height),
 	offset_(offset),
-	pushable_(pushable)
+	worldPosition_(0.0f, 0.0f, 0.0f)
+{
+}
+
+void Collider::SetWorldPosition(XMFLOAT3 worldPosition)
 {
+	if (worldPosition.x == worldPosition_.x
+		&& worldPosition.y == worldPosition_.y
+		&& worldPosition.z == worldPosition_.z) return;
+
+	worldPosition_ = worldPosition;
+	moved_ = true;
 }
 
 bool Collider::IsIntersecting(const Collider& other, CollisionInfo& info) const
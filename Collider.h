@@ -1,7 +1,9 @@
 #pragma once
-#include "DirectXCore.h"
+#include <DirectXMath.h>
 #include <string>
 
+using namespace DirectX;
+
 struct CollisionInfo {
 	XMFLOAT3 offset;
 };
@@ -12,11 +14,19 @@ public:
 	Collider(float height, float radius, XMFLOAT3 offset, bool pushable);
 	bool IsIntersecting(const Collider& other, CollisionInfo& info) const;
 
-	inline void		SetWorldPosition(XMFLOAT3 worldPosition) { worldPosition_ = worldPosition; }
+	void			SetWorldPosition(XMFLOAT3 worldPosition);
 	XMFLOAT3		GetTopPoint() const;
 	XMFLOAT3		GetBottomPoint() const;
 	inline float	GetRadius() const { return radius_; }
+	inline float	GetHeight() const { return height_; }
+	inline XMFLOAT3	GetOffset() const { return offset_; }
 	inline bool		IsPushable() const { return pushable_; }
+
+	// spatial index bookkeeping
+	inline int		GetProxy() const { return proxy_; }
+	inline void		SetProxy(int proxy) { proxy_ = proxy; }
+	inline bool		HasMoved() const { return moved_; }
+	inline void		ClearMoved() { moved_ = false; }
 private:
 	float			GetDistance(XMFLOAT3 pointOne, XMFLOAT3 pointTwo) const;
 	bool			pushable_;
@@ -24,5 +34,7 @@ private:
 	float			height_;
 	XMFLOAT3		offset_;
 	XMFLOAT3		worldPosition_;
+	int				proxy_ = -1;
+	bool			moved_ = true;
 };
 
@@ -0,0 +1,140 @@
+#include "CollisionSystem.h"
+#include <algorithm>
+
+CollisionSystem::CollisionSystem()
+{
+	spatialIndex_ = std::make_shared<SpatialIndex>();
+}
+
+CollisionSystem::~CollisionSystem()
+{
+}
+
+bool CollisionSystem::ComparePairs(const ContactPair& a, const ContactPair& b)
+{
+	if (a.First != b.First) return a.First < b.First;
+	return a.Second < b.Second;
+}
+
+void CollisionSystem::Refit()
+{
+	spatialIndex_->Refit();
+}
+
+void CollisionSystem::Step()
+{
+	CollisionInfo info;
+
+	contacts_.clear();
+	currentPairs_.clear();
+
+	// only colliders attached to the scene are in the index, wherever
+	// they are in it
+	spatialIndex_->FindPairs(candidates_);
+
+	for (const SpatialPair& candidate : candidates_) {
+		Collider* currentCollider = candidate.FirstShape;
+		Collider* otherCollider = candidate.SecondShape;
+
+		bool collided = (currentCollider->IsIntersecting(*otherCollider, info));
+		if (!collided) continue;
+
+		SceneNodePointer current = candidate.First->shared_from_this();
+		SceneNodePointer other = candidate.Second->shared_from_this();
+
+		// if both are pushable, push each half as far
+		float offsetScale = (currentCollider->IsPushable() && otherCollider->IsPushable())
+			? 0.5f
+			: 1.0f;
+
+		if (currentCollider->IsPushable()) {
+			current->GetTransform()->Translate(XMFLOAT3(
+				info.offset.x * offsetScale,
+				info.offset.y * offsetScale,
+				info.offset.z * offsetScale
+			));
+		}
+
+		if (otherCollider->IsPushable()) {
+			other->GetTransform()->Translate(XMFLOAT3(
+				info.offset.x * -offsetScale,
+				info.offset.y * -offsetScale,
+				info.offset.z * -offsetScale
+			));
+		}
+
+		// store pairs in a stable order so we can match them up
+		// against last frame's pairs
+		ContactPair pair;
+		pair.First = (current < other) ? current : other;
+		pair.Second = (current < other) ? other : current;
+		pair.Offset = info.offset;
+		currentPairs_.push_back(pair);
+	}
+
+	std::sort(currentPairs_.begin(), currentPairs_.end(), ComparePairs);
+
+	// walk both sorted lists together to work out what started,
+	// what's still going and what has finished
+	size_t current = 0;
+	size_t previous = 0;
+
+	while (current < currentPairs_.size() || previous < previousPairs_.size()) {
+		ContactEvent contact;
+
+		if (previous >= previousPairs_.size()
+			|| (current < currentPairs_.size() && ComparePairs(currentPairs_[current], previousPairs_[previous]))) {
+			contact.Type = ContactType::Begin;
+			contact.First = currentPairs_[current].First;
+			contact.Second = currentPairs_[current].Second;
+			contact.Offset = currentPairs_[current].Offset;
+			current++;
+		}
+		else if (current >= currentPairs_.size()
+			|| ComparePairs(previousPairs_[previous], currentPairs_[current])) {
+			contact.Type = ContactType::End;
+			contact.First = previousPairs_[previous].First;
+			contact.Second = previousPairs_[previous].Second;
+			contact.Offset = XMFLOAT3(0.0f, 0.0f, 0.0f);
+			previous++;
+		}
+		else {
+			contact.Type = ContactType::Stay;
+			contact.First = currentPairs_[current].First;
+			contact.Second = currentPairs_[current].Second;
+			contact.Offset = currentPairs_[current].Offset;
+			current++;
+			previous++;
+		}
+
+		contacts_.push_back(contact);
+	}
+
+	// the current pairs become next step's history. swapping keeps
+	// both buffers' capacity, so steady state doesn't allocate.
+	std::swap(currentPairs_, previousPairs_);
+}
+
+void CollisionSystem::LogContacts(std::wostream& stream) const
+{
+	bool wroteAny = false;
+
+	for (const ContactEvent& contact : contacts_) {
+		switch (contact.Type) {
+		case ContactType::Begin:
+			stream << contact.First->GetName() << L" collided with " << contact.Second->GetName() << L"!\n";
+			wroteAny = true;
+			break;
+
+		case ContactType::End:
+			stream << contact.First->GetName() << L" stopped colliding with " << contact.Second->GetName() << L"\n";
+			wroteAny = true;
+			break;
+
+		default:
+			break;
+		}
+	}
+
+	if (wroteAny) stream.flush();
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include "SceneGraph.h"
+#include "SpatialIndex.h"
+#include <vector>
+#include <ostream>
+
+enum class ContactType {
+	Begin,
+	Stay,
+	End
+};
+
+// a single contact between two collidable nodes. events are
+// regenerated every step, so don't hold on to them between frames.
+struct ContactEvent {
+	ContactType			Type;
+	SceneNodePointer	First;
+	SceneNodePointer	Second;
+	XMFLOAT3			Offset;
+};
+
+class CollisionSystem
+{
+public:
+	CollisionSystem();
+	~CollisionSystem();
+
+	// resolve collisions between every collider in the scene, however
+	// deep in the graph, and fill the contact buffer. only pairs the
+	// spatial index says are close get tested.
+	void								Step();
+
+	// bring the spatial index up to date with where colliders ended up
+	// after the scene graph update
+	void								Refit();
+
+	const std::vector<ContactEvent>&	GetContacts() const { return contacts_; }
+
+	// overlap, raycast and nearest queries over every collider in the scene
+	inline std::shared_ptr<SpatialIndex>	GetSpatialIndex() { return spatialIndex_; }
+
+	// opt-in debug output. writes the begin/end events of the last step
+	// and flushes once, rather than once per contact.
+	void								LogContacts(std::wostream& stream) const;
+
+private:
+	struct ContactPair {
+		SceneNodePointer				First;
+		SceneNodePointer				Second;
+		XMFLOAT3						Offset;
+	};
+
+	static bool							ComparePairs(const ContactPair& a, const ContactPair& b);
+
+	std::shared_ptr<SpatialIndex>		spatialIndex_;
+
+	std::vector<SpatialPair>			candidates_;
+	std::vector<ContactEvent>			contacts_;
+	std::vector<ContactPair>			currentPairs_;
+	std::vector<ContactPair>			previousPairs_;
+};
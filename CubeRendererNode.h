@@ -11,7 +11,7 @@ public:
 	bool Initialise(void);
 	void Start();
 	void Render();
-	void Update(FXMMATRIX& currentWorldTransformation);
+	void Update();
 	void Shutdown();
 	void SetWorldTransform(FXMMATRIX& worldTransformation) { XMStoreFloat4x4(&worldTransformation_, worldTransformation); }
 private:
@@ -0,0 +1,282 @@
+#include "CullingSystem.h"
+#include "SceneGraph.h"
+#include "OcclusionBuffer.h"
+#include "GameConstants.h"
+#include <algorithm>
+
+CullingSystem::CullingSystem() :
+	framesSinceRefit_(0)
+{
+	// until the first cull, everything is in view
+	for (int p = 0; p < 6; p++) planes_[p] = XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+CullingSystem::~CullingSystem()
+{
+}
+
+CullHandle CullingSystem::Register(SceneNode* node, TransformHandle transform, const BoundingBox& localBounds)
+{
+	CullHandle handle;
+
+	if (freeHandles_.empty()) {
+		handle = (CullHandle)handleToSlot_.size();
+		handleToSlot_.push_back(-1);
+	}
+	else {
+		handle = freeHandles_.back();
+		freeHandles_.pop_back();
+	}
+
+	BoundingSphere localSphere;
+	BoundingSphere::CreateFromBoundingBox(localSphere, localBounds);
+
+	handleToSlot_[handle] = (int)nodes_.size();
+	slotToHandle_.push_back(handle);
+	nodes_.push_back(node);
+	transforms_.push_back(transform);
+	localBoxes_.push_back(localBounds);
+	localSpheres_.push_back(localSphere);
+
+	Resize(nodes_.size());
+
+	// visible until the first cull says otherwise, so anything that
+	// arrives between a cull and a render still gets drawn
+	visible_[nodes_.size() - 1] = 1;
+
+	if (transform != INVALID_TRANSFORM) {
+		if ((size_t)transform >= byTransform_.size()) byTransform_.resize(transform + 1, INVALID_CULL_HANDLE);
+		byTransform_[transform] = handle;
+	}
+
+	pending_.push_back(handle);
+
+	return handle;
+}
+
+void CullingSystem::Unregister(CullHandle handle)
+{
+	int slot = handleToSlot_[handle];
+	int last = (int)nodes_.size() - 1;
+
+	if (transforms_[slot] != INVALID_TRANSFORM) byTransform_[transforms_[slot]] = INVALID_CULL_HANDLE;
+
+	// the graphs above stop counting on us
+	nodes_[slot]->ClearWorldBounds();
+
+	if (slot != last) {
+		nodes_[slot] = nodes_[last];
+		transforms_[slot] = transforms_[last];
+		localBoxes_[slot] = localBoxes_[last];
+		localSpheres_[slot] = localSpheres_[last];
+		centreX_[slot] = centreX_[last];
+		centreY_[slot] = centreY_[last];
+		centreZ_[slot] = centreZ_[last];
+		radius_[slot] = radius_[last];
+		visible_[slot] = visible_[last];
+
+		slotToHandle_[slot] = slotToHandle_[last];
+		handleToSlot_[slotToHandle_[slot]] = slot;
+	}
+
+	nodes_.pop_back();
+	transforms_.pop_back();
+	localBoxes_.pop_back();
+	localSpheres_.pop_back();
+	slotToHandle_.pop_back();
+	Resize(nodes_.size());
+
+	handleToSlot_[handle] = -1;
+	freeHandles_.push_back(handle);
+}
+
+void CullingSystem::Resize(size_t count)
+{
+	size_t padded = PaddedCount(count);
+
+	// padding lanes are zero-sized spheres at the origin. whatever the
+	// kernel says about them is never read.
+	centreX_.resize(padded, 0.0f);
+	centreY_.resize(padded, 0.0f);
+	centreZ_.resize(padded, 0.0f);
+	radius_.resize(padded, 0.0f);
+	visible_.resize(padded, 0);
+}
+
+void CullingSystem::UpdateBounds(const std::vector<TransformHandle>& rebuilt)
+{
+	for (TransformHandle transform : rebuilt) {
+		if ((size_t)transform >= byTransform_.size()) continue;
+
+		CullHandle handle = byTransform_[transform];
+		if (handle != INVALID_CULL_HANDLE) UpdateEntry(handleToSlot_[handle]);
+	}
+
+	// new entries may not have moved this frame, but still need bounds.
+	// anything unregistered since has a slot of -1.
+	for (CullHandle handle : pending_) {
+		if (handleToSlot_[handle] != -1) UpdateEntry(handleToSlot_[handle]);
+	}
+	pending_.clear();
+
+	if (++framesSinceRefit_ >= BOUNDS_REFIT_INTERVAL) {
+		RefitLooseGraphs();
+		framesSinceRefit_ = 0;
+	}
+}
+
+void CullingSystem::UpdateEntry(int slot)
+{
+	XMMATRIX world = nodes_[slot]->GetCombinedWorldTransformation();
+
+	BoundingSphere sphere;
+	localSpheres_[slot].Transform(sphere, world);
+
+	centreX_[slot] = sphere.Center.x;
+	centreY_[slot] = sphere.Center.y;
+	centreZ_[slot] = sphere.Center.z;
+	radius_[slot] = sphere.Radius;
+
+	BoundingBox box;
+	localBoxes_[slot].Transform(box, world);
+	nodes_[slot]->SetWorldBounds(box);
+}
+
+void CullingSystem::AddLooseGraph(const std::shared_ptr<SceneGraph>& graph)
+{
+	looseGraphs_.push_back(graph);
+}
+
+void CullingSystem::RefitLooseGraphs()
+{
+	// children have to be refit before their parents, so sort by depth.
+	// anything the refits themselves loosen waits for the next round.
+	refitting_.clear();
+
+	for (auto&& loose : looseGraphs_) {
+		std::shared_ptr<SceneGraph> graph = loose.lock();
+		if (graph == nullptr) continue;
+
+		int depth = 0;
+		for (SceneNode* parent = graph->GetParent(); parent != nullptr; parent = parent->GetParent()) depth++;
+
+		refitting_.push_back({ depth, graph });
+	}
+	looseGraphs_.clear();
+
+	std::sort(refitting_.begin(), refitting_.end(), [](const std::pair<int, std::shared_ptr<SceneGraph>>& a, const std::pair<int, std::shared_ptr<SceneGraph>>& b) {
+		return a.first > b.first;
+	});
+
+	for (auto&& entry : refitting_) {
+		entry.second->RefitBounds();
+	}
+
+	refitting_.clear();
+}
+
+unsigned int CullingSystem::Cull(FXMMATRIX viewProjection)
+{
+	size_t count = nodes_.size();
+
+	if (!FRUSTUM_CULLING) {
+		for (size_t i = 0; i < count; i++) visible_[i] = 1;
+		return (unsigned int)count;
+	}
+
+	// pull the planes out of the combined matrix. its columns are easier
+	// to get at as the rows of the transpose.
+	XMMATRIX columns = XMMatrixTranspose(viewProjection);
+
+	XMVECTOR planes[6] = {
+		columns.r[3] + columns.r[0],	// left
+		columns.r[3] - columns.r[0],	// right
+		columns.r[3] + columns.r[1],	// bottom
+		columns.r[3] - columns.r[1],	// top
+		columns.r[2],					// near
+		columns.r[3] - columns.r[2]		// far
+	};
+
+	// splat each plane out so every lane tests against the same one
+	XMVECTOR planeX[6], planeY[6], planeZ[6], planeW[6];
+
+	for (int p = 0; p < 6; p++) {
+		XMVECTOR plane = XMPlaneNormalize(planes[p]);
+		XMStoreFloat4(&planes_[p], plane);
+
+		planeX[p] = XMVectorSplatX(plane);
+		planeY[p] = XMVectorSplatY(plane);
+		planeZ[p] = XMVectorSplatZ(plane);
+		planeW[p] = XMVectorSplatW(plane);
+	}
+
+	size_t padded = PaddedCount(count);
+
+	for (size_t i = 0; i < padded; i += 4) {
+		XMVECTOR x = XMLoadFloat4((const XMFLOAT4*)&centreX_[i]);
+		XMVECTOR y = XMLoadFloat4((const XMFLOAT4*)&centreY_[i]);
+		XMVECTOR z = XMLoadFloat4((const XMFLOAT4*)&centreZ_[i]);
+		XMVECTOR negativeRadius = XMVectorNegate(XMLoadFloat4((const XMFLOAT4*)&radius_[i]));
+
+		// a sphere is out once its centre is further than its radius
+		// behind any one plane
+		XMVECTOR inside = XMVectorTrueInt();
+
+		for (int p = 0; p < 6; p++) {
+			XMVECTOR distance = XMVectorMultiplyAdd(planeX[p], x,
+								XMVectorMultiplyAdd(planeY[p], y,
+								XMVectorMultiplyAdd(planeZ[p], z, planeW[p])));
+
+			inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(distance, negativeRadius));
+		}
+
+		XMUINT4 mask;
+		XMStoreUInt4(&mask, inside);
+
+		visible_[i] = mask.x != 0;
+		visible_[i + 1] = mask.y != 0;
+		visible_[i + 2] = mask.z != 0;
+		visible_[i + 3] = mask.w != 0;
+	}
+
+	unsigned int visibleCount = 0;
+	for (size_t i = 0; i < count; i++) visibleCount += visible_[i];
+
+	return visibleCount;
+}
+
+unsigned int CullingSystem::Occlude(OcclusionBuffer& occlusion)
+{
+	unsigned int occluded = 0;
+
+	for (size_t i = 0; i < nodes_.size(); i++) {
+		if (!visible_[i] || !nodes_[i]->IsBounded()) continue;
+
+		if (occlusion.IsOccluded(nodes_[i]->GetWorldBounds())) {
+			visible_[i] = 0;
+			occluded++;
+		}
+	}
+
+	return occluded;
+}
+
+bool CullingSystem::IsVisible(const BoundingBox& bounds) const
+{
+	if (!FRUSTUM_CULLING) return true;
+
+	XMVECTOR centre = XMLoadFloat3(&bounds.Center);
+	XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+
+	for (int p = 0; p < 6; p++) {
+		XMVECTOR plane = XMLoadFloat4(&planes_[p]);
+
+		// how far the box reaches towards the plane's normal
+		float reach = XMVectorGetX(XMVector3Dot(extents, XMVectorAbs(plane)));
+		float distance = XMVectorGetX(XMPlaneDotCoord(plane, centre));
+
+		if (distance + reach < 0.0f) return false;
+	}
+
+	return true;
+}
@@ -0,0 +1,99 @@
+#pragma once
+#include "DirectXCore.h"
+#include "TransformHierarchy.h"
+#include <vector>
+#include <memory>
+
+class SceneNode;
+class SceneGraph;
+class OcclusionBuffer;
+
+// A handle to a renderable registered for culling. Handles stay valid
+// while the entries behind them get moved around.
+typedef int CullHandle;
+
+const CullHandle INVALID_CULL_HANDLE = -1;
+
+// View-frustum culling for everything that has bounds. Each renderable
+// hands over its model-space bounds once, they're moved into world space
+// after the transform hierarchy update, and the cull pass tests their
+// spheres four at a time against the six frustum planes. The
+// world spheres are kept as separate x, y, z and radius arrays so each
+// lane of a vector holds a different sphere.
+//
+// Only entries whose world matrix was rebuilt get their bounds redone,
+// and each one pushes its new box up into the subtree bounds of the
+// graphs above it. Graphs left with boxes bigger than they need are
+// refit every BOUNDS_REFIT_INTERVAL frames, deepest first.
+
+class CullingSystem
+{
+public:
+	CullingSystem();
+	~CullingSystem();
+
+	// transform is the node's entry in the transform hierarchy, which
+	// tells us when its bounds need moving
+	CullHandle				Register(SceneNode* node, TransformHandle transform, const BoundingBox& localBounds);
+	void					Unregister(CullHandle handle);
+
+	// move the bounds of everything that moved, and of anything new,
+	// into world space. call once world matrices are up to date.
+	void					UpdateBounds(const std::vector<TransformHandle>& rebuilt);
+
+	// a graph whose subtree bounds want refitting
+	void					AddLooseGraph(const std::shared_ptr<SceneGraph>& graph);
+
+	// work out what's visible from the given camera. returns how many
+	// entries survived.
+	unsigned int			Cull(FXMMATRIX viewProjection);
+
+	inline bool				IsVisible(CullHandle handle) const { return visible_[handleToSlot_[handle]] != 0; }
+
+	// against the frustum of the last cull
+	bool					IsVisible(const BoundingBox& bounds) const;
+
+	// test everything that survived the frustum cull against the
+	// occluders. returns how many more were hidden.
+	unsigned int			Occlude(OcclusionBuffer& occlusion);
+
+	inline size_t			GetCount() const { return nodes_.size(); }
+
+private:
+	// the padded length of the world arrays, so the kernel never has to
+	// deal with a partial vector
+	static size_t			PaddedCount(size_t count) { return (count + 3) & ~(size_t)3; }
+
+	void					Resize(size_t count);
+	void					UpdateEntry(int slot);
+	void					RefitLooseGraphs();
+
+	std::vector<SceneNode*>			nodes_;
+	std::vector<TransformHandle>	transforms_;
+	std::vector<BoundingBox>		localBoxes_;
+	std::vector<BoundingSphere>		localSpheres_;
+
+	std::vector<float>				centreX_;
+	std::vector<float>				centreY_;
+	std::vector<float>				centreZ_;
+	std::vector<float>				radius_;
+	std::vector<unsigned char>		visible_;
+
+	// entries are kept packed, so removing one moves the last entry into
+	// its slot
+	std::vector<int>				handleToSlot_;
+	std::vector<CullHandle>			slotToHandle_;
+	std::vector<CullHandle>			freeHandles_;
+
+	// by transform handle, so rebuilt matrices can find their entry
+	std::vector<CullHandle>			byTransform_;
+
+	// registered since the last bounds update
+	std::vector<CullHandle>			pending_;
+
+	std::vector<std::weak_ptr<SceneGraph>>	looseGraphs_;
+	std::vector<std::pair<int, std::shared_ptr<SceneGraph>>>	refitting_;
+	unsigned int					framesSinceRefit_;
+
+	XMFLOAT4						planes_[6];
+};
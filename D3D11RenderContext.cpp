@@ -0,0 +1,296 @@
+#include "D3D11RenderContext.h"
+#include "GameConstants.h"
+#include <cstring>
+
+// constant buffer offsets have to be a multiple of 16 constants
+const UINT CONSTANT_RING_ALIGNMENT = 256;
+const UINT INSTANCE_RING_ALIGNMENT = 16;
+
+D3D11RenderContext::D3D11RenderContext(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext) :
+	device_(device),
+	deviceContext_(deviceContext),
+	frame_(0),
+	constantOffsets_(false)
+{
+	// binding constant buffers by offset, and writing to them without
+	// discarding, are both 11.1 features
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+	ZeroMemory(&options, sizeof(options));
+
+	if (SUCCEEDED(deviceContext_.As(&deviceContext1_)) &&
+		SUCCEEDED(device_->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+	{
+		constantOffsets_ = options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+	}
+
+	CreateRing(instanceRing_, D3D11_BIND_VERTEX_BUFFER, INSTANCE_RING_SIZE);
+
+	if (constantOffsets_) {
+		CreateRing(constantRing_, D3D11_BIND_CONSTANT_BUFFER, CONSTANT_RING_SIZE);
+		return;
+	}
+
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = CONSTANT_RING_ALIGNMENT;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	ThrowIfFailed(device_->CreateBuffer(&bufferDesc, nullptr, constantFallback_.GetAddressOf()));
+}
+
+D3D11RenderContext::~D3D11RenderContext()
+{
+}
+
+void D3D11RenderContext::SetVertexShader(ID3D11VertexShader* shader)
+{
+	deviceContext_->VSSetShader(shader, 0, 0);
+}
+
+void D3D11RenderContext::SetPixelShader(ID3D11PixelShader* shader)
+{
+	deviceContext_->PSSetShader(shader, 0, 0);
+}
+
+void D3D11RenderContext::SetInputLayout(ID3D11InputLayout* layout)
+{
+	deviceContext_->IASetInputLayout(layout);
+}
+
+void D3D11RenderContext::SetBlendState(ID3D11BlendState* state)
+{
+	float blendFactors[] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	deviceContext_->OMSetBlendState(state, blendFactors, 0xffffffff);
+}
+
+void D3D11RenderContext::SetRasteriserState(ID3D11RasterizerState* state)
+{
+	deviceContext_->RSSetState(state);
+}
+
+void D3D11RenderContext::SetDepthStencilState(ID3D11DepthStencilState* state)
+{
+	deviceContext_->OMSetDepthStencilState(state, 1);
+}
+
+void D3D11RenderContext::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	D3D11_PRIMITIVE_TOPOLOGY d3dTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST;
+
+	switch (topology) {
+	case PrimitiveTopology::TriangleList:	d3dTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST; break;
+	case PrimitiveTopology::TriangleStrip:	d3dTopology = D3D11_PRIMITIVE_TOPOLOGY_TRIANGLESTRIP; break;
+	case PrimitiveTopology::LineList:		d3dTopology = D3D11_PRIMITIVE_TOPOLOGY_LINELIST; break;
+	}
+
+	deviceContext_->IASetPrimitiveTopology(d3dTopology);
+}
+
+void D3D11RenderContext::SetVertexBuffer(ID3D11Buffer* buffer, UINT stride)
+{
+	UINT offset = 0;
+	deviceContext_->IASetVertexBuffers(0, 1, &buffer, &stride, &offset);
+}
+
+void D3D11RenderContext::SetIndexBuffer(ID3D11Buffer* buffer)
+{
+	deviceContext_->IASetIndexBuffer(buffer, DXGI_FORMAT_R32_UINT, 0);
+}
+
+void D3D11RenderContext::SetVSConstantBuffer(UINT slot, ID3D11Buffer* buffer)
+{
+	deviceContext_->VSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void D3D11RenderContext::SetPSConstantBuffer(UINT slot, ID3D11Buffer* buffer)
+{
+	deviceContext_->PSSetConstantBuffers(slot, 1, &buffer);
+}
+
+void D3D11RenderContext::SetPSResource(UINT slot, ID3D11ShaderResourceView* view)
+{
+	deviceContext_->PSSetShaderResources(slot, 1, &view);
+}
+
+void D3D11RenderContext::SetVSConstantRange(UINT slot, const ConstantRange& range)
+{
+	if (constantOffsets_)	deviceContext1_->VSSetConstantBuffers1(slot, 1, &range.Buffer, &range.FirstConstant, &range.ConstantCount);
+	else					deviceContext_->VSSetConstantBuffers(slot, 1, &range.Buffer);
+}
+
+void D3D11RenderContext::UpdateBuffer(ID3D11Buffer* buffer, const void* data, UINT size)
+{
+	deviceContext_->UpdateSubresource(buffer, 0, 0, data, 0, 0);
+}
+
+ConstantRange D3D11RenderContext::UploadConstants(const void* data, UINT size)
+{
+	UINT alignedSize = (size + CONSTANT_RING_ALIGNMENT - 1) & ~(CONSTANT_RING_ALIGNMENT - 1);
+
+	if (!constantOffsets_) {
+		// one small buffer, renamed by the driver on every upload
+		if (alignedSize > CONSTANT_RING_ALIGNMENT) throw std::exception();
+
+		D3D11_MAPPED_SUBRESOURCE mapped;
+		ThrowIfFailed(deviceContext_->Map(constantFallback_.Get(), 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped));
+		memcpy(mapped.pData, data, size);
+		deviceContext_->Unmap(constantFallback_.Get(), 0);
+
+		ConstantRange range = { constantFallback_.Get(), 0, alignedSize / 16 };
+		return range;
+	}
+
+	UINT offset = Upload(constantRing_, data, size, CONSTANT_RING_ALIGNMENT);
+
+	ConstantRange range = { constantRing_.Buffer.Get(), offset / 16, alignedSize / 16 };
+	return range;
+}
+
+void D3D11RenderContext::SetInstanceData(const void* data, UINT stride, UINT count)
+{
+	UINT size = stride * count;
+	if (size == 0) return;
+
+	UINT offset = Upload(instanceRing_, data, size, INSTANCE_RING_ALIGNMENT);
+	deviceContext_->IASetVertexBuffers(1, 1, instanceRing_.Buffer.GetAddressOf(), &stride, &offset);
+}
+
+void D3D11RenderContext::DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex)
+{
+	deviceContext_->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void D3D11RenderContext::DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance)
+{
+	deviceContext_->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void D3D11RenderContext::BeginFrame()
+{
+	frame_++;
+
+	// take back whatever the GPU has finished with, without waiting for
+	// anything it hasn't
+	while (!fences_.empty() && deviceContext_->GetData(fences_.front().Query.Get(), nullptr, 0, D3D11_ASYNC_GETDATA_DONOTFLUSH) == S_OK) {
+		RetireOldestFrame();
+	}
+
+	constantRing_.Ring.BeginFrame(frame_);
+	instanceRing_.Ring.BeginFrame(frame_);
+}
+
+void D3D11RenderContext::EndFrame()
+{
+	constantRing_.Ring.EndFrame();
+	instanceRing_.Ring.EndFrame();
+
+	FrameFence fence;
+	fence.Frame = frame_;
+
+	if (spareQueries_.empty()) {
+		D3D11_QUERY_DESC queryDesc;
+		ZeroMemory(&queryDesc, sizeof(queryDesc));
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		ThrowIfFailed(device_->CreateQuery(&queryDesc, fence.Query.GetAddressOf()));
+	}
+	else {
+		fence.Query = spareQueries_.back();
+		spareQueries_.pop_back();
+	}
+
+	// signalled once the GPU has got through everything before it
+	deviceContext_->End(fence.Query.Get());
+	fences_.push_back(fence);
+}
+
+UploadStats D3D11RenderContext::GetUploadStats() const
+{
+	const UploadStats& constants = constantRing_.Ring.GetStats();
+	const UploadStats& instances = instanceRing_.Ring.GetStats();
+
+	UploadStats stats;
+	stats.Capacity = constants.Capacity + instances.Capacity;
+	stats.HighWater = constants.HighWater + instances.HighWater;
+	stats.Stalls = constants.Stalls + instances.Stalls;
+	stats.Overflows = constants.Overflows + instances.Overflows;
+	return stats;
+}
+
+void D3D11RenderContext::CreateRing(DynamicRing& ring, UINT bindFlags, UINT size)
+{
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.ByteWidth = size;
+	bufferDesc.BindFlags = bindFlags;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+
+	ring.Buffer = nullptr;
+	ThrowIfFailed(device_->CreateBuffer(&bufferDesc, nullptr, ring.Buffer.GetAddressOf()));
+
+	ring.BindFlags = bindFlags;
+	ring.Discard = true;
+	ring.Ring.Resize(size);
+	ring.Ring.BeginFrame(frame_);
+}
+
+UINT D3D11RenderContext::Upload(DynamicRing& ring, const void* data, UINT size, UINT alignment)
+{
+	// too big for the ring at all, so it needs a bigger one. anything the
+	// GPU is still reading keeps the old buffer alive until it's done.
+	if (size > ring.Ring.GetCapacity()) {
+		UINT newSize = (UINT)ring.Ring.GetCapacity();
+		while (newSize < size) newSize *= 2;
+
+		CreateRing(ring, ring.BindFlags, newSize);
+	}
+
+	size_t offset;
+
+	while ((offset = ring.Ring.Allocate(size, alignment)) == UPLOAD_RING_FULL) {
+		if (ring.Ring.HasPending()) {
+			WaitForFrame(ring.Ring.GetOldestPending());
+			continue;
+		}
+
+		// this frame has filled the ring on its own. starting over with a
+		// discard leaves what it's written so far with the driver.
+		ring.Ring.Reset();
+		ring.Discard = true;
+	}
+
+	// until the buffer's been discarded once, there's nothing to avoid
+	// overwriting
+	D3D11_MAP mapType = ring.Discard ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE;
+	ring.Discard = false;
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+	ThrowIfFailed(deviceContext_->Map(ring.Buffer.Get(), 0, mapType, 0, &mapped));
+	memcpy((char*)mapped.pData + offset, data, size);
+	deviceContext_->Unmap(ring.Buffer.Get(), 0);
+
+	return (UINT)offset;
+}
+
+void D3D11RenderContext::WaitForFrame(unsigned long long frame)
+{
+	while (!fences_.empty() && fences_.front().Frame <= frame) {
+		// flushing, so the GPU is actually heading towards the fence
+		while (deviceContext_->GetData(fences_.front().Query.Get(), nullptr, 0, 0) == S_FALSE) {
+		}
+
+		RetireOldestFrame();
+	}
+}
+
+void D3D11RenderContext::RetireOldestFrame()
+{
+	FrameFence& fence = fences_.front();
+
+	constantRing_.Ring.Retire(fence.Frame);
+	instanceRing_.Ring.Retire(fence.Frame);
+
+	spareQueries_.push_back(fence.Query);
+	fences_.pop_front();
+}
@@ -0,0 +1,93 @@
+#pragma once
+#include "Core.h"
+#include "DirectXCore.h"
+#include "RenderContext.h"
+#include "UploadRing.h"
+#include <d3d11_1.h>
+#include <deque>
+#include <vector>
+
+// Passes everything straight through to a device context.
+//
+// Uploaded constants and instance data are written into two dynamic
+// buffers, each shared out by an upload ring. The end of every frame is
+// marked with an event query, and a frame's part of a ring is only
+// written over again once its query has come back. Binding constants by
+// offset needs Direct3D 11.1. Without it, every upload gets a small
+// buffer discarded and rewritten to itself.
+
+class D3D11RenderContext : public RenderContext
+{
+public:
+	D3D11RenderContext(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext);
+	~D3D11RenderContext();
+
+	void				SetVertexShader(ID3D11VertexShader* shader);
+	void				SetPixelShader(ID3D11PixelShader* shader);
+	void				SetInputLayout(ID3D11InputLayout* layout);
+
+	void				SetBlendState(ID3D11BlendState* state);
+	void				SetRasteriserState(ID3D11RasterizerState* state);
+	void				SetDepthStencilState(ID3D11DepthStencilState* state);
+
+	void				SetPrimitiveTopology(PrimitiveTopology topology);
+	void				SetVertexBuffer(ID3D11Buffer* buffer, UINT stride);
+	void				SetIndexBuffer(ID3D11Buffer* buffer);
+
+	void				SetVSConstantBuffer(UINT slot, ID3D11Buffer* buffer);
+	void				SetPSConstantBuffer(UINT slot, ID3D11Buffer* buffer);
+	void				SetPSResource(UINT slot, ID3D11ShaderResourceView* view);
+	void				SetVSConstantRange(UINT slot, const ConstantRange& range);
+
+	void				UpdateBuffer(ID3D11Buffer* buffer, const void* data, UINT size);
+	ConstantRange		UploadConstants(const void* data, UINT size);
+
+	void				SetInstanceData(const void* data, UINT stride, UINT count);
+
+	void				DrawIndexed(UINT indexCount, UINT startIndex, INT baseVertex);
+	void				DrawIndexedInstanced(UINT indexCount, UINT instanceCount, UINT startIndex, INT baseVertex, UINT startInstance);
+
+	void				BeginFrame();
+	void				EndFrame();
+	UploadStats			GetUploadStats() const;
+
+private:
+	// a dynamic buffer, and the ring that shares it out
+	struct DynamicRing {
+		ComPtr<ID3D11Buffer>	Buffer;
+		UploadRing				Ring;
+		UINT					BindFlags;
+		bool					Discard;		// map with DISCARD next time
+	};
+
+	// an event query marking the end of a frame
+	struct FrameFence {
+		unsigned long long		Frame;
+		ComPtr<ID3D11Query>		Query;
+	};
+
+	void				CreateRing(DynamicRing& ring, UINT bindFlags, UINT size);
+
+	// copy data into the ring, waiting on the GPU if there's no room,
+	// and return where it went
+	UINT				Upload(DynamicRing& ring, const void* data, UINT size, UINT alignment);
+
+	// block until the GPU is done with frame, and retire it
+	void				WaitForFrame(unsigned long long frame);
+	void				RetireOldestFrame();
+
+	ComPtr<ID3D11Device>			device_;
+	ComPtr<ID3D11DeviceContext>		deviceContext_;
+
+	unsigned long long				frame_;
+	std::deque<FrameFence>			fences_;
+	std::vector<ComPtr<ID3D11Query>>	spareQueries_;
+
+	DynamicRing						constantRing_;
+	DynamicRing						instanceRing_;
+
+	// used instead of the constant ring when we can't bind by offset
+	ComPtr<ID3D11DeviceContext1>	deviceContext1_;
+	ComPtr<ID3D11Buffer>			constantFallback_;
+	bool							constantOffsets_;
+};
@@ -1,4 +1,5 @@
 #include "DirectXFramework.h"
+#include "D3D11RenderContext.h"
 
 // DirectX libraries that are needed
 #pragma comment(lib, "d3d11.lib")
@@ -65,6 +66,15 @@ bool DirectXFramework::Initialise()
 	resourceManager_	= std::make_shared<ResourceManager>();
 	camera_				= std::make_shared<Camera>();
 	lighting_			= std::make_shared<Lighting>();
+	collisionSystem_	= std::make_shared<CollisionSystem>();
+	transformHierarchy_	= std::make_shared<TransformHierarchy>();
+	jobSystem_			= std::make_shared<JobSystem>();
+	entityStore_		= std::make_shared<EntityStore>();
+	sceneCommands_		= std::make_shared<SceneCommandBuffer>();
+	cullingSystem_		= std::make_shared<CullingSystem>();
+	occlusionBuffer_	= std::make_shared<OcclusionBuffer>(OCCLUSION_WIDTH, OCCLUSION_HEIGHT);
+	renderQueue_		= std::make_shared<RenderQueue>(RENDER_SORT_DEPTH);
+	renderContext_		= std::make_shared<StateCache>(std::make_shared<D3D11RenderContext>(device_, deviceContext_));
 
 	CreateSceneGraph();
 	return sceneGraph_->Initialise();
@@ -83,9 +93,45 @@ void DirectXFramework::Shutdown()
 
 void DirectXFramework::Update()
 {
+	frameStats_.Reset();
+
+	// anything queued for the main thread since last frame
+	jobSystem_->PumpMainThread();
+
 	UpdateSceneGraph();
 	camera_->Update();
-	sceneGraph_->Update(XMMatrixIdentity());
+	sceneGraph_->Update();
+
+	// nothing is walking the graph now, so structural changes are safe
+	sceneCommands_->Apply();
+
+	frameStats_.WorldMatricesRebuilt = transformHierarchy_->Update();
+	cullingSystem_->UpdateBounds(transformHierarchy_->GetRebuilt());
+
+	// work out what the camera can see. done here rather than in Render
+	// so that headless runs go through it too.
+	XMMATRIX viewProjection = camera_->GetViewMatrix() * GetProjectionTransformation();
+	unsigned int visible = cullingSystem_->Cull(viewProjection);
+	frameStats_.CulledCount = (unsigned int)cullingSystem_->GetCount() - visible;
+
+	if (OCCLUSION_CULLING) {
+		occlusionBuffer_->Begin(viewProjection, *cullingSystem_);
+		frameStats_.OccludedCount = cullingSystem_->Occlude(*occlusionBuffer_);
+		occlusionBuffer_->End();
+
+		frameStats_.OcclusionMilliseconds = occlusionBuffer_->GetMilliseconds();
+		visible -= frameStats_.OccludedCount;
+	}
+
+	frameStats_.VisibleCount = visible;
+
+	// entities still backed by scene nodes pick up where their nodes ended
+	// up, then the systems bring the rest of the store along
+	SyncSceneNodes(*entityStore_);
+	UpdatePlayerControllers(*entityStore_, camera_->GetYaw());
+	UpdateTransforms(*entityStore_);
+	UpdateColliders(*entityStore_);
+	collisionSystem_->Refit();
 }
 
 void DirectXFramework::Render()
@@ -94,8 +140,34 @@ void DirectXFramework::Render()
 	deviceContext_->ClearRenderTargetView(renderTargetView_.Get(), backgroundColour_);
 	deviceContext_->ClearDepthStencilView(depthStencilView_.Get(), D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
 
-	// render the scene graph
+	// anything initialised since the last frame will have set state
+	// behind the cache's back
+	renderContext_->Invalidate();
+	renderContext_->ResetCounters();
+	renderContext_->BeginFrame();
+
+	// render the scene graph. mesh nodes only queue their draws, so make
+	// those afterwards, in whatever order changes the least state.
+	renderQueue_->Begin(camera_->GetViewMatrix());
 	sceneGraph_->Render();
+	renderQueue_->Submit(*renderContext_);
+	renderContext_->EndFrame();
+
+	frameStats_.DrawItems = (unsigned int)renderQueue_->GetSubmittedCount();
+	frameStats_.InstancesDrawn = (unsigned int)renderQueue_->GetInstanceCount();
+	frameStats_.InstanceGroups = (unsigned int)renderQueue_->GetInstanceGroupCount();
+	frameStats_.TrianglesDrawn = renderQueue_->GetTriangleCount();
+	frameStats_.StateCallsIssued = renderContext_->GetIssued();
+	frameStats_.StateCallsSkipped = renderContext_->GetSkipped();
+	frameStats_.UploadBytes = renderContext_->GetUploadedBytes();
+
+	UploadStats upload = renderContext_->GetUploadStats();
+	frameStats_.UploadHighWater = upload.HighWater;
+	frameStats_.UploadStalls = upload.Stalls;
+	frameStats_.UploadOverflows = upload.Overflows;
+
+	totalStats_.Add(frameStats_);
+	renderedFrames_++;
 
 	// present the scene to the window
 	HRESULT result = swapChain_->Present(0, 0);
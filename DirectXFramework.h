@@ -8,6 +8,16 @@
 #include "GameConstants.h"
 #include "SceneGraph.h"
 #include "Lighting.h"
+#include "CollisionSystem.h"
+#include "FrameStats.h"
+#include "TransformHierarchy.h"
+#include "JobSystem.h"
+#include "EntityStore.h"
+#include "SceneCommandBuffer.h"
+#include "CullingSystem.h"
+#include "OcclusionBuffer.h"
+#include "StateCache.h"
+#include "RenderQueue.h"
 
 class DirectXFramework : public Framework
 {
@@ -31,6 +41,18 @@ public:
 	inline std::shared_ptr<Camera>			GetCamera() { return camera_; }
 	inline std::shared_ptr<ResourceManager>	GetResourceManager() { return resourceManager_; }
 	inline std::shared_ptr<Lighting>		GetLighting() { return lighting_; }
+	inline std::shared_ptr<CollisionSystem>	GetCollisionSystem() { return collisionSystem_; }
+	inline std::shared_ptr<TransformHierarchy>	GetTransformHierarchy() { return transformHierarchy_; }
+	inline FrameStats&						GetFrameStats() { return frameStats_; }
+	inline const FrameStats&				GetTotalStats() { return totalStats_; }
+	inline unsigned int						GetRenderedFrames() { return renderedFrames_; }
+	inline std::shared_ptr<JobSystem>		GetJobSystem() { return jobSystem_; }
+	inline std::shared_ptr<EntityStore>		GetEntityStore() { return entityStore_; }
+	inline std::shared_ptr<SceneCommandBuffer>	GetSceneCommands() { return sceneCommands_; }
+	inline std::shared_ptr<CullingSystem>	GetCullingSystem() { return cullingSystem_; }
+	inline std::shared_ptr<OcclusionBuffer>	GetOcclusionBuffer() { return occlusionBuffer_; }
+	inline std::shared_ptr<RenderQueue>		GetRenderQueue() { return renderQueue_; }
+	inline std::shared_ptr<RenderContext>	GetRenderContext() { return renderContext_; }
 	inline ComPtr<ID3D11Device>				GetDevice() { return device_; }
 	inline ComPtr<ID3D11DeviceContext>		GetDeviceContext() { return deviceContext_; }
 
@@ -54,6 +76,20 @@ private:
 	std::shared_ptr<ResourceManager>		resourceManager_;
 	std::shared_ptr<Camera>					camera_;
 	std::shared_ptr<Lighting>				lighting_;
+	std::shared_ptr<CollisionSystem>		collisionSystem_;
+	std::shared_ptr<TransformHierarchy>		transformHierarchy_;
+	std::shared_ptr<JobSystem>				jobSystem_;
+	std::shared_ptr<EntityStore>			entityStore_;
+	std::shared_ptr<SceneCommandBuffer>		sceneCommands_;
+	std::shared_ptr<CullingSystem>			cullingSystem_;
+	std::shared_ptr<OcclusionBuffer>		occlusionBuffer_;
+	std::shared_ptr<RenderQueue>			renderQueue_;
+	std::shared_ptr<StateCache>				renderContext_;
+	FrameStats								frameStats_;
+
+	// every rendered frame's stats added together
+	FrameStats								totalStats_;
+	unsigned int							renderedFrames_ = 0;
 
 	float									backgroundColour_[4];
 
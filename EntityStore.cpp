@@ -0,0 +1,259 @@
+#include "EntityStore.h"
+#include "SceneNode.h"
+#include "MeshNode.h"
+#include "PlayerNode.h"
+
+EntityStore::EntityStore() :
+	entityCount_(0)
+{
+	// the empty archetype always exists, so new entities have somewhere to go
+	GetArchetype(0);
+}
+
+EntityStore::~EntityStore()
+{
+	for (auto&& archetype : archetypes_) {
+		delete archetype;
+	}
+}
+
+Entity EntityStore::Create()
+{
+	Entity entity;
+
+	if (freeIndices_.empty()) {
+		entity.Index = (unsigned int)records_.size();
+		records_.push_back({ 0, -1, 0 });
+	}
+	else {
+		entity.Index = freeIndices_.back();
+		freeIndices_.pop_back();
+	}
+
+	EntityRecord& record = records_[entity.Index];
+	entity.Generation = record.Generation;
+
+	Archetype* empty = archetypes_[0];
+	record.Archetype = 0;
+	record.Row = empty->Entities.size();
+	empty->Entities.push_back(entity);
+
+	entityCount_++;
+	return entity;
+}
+
+void EntityStore::Destroy(Entity entity)
+{
+	if (!IsAlive(entity)) return;
+
+	EntityRecord& record = records_[entity.Index];
+	RemoveRow(record.Archetype, record.Row);
+
+	// bumping the generation invalidates any handles still out there
+	record.Generation++;
+	record.Archetype = -1;
+	freeIndices_.push_back(entity.Index);
+
+	entityCount_--;
+}
+
+bool EntityStore::IsAlive(Entity entity) const
+{
+	return entity.Index < records_.size()
+		&& records_[entity.Index].Generation == entity.Generation
+		&& records_[entity.Index].Archetype != -1;
+}
+
+int EntityStore::GetArchetype(ComponentMask mask)
+{
+	auto found = archetypeLookup_.find(mask);
+	if (found != archetypeLookup_.end()) return found->second;
+
+	Archetype* archetype = new Archetype();
+	archetype->Mask = mask;
+
+	int index = (int)archetypes_.size();
+	archetypes_.push_back(archetype);
+	archetypeLookup_[mask] = index;
+
+	return index;
+}
+
+void EntityStore::MoveEntity(Entity entity, int target)
+{
+	EntityRecord& record = records_[entity.Index];
+	Archetype& from = *archetypes_[record.Archetype];
+	Archetype& to = *archetypes_[target];
+
+	CopyComponent<TransformComponent>(from, record.Row, to);
+	CopyComponent<ColliderComponent>(from, record.Row, to);
+	CopyComponent<MeshComponent>(from, record.Row, to);
+	CopyComponent<PlayerControllerComponent>(from, record.Row, to);
+	CopyComponent<SceneNodeComponent>(from, record.Row, to);
+
+	RemoveRow(record.Archetype, record.Row);
+
+	record.Archetype = target;
+	record.Row = to.Entities.size();
+	to.Entities.push_back(entity);
+}
+
+void EntityStore::RemoveRow(int archetypeIndex, size_t row)
+{
+	Archetype& archetype = *archetypes_[archetypeIndex];
+
+	RemoveComponent<TransformComponent>(archetype, row);
+	RemoveComponent<ColliderComponent>(archetype, row);
+	RemoveComponent<MeshComponent>(archetype, row);
+	RemoveComponent<PlayerControllerComponent>(archetype, row);
+	RemoveComponent<SceneNodeComponent>(archetype, row);
+
+	// the last entity got swapped into our row
+	Entity moved = archetype.Entities.back();
+	archetype.Entities[row] = moved;
+	archetype.Entities.pop_back();
+
+	if (row < archetype.Entities.size()) records_[moved.Index].Row = row;
+}
+
+// === systems === //
+
+void SyncSceneNodes(EntityStore& store)
+{
+	store.Each<SceneNodeComponent, TransformComponent>([](size_t count, const Entity* entities, SceneNodeComponent* nodes, TransformComponent* transforms) {
+		for (size_t i = 0; i < count; i++) {
+			SceneNode* node = nodes[i].Node;
+			std::shared_ptr<Transform> transform = node->GetTransform();
+
+			XMStoreFloat3(&transforms[i].Position, transform->GetPosition());
+			XMStoreFloat4(&transforms[i].Rotation, transform->GetRotation());
+			XMStoreFloat3(&transforms[i].Scale, transform->GetScale());
+
+			// the node's matrix includes its parents', which ours can't
+			XMStoreFloat4x4(&transforms[i].World, node->GetCombinedWorldTransformation());
+		}
+	});
+
+	store.Each<SceneNodeComponent, PlayerControllerComponent>([](size_t count, const Entity* entities, SceneNodeComponent* nodes, PlayerControllerComponent* controllers) {
+		for (size_t i = 0; i < count; i++) {
+			// only player nodes are adopted with a controller
+			PlayerNode* player = static_cast<PlayerNode*>(nodes[i].Node);
+			PlayerControlState state = player->GetControlState();
+
+			controllers[i].MoveX = state.MoveX;
+			controllers[i].MoveZ = state.MoveZ;
+			controllers[i].HorizontalSpeed = state.HorizontalSpeed;
+			controllers[i].IsJumping = state.IsJumping;
+			controllers[i].Active = player->IsActive();
+		}
+	});
+}
+
+void UpdatePlayerControllers(EntityStore& store, float cameraYaw)
+{
+	// the same camera-relative axes PlayerNode steers by
+	XMMATRIX yaw = XMMatrixRotationAxis(XMVectorSet(0.0f, 1.0f, 0.0f, 0.0f), XMConvertToRadians(cameraYaw));
+	XMVECTOR forward = XMVector3TransformCoord(XMVectorSet(0.0f, 0.0f, 1.0f, 0.0f), yaw);
+	XMVECTOR right = XMVector3TransformCoord(XMVectorSet(1.0f, 0.0f, 0.0f, 0.0f), yaw);
+
+	store.Each<PlayerControllerComponent, TransformComponent>([&](size_t count, const Entity* entities, PlayerControllerComponent* controllers, TransformComponent* transforms) {
+		for (size_t i = 0; i < count; i++) {
+			const PlayerControllerComponent& controller = controllers[i];
+			if (!controller.Active) continue;
+
+			XMVECTOR position = XMLoadFloat3(&transforms[i].Position);
+			position -= forward * (controller.MoveX * controller.HorizontalSpeed);
+			position += right * (controller.MoveZ * controller.HorizontalSpeed);
+
+			XMStoreFloat3(&transforms[i].Position, position);
+		}
+	}, SceneNodeComponent::Mask);
+}
+
+void UpdateTransforms(EntityStore& store)
+{
+	store.Each<TransformComponent>([](size_t count, const Entity* entities, TransformComponent* transforms) {
+		for (size_t i = 0; i < count; i++) {
+			TransformComponent& transform = transforms[i];
+
+			XMStoreFloat4x4(
+				&transform.World,
+				XMMatrixScalingFromVector(XMLoadFloat3(&transform.Scale))
+					* XMMatrixRotationQuaternion(XMLoadFloat4(&transform.Rotation))
+					* XMMatrixTranslationFromVector(XMLoadFloat3(&transform.Position))
+			);
+		}
+	}, SceneNodeComponent::Mask);
+}
+
+void UpdateColliders(EntityStore& store)
+{
+	store.Each<ColliderComponent, TransformComponent>([](size_t count, const Entity* entities, ColliderComponent* colliders, TransformComponent* transforms) {
+		for (size_t i = 0; i < count; i++) {
+			ColliderComponent& collider = colliders[i];
+			const XMFLOAT4X4& world = transforms[i].World;
+
+			// capsules stand upright wherever the entity is, as Collider's do
+			collider.Bottom = XMFLOAT3(
+				world._41 + collider.Offset.x,
+				world._42 + collider.Offset.y,
+				world._43 + collider.Offset.z
+			);
+
+			collider.Top = collider.Bottom;
+			collider.Top.y += collider.Height;
+		}
+	});
+}
+
+Entity AdoptSceneNode(EntityStore& store, SceneNode* node)
+{
+	Entity entity = store.Create();
+
+	store.Add(entity, SceneNodeComponent{ node });
+
+	TransformComponent transform;
+	std::shared_ptr<Transform> nodeTransform = node->GetTransform();
+	XMStoreFloat3(&transform.Position, nodeTransform->GetPosition());
+	XMStoreFloat4(&transform.Rotation, nodeTransform->GetRotation());
+	XMStoreFloat3(&transform.Scale, nodeTransform->GetScale());
+	XMStoreFloat4x4(&transform.World, XMMatrixIdentity());
+	store.Add(entity, transform);
+
+	std::shared_ptr<Collider> collider = node->GetCollider();
+	if (collider != nullptr) {
+		store.Add(entity, DescribeCollider(*collider));
+	}
+
+	MeshNode* meshNode = dynamic_cast<MeshNode*>(node);
+	if (meshNode != nullptr) {
+		store.Add(entity, MeshComponent{ meshNode->GetModelName() });
+	}
+
+	PlayerNode* playerNode = dynamic_cast<PlayerNode*>(node);
+	if (playerNode != nullptr) {
+		PlayerControlState state = playerNode->GetControlState();
+
+		store.Add(entity, PlayerControllerComponent{
+			state.MoveX,
+			state.MoveZ,
+			state.HorizontalSpeed,
+			state.IsJumping,
+			playerNode->IsActive()
+		});
+	}
+
+	return entity;
+}
+
+ColliderComponent DescribeCollider(const Collider& collider)
+{
+	ColliderComponent component;
+	component.Height = collider.GetHeight();
+	component.Radius = collider.GetRadius();
+	component.Offset = collider.GetOffset();
+	component.Pushable = collider.IsPushable();
+	component.Bottom = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	component.Top = XMFLOAT3(0.0f, 0.0f, 0.0f);
+	return component;
+}
@@ -0,0 +1,254 @@
+#pragma once
+#include "DirectXCore.h"
+#include "NameTable.h"
+#include <vector>
+#include <tuple>
+#include <map>
+
+class SceneNode;
+class Collider;
+
+// === components === //
+// Components are plain data. Each one has a bit in ComponentMask, and an
+// entity's mask picks the archetype it lives in.
+
+typedef unsigned int ComponentMask;
+
+struct TransformComponent {
+	static const ComponentMask	Mask = 1 << 0;
+
+	XMFLOAT3					Position;
+	XMFLOAT4					Rotation;
+	XMFLOAT3					Scale;
+	XMFLOAT4X4					World;
+};
+
+struct ColliderComponent {
+	static const ComponentMask	Mask = 1 << 1;
+
+	float						Height;
+	float						Radius;
+	XMFLOAT3					Offset;
+	bool						Pushable;
+
+	// the ends of the capsule in world space, from the world matrix
+	XMFLOAT3					Bottom;
+	XMFLOAT3					Top;
+};
+
+struct MeshComponent {
+	static const ComponentMask	Mask = 1 << 2;
+
+	NameId						Model;
+};
+
+struct PlayerControllerComponent {
+	static const ComponentMask	Mask = 1 << 3;
+
+	float						MoveX;
+	float						MoveZ;
+	float						HorizontalSpeed;
+	bool						IsJumping;
+	bool						Active;
+};
+
+// Adapter for entities that are still backed by a scene node. The scene
+// graph owns the node and stays the authority on its transform, collider
+// and controls until that node type has been migrated. Nodes are adopted
+// when they're attached to the scene and their entity is destroyed when
+// they're detached, so Node is never left pointing at a node that has
+// gone.
+struct SceneNodeComponent {
+	static const ComponentMask	Mask = 1 << 4;
+
+	SceneNode*					Node;
+};
+
+// === entities === //
+
+struct Entity {
+	unsigned int				Index;
+	unsigned int				Generation;
+};
+
+const Entity INVALID_ENTITY = { 0xffffffff, 0 };
+
+// Archetype-based entity-component store. Every distinct combination of
+// components gets an archetype, which keeps one dense array per component
+// plus the entities in the same order. Systems walk those arrays directly
+// rather than going through a virtual call per entity.
+
+class EntityStore
+{
+public:
+	EntityStore();
+	~EntityStore();
+
+	Entity						Create();
+	void						Destroy(Entity entity);
+	bool						IsAlive(Entity entity) const;
+
+	// adding or removing a component moves the entity to another archetype,
+	// so don't hold on to component pointers across these
+	template<typename T> void	Add(Entity entity, const T& component);
+	template<typename T> void	Remove(Entity entity);
+	template<typename T> bool	Has(Entity entity) const;
+	template<typename T> T*		Get(Entity entity);
+
+	// calls function(count, entities, T* columns...) once for every
+	// archetype that has all of the requested components, and none of
+	// the excluded ones
+	template<typename... T, typename Function>
+	void						Each(Function function, ComponentMask excluded = 0);
+
+	inline size_t				GetEntityCount() const { return entityCount_; }
+	inline size_t				GetArchetypeCount() const { return archetypes_.size(); }
+
+private:
+	struct Archetype {
+		ComponentMask			Mask;
+		std::vector<Entity>		Entities;
+
+		std::tuple<
+			std::vector<TransformComponent>,
+			std::vector<ColliderComponent>,
+			std::vector<MeshComponent>,
+			std::vector<PlayerControllerComponent>,
+			std::vector<SceneNodeComponent>
+		>						Columns;
+
+		template<typename T>
+		std::vector<T>&			Column() { return std::get<std::vector<T>>(Columns); }
+	};
+
+	struct EntityRecord {
+		unsigned int			Generation;
+		int						Archetype;
+		size_t					Row;
+	};
+
+	int							GetArchetype(ComponentMask mask);
+
+	// moves an entity's row into another archetype, leaving any new
+	// component for the caller to fill in
+	void						MoveEntity(Entity entity, int target);
+	void						RemoveRow(int archetype, size_t row);
+
+	template<typename T> void	CopyComponent(Archetype& from, size_t row, Archetype& to);
+	template<typename T> void	RemoveComponent(Archetype& archetype, size_t row);
+
+	std::vector<Archetype*>		archetypes_;
+	std::map<ComponentMask, int>	archetypeLookup_;
+
+	std::vector<EntityRecord>	records_;
+	std::vector<unsigned int>	freeIndices_;
+	size_t						entityCount_;
+};
+
+// === systems === //
+
+// copy the state of scene-node-backed entities out of their nodes: the
+// world matrix the transform hierarchy resolved, and the controls of
+// player nodes
+void	SyncSceneNodes(EntityStore& store);
+
+// move every active player controller not backed by a node along the
+// camera's axes. there's no terrain for them to stand on yet, so they
+// only move across the ground plane.
+void	UpdatePlayerControllers(EntityStore& store, float cameraYaw);
+
+// rebuild the world matrix of every transform component not backed by
+// a node
+void	UpdateTransforms(EntityStore& store);
+
+// put every collider's capsule where its world matrix says it is
+void	UpdateColliders(EntityStore& store);
+
+// create an entity mirroring an existing scene node, with whatever
+// components it can be described by
+Entity	AdoptSceneNode(EntityStore& store, SceneNode* node);
+
+// the component describing a node's collider, for adopted nodes that are
+// given one later
+ColliderComponent	DescribeCollider(const Collider& collider);
+
+// === template implementation === //
+
+template<typename T>
+void EntityStore::Add(Entity entity, const T& component)
+{
+	if (!IsAlive(entity)) return;
+
+	EntityRecord& record = records_[entity.Index];
+	ComponentMask mask = archetypes_[record.Archetype]->Mask;
+
+	if (mask & T::Mask) {
+		*Get<T>(entity) = component;
+		return;
+	}
+
+	MoveEntity(entity, GetArchetype(mask | T::Mask));
+	archetypes_[records_[entity.Index].Archetype]->Column<T>().push_back(component);
+}
+
+template<typename T>
+void EntityStore::Remove(Entity entity)
+{
+	if (!IsAlive(entity)) return;
+
+	EntityRecord& record = records_[entity.Index];
+	ComponentMask mask = archetypes_[record.Archetype]->Mask;
+
+	if ((mask & T::Mask) == 0) return;
+
+	MoveEntity(entity, GetArchetype(mask & ~T::Mask));
+}
+
+template<typename T>
+bool EntityStore::Has(Entity entity) const
+{
+	if (!IsAlive(entity)) return false;
+
+	return (archetypes_[records_[entity.Index].Archetype]->Mask & T::Mask) != 0;
+}
+
+template<typename T>
+T* EntityStore::Get(Entity entity)
+{
+	if (!Has<T>(entity)) return nullptr;
+
+	const EntityRecord& record = records_[entity.Index];
+	return &archetypes_[record.Archetype]->Column<T>()[record.Row];
+}
+
+template<typename... T, typename Function>
+void EntityStore::Each(Function function, ComponentMask excluded)
+{
+	ComponentMask required = 0;
+	for (ComponentMask mask : { T::Mask... }) required |= mask;
+
+	for (Archetype* archetype : archetypes_) {
+		if ((archetype->Mask & required) != required || (archetype->Mask & excluded) != 0) continue;
+		if (archetype->Entities.empty()) continue;
+
+		function(archetype->Entities.size(), archetype->Entities.data(), archetype->Column<T>().data()...);
+	}
+}
+
+template<typename T>
+void EntityStore::CopyComponent(Archetype& from, size_t row, Archetype& to)
+{
+	if ((from.Mask & T::Mask) && (to.Mask & T::Mask)) {
+		to.Column<T>().push_back(from.Column<T>()[row]);
+	}
+}
+
+template<typename T>
+void EntityStore::RemoveComponent(Archetype& archetype, size_t row)
+{
+	if ((archetype.Mask & T::Mask) == 0) return;
+
+	std::vector<T>& column = archetype.Column<T>();
+	column[row] = column.back();
+	column.pop_back();
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <algorithm>
+
+// Counters for the work done in a single frame. Reset at the start of
+// every update, so read them after the frame has been rendered.
+
+struct FrameStats
+{
+	// nodes whose combined world matrix had to be rebuilt this frame
+	unsigned int	WorldMatricesRebuilt;
+
+	// renderables left to draw, and those that failed the frustum cull
+	unsigned int	VisibleCount;
+	unsigned int	CulledCount;
+
+	// renderables in the frustum but hidden behind occluders, and how
+	// long the occlusion pass took
+	unsigned int	OccludedCount;
+	double			OcclusionMilliseconds;
+
+	// whole graphs skipped on their subtree bounds alone
+	unsigned int	SubtreesCulled;
+
+	// draws made through the render queue. filled in by the render
+	// rather than the update, so stays at zero in headless runs that
+	// don't render.
+	unsigned int	DrawItems;
+
+	// mesh instances drawn by those, and the groups they were drawn in
+	unsigned int	InstancesDrawn;
+	unsigned int	InstanceGroups;
+
+	// triangles in all of them, at whatever level of detail each was
+	// drawn at
+	unsigned long long	TrianglesDrawn;
+
+	// state changes passed on to the device, and those dropped because
+	// the same thing was already bound
+	unsigned int	StateCallsIssued;
+	unsigned int	StateCallsSkipped;
+
+	// bytes of constants and instance data sent to the GPU
+	unsigned long long	UploadBytes;
+
+	// the most upload space ever in use at once, and the uploads this
+	// frame that had to wait for the GPU or overran the space entirely
+	unsigned long long	UploadHighWater;
+	unsigned int	UploadStalls;
+	unsigned int	UploadOverflows;
+
+	FrameStats() { Reset(); }
+
+	void Reset()
+	{
+		WorldMatricesRebuilt = 0;
+		VisibleCount = 0;
+		CulledCount = 0;
+		OccludedCount = 0;
+		OcclusionMilliseconds = 0.0;
+		SubtreesCulled = 0;
+		DrawItems = 0;
+		InstancesDrawn = 0;
+		InstanceGroups = 0;
+		TrianglesDrawn = 0;
+		StateCallsIssued = 0;
+		StateCallsSkipped = 0;
+		UploadBytes = 0;
+		UploadHighWater = 0;
+		UploadStalls = 0;
+		UploadOverflows = 0;
+	}
+
+	// adds another frame's counts to these, for totals over a run. the
+	// high-water mark is the highest of any frame rather than a sum.
+	void Add(const FrameStats& frame)
+	{
+		WorldMatricesRebuilt += frame.WorldMatricesRebuilt;
+		VisibleCount += frame.VisibleCount;
+		CulledCount += frame.CulledCount;
+		OccludedCount += frame.OccludedCount;
+		OcclusionMilliseconds += frame.OcclusionMilliseconds;
+		SubtreesCulled += frame.SubtreesCulled;
+		DrawItems += frame.DrawItems;
+		InstancesDrawn += frame.InstancesDrawn;
+		InstanceGroups += frame.InstanceGroups;
+		TrianglesDrawn += frame.TrianglesDrawn;
+		StateCallsIssued += frame.StateCallsIssued;
+		StateCallsSkipped += frame.StateCallsSkipped;
+		UploadBytes += frame.UploadBytes;
+		UploadHighWater = std::max<unsigned long long>(UploadHighWater, frame.UploadHighWater);
+		UploadStalls += frame.UploadStalls;
+		UploadOverflows += frame.UploadOverflows;
+	}
+};
@@ -14,12 +14,13 @@ int APIENTRY wWinMain(
 	_In_	   int       nCmdShow)
 {
 	UNREFERENCED_PARAMETER(hPrevInstance);
-	UNREFERENCED_PARAMETER(lpCmdLine);
 
 	// we can only run if an instance of a class that inherits from Framework
 	// has been created
-	if (thisFramework_)
+	if (thisFramework_) {
+		thisFramework_->SetArguments(lpCmdLine);
 		return thisFramework_->Run(hInstance, nCmdShow);
+	}
 
 	return -1;
 }
@@ -77,6 +78,21 @@ int Framework::MainLoop()
 
 	while (msg.message != WM_QUIT)
 	{
+		if (headless_)
+		{
+			// run the simulation as fast as we can, only stopping to
+			// keep the message queue moving
+			Update();
+			if (headlessRendering_) Render();
+
+			if (PeekMessage(&msg, 0, 0, 0, PM_REMOVE))
+			{
+				TranslateMessage(&msg);
+				DispatchMessage(&msg);
+			}
+			continue;
+		}
+
 		if (updateFlag)
 		{
 			QueryPerformanceCounter(&currentTime);
@@ -185,8 +201,11 @@ bool Framework::InitialiseMainWindow(int nCmdShow)
 
 	input_ = std::make_shared<Input>(hWnd_);
 
-	ShowWindow(hWnd_, nCmdShow);
-	UpdateWindow(hWnd_);
+	if (!headless_)
+	{
+		ShowWindow(hWnd_, nCmdShow);
+		UpdateWindow(hWnd_);
+	}
 
 	Start();
 	return true;
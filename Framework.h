@@ -18,6 +18,15 @@ public:
 	inline unsigned int				GetHeight()		{ return height_; }
 	inline HWND						GetHWnd()		{ return hWnd_; }
 	inline std::shared_ptr<Input>	GetInput()		{ return input_;  }
+	inline std::wstring				GetArguments()	{ return arguments_; }
+
+	// headless runs skip rendering and frame pacing, and never show
+	// the window. used for replays and benchmarks. they can still draw
+	// every frame into the hidden window, to count what a frame draws.
+	inline bool						IsHeadless()	{ return headless_; }
+	inline void						SetHeadless(bool headless)	{ headless_ = headless; }
+	inline void						SetHeadlessRendering(bool rendering)	{ headlessRendering_ = rendering; }
+	inline void						SetArguments(std::wstring arguments) { arguments_ = arguments; }
 
 	// virtual update methods
 	virtual bool					Initialise()	{ return true; }
@@ -38,6 +47,9 @@ private:
 	unsigned int					width_;
 	unsigned int					height_;
 	double							timeSpan_;
+	std::wstring					arguments_;
+	bool							headless_ = false;
+	bool							headlessRendering_ = false;
 
 	bool							InitialiseMainWindow(int nCmdShow);
 	int								MainLoop();
@@ -3,6 +3,80 @@
 
 // === debug === //
 const bool	SHOW_DEBUG_CONSOLE =			true;
+const bool	LOG_CONTACTS =					false;
+// print what was drawn, averaged over this many rendered frames. 0 never
+// does, and replays print it for the whole run when they finish anyway.
+const unsigned int LOG_RENDER_STATS_INTERVAL =	0;
+
+// === scene update === //
+// graphs with at least this many children update them in parallel,
+// in batches of PARALLEL_UPDATE_BATCH
+const bool	PARALLEL_UPDATE =				true;
+const size_t PARALLEL_UPDATE_MIN_CHILDREN =	1024;
+const size_t PARALLEL_UPDATE_BATCH =		256;
+
+// === rendering === //
+// skip mesh nodes whose bounds are entirely outside the view frustum
+const bool	FRUSTUM_CULLING =				true;
+// how often graphs get their subtree bounds shrunk back down
+const unsigned int BOUNDS_REFIT_INTERVAL =	30;
+
+// draws are sorted front to back up to this distance. anything further
+// sorts as if it were this far away.
+const float	RENDER_SORT_DEPTH =				10000.0f;
+
+// room for the per-draw constants and instance data of every frame the
+// GPU may still be working on. running out means waiting for it to catch
+// up. the instance ring grows if a single frame needs more than it has.
+const UINT	CONSTANT_RING_SIZE =			1024 * 1024;
+const UINT	INSTANCE_RING_SIZE =			256 * 1024;
+
+// place each sub-mesh by the transforms on the nodes above it in its
+// model file. off, since the scene is laid out for models drawn in the
+// space their vertices are stored in.
+const bool	MESH_NODE_TRANSFORMS =			false;
+
+// starting sizes of the vertex and index buffers every static mesh is
+// packed into. they double whenever they run out.
+const UINT	GEOMETRY_POOL_VERTICES =		256 * 1024;
+const UINT	GEOMETRY_POOL_INDICES =			1024 * 1024;
+
+// weld duplicate vertices and reorder sub-meshes for the vertex cache,
+// overdraw and vertex fetch as they're loaded
+const bool	MESH_OPTIMISATION =				true;
+
+// simplified levels of detail built for each sub-mesh as it's loaded,
+// each aiming for MESH_LOD_REDUCTION of the triangles of the one before.
+// none may move a vertex further than MESH_LOD_MAX_ERROR of the sub-mesh's
+// bounding radius, so simple meshes can end up with fewer levels.
+const UINT	MESH_LOD_LEVELS =				3;
+const float	MESH_LOD_REDUCTION =			0.5f;
+const float	MESH_LOD_MAX_ERROR =			0.05f;
+
+// measure each level against the original as it's built. slow, since it
+// checks every vertex against every triangle.
+const bool	MESH_LOD_VERIFY =				false;
+
+// mesh nodes draw at the coarsest level whose error would cover less
+// than MESH_LOD_PIXEL_ERROR pixels on screen. they only switch once it's
+// past that by MESH_LOD_HYSTERESIS either way, so they don't flicker
+// between two levels.
+const float	MESH_LOD_PIXEL_ERROR =			1.0f;
+const float	MESH_LOD_HYSTERESIS =			0.25f;
+
+// draw every copy of the same mesh with one instanced draw per sub-mesh
+const bool	HARDWARE_INSTANCING =			true;
+
+// hide mesh nodes behind the terrain, using a coarse depth buffer drawn
+// on the cpu. the width has to be a multiple of four.
+const bool	OCCLUSION_CULLING =				true;
+const UINT	OCCLUSION_WIDTH =				256;
+const UINT	OCCLUSION_HEIGHT =				144;
+
+// terrain occluders are a coarse copy of the heightmap, OCCLUDER_STEP
+// cells to a quad, cut into chunks of OCCLUDER_CHUNK quads a side
+const int	OCCLUDER_STEP =					16;
+const int	OCCLUDER_CHUNK =				8;
 
 // === camera === //
 const float CAMERA_DISTANCE =				30.0f;
@@ -76,7 +150,7 @@ const std::wstring	HEIGHTMAP =				L"data\\heightmap.raw";
 
 const std::wstring	TERRAIN_SHADER =		L"shader\\multiTexture.hlsl";
 const std::wstring	SKYBOX_SHADER =			L"shader\\SkyShader.hlsl";
-const std::wstring	MESH_SHADER =			L"shader\\TexturedShaders.hlsl";
+const std::wstring	MESH_SHADER =			L"shader\\MeshShaders.hlsl";
 
 const std::wstring	PALM_MODEL =			L"model\\palm4\\scene.gltf";
 const std::wstring	DOG_MODEL =				L"model\\dog\\scene.gltf";
@@ -0,0 +1,119 @@
+#include "GeometryPool.h"
+#include <algorithm>
+
+GeometryPool::GeometryPool(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext, UINT vertexStride, UINT vertexCapacity, UINT indexCapacity) :
+	device_(device),
+	deviceContext_(deviceContext),
+	rebuilds_(0)
+{
+	vertices_.Stride = vertexStride;
+	vertices_.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	indices_.Stride = sizeof(UINT);
+	indices_.BindFlags = D3D11_BIND_INDEX_BUFFER;
+
+	Rebuild(vertices_, vertexCapacity);
+	Rebuild(indices_, indexCapacity);
+
+	// building them in the first place doesn't count
+	rebuilds_ = 0;
+}
+
+GeometryPool::~GeometryPool()
+{
+}
+
+GeometryAllocation GeometryPool::Add(const void* vertices, UINT vertexCount, const UINT* indices, UINT indexCount)
+{
+	GeometryAllocation allocation;
+	allocation.Vertices = Allocate(vertices_, vertexCount);
+	allocation.Indices = Allocate(indices_, indexCount);
+
+	Upload(vertices_, allocation.Vertices, vertices);
+	Upload(indices_, allocation.Indices, indices);
+
+	return allocation;
+}
+
+void GeometryPool::Remove(const GeometryAllocation& allocation)
+{
+	vertices_.Ranges.Free(allocation.Vertices);
+	indices_.Ranges.Free(allocation.Indices);
+}
+
+INT GeometryPool::GetBaseVertex(const GeometryAllocation& allocation) const
+{
+	if (allocation.Vertices == INVALID_RANGE) return 0;
+	return (INT)vertices_.Ranges.GetOffset(allocation.Vertices);
+}
+
+UINT GeometryPool::GetStartIndex(const GeometryAllocation& allocation) const
+{
+	if (allocation.Indices == INVALID_RANGE) return 0;
+	return indices_.Ranges.GetOffset(allocation.Indices);
+}
+
+void GeometryPool::Defragment()
+{
+	Rebuild(vertices_, vertices_.Ranges.GetCapacity());
+	Rebuild(indices_, indices_.Ranges.GetCapacity());
+}
+
+RangeHandle GeometryPool::Allocate(Pool& pool, UINT count)
+{
+	if (count == 0) return INVALID_RANGE;
+
+	RangeHandle range = pool.Ranges.Allocate(count);
+	if (range != INVALID_RANGE) return range;
+
+	// there's either enough room once it's all packed together, or we
+	// need more
+	UINT needed = pool.Ranges.GetUsed() + count;
+
+	// a pool made with no room would never double its way to any
+	UINT capacity = std::max<UINT>(pool.Ranges.GetCapacity(), 1);
+
+	while (capacity < needed) capacity *= 2;
+
+	Rebuild(pool, capacity);
+
+	range = pool.Ranges.Allocate(count);
+	if (range == INVALID_RANGE) throw std::exception();
+
+	return range;
+}
+
+void GeometryPool::Rebuild(Pool& pool, UINT capacity)
+{
+	pool.Ranges.Defragment(moves_);
+	pool.Ranges.Grow(capacity);
+
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
+	bufferDesc.ByteWidth = pool.Ranges.GetCapacity() * pool.Stride;
+	bufferDesc.BindFlags = pool.BindFlags;
+
+	ComPtr<ID3D11Buffer> buffer;
+	ThrowIfFailed(device_->CreateBuffer(&bufferDesc, nullptr, buffer.GetAddressOf()));
+
+	// a buffer can't be copied to itself, so everything goes across to
+	// the new one, whether it moved or not
+	for (const RangeMove& move : moves_) {
+		D3D11_BOX box = { move.From * pool.Stride, 0, 0, (move.From + move.Count) * pool.Stride, 1, 1 };
+		deviceContext_->CopySubresourceRegion(buffer.Get(), 0, move.To * pool.Stride, 0, 0, pool.Buffer.Get(), 0, &box);
+	}
+
+	pool.Buffer = buffer;
+	rebuilds_++;
+}
+
+void GeometryPool::Upload(Pool& pool, RangeHandle range, const void* data)
+{
+	if (range == INVALID_RANGE) return;
+
+	UINT offset = pool.Ranges.GetOffset(range);
+	UINT count = pool.Ranges.GetCount(range);
+
+	D3D11_BOX box = { offset * pool.Stride, 0, 0, (offset + count) * pool.Stride, 1, 1 };
+	deviceContext_->UpdateSubresource(pool.Buffer.Get(), 0, &box, data, 0, 0);
+}
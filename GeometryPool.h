@@ -0,0 +1,76 @@
+#pragma once
+#include "Core.h"
+#include "DirectXCore.h"
+#include "RangeAllocator.h"
+#include <vector>
+
+// Keeps the vertices and indices of every static mesh in one shared
+// vertex buffer and one shared index buffer, so drawing one sub-mesh
+// after another doesn't have to bind anything new. Each sub-mesh is a
+// range of each, drawn with a base vertex and a start index.
+//
+// When there's no single gap big enough for new geometry, the buffers are
+// rebuilt with everything packed together at the front, and grown if that
+// still isn't enough. That moves geometry about, so ask for offsets when
+// drawing rather than keeping them.
+
+struct GeometryAllocation {
+	RangeHandle			Vertices;
+	RangeHandle			Indices;
+};
+
+class GeometryPool
+{
+public:
+	GeometryPool(ComPtr<ID3D11Device> device, ComPtr<ID3D11DeviceContext> deviceContext, UINT vertexStride, UINT vertexCapacity, UINT indexCapacity);
+	~GeometryPool();
+
+	// copy geometry into the pool. indices are relative to the first of
+	// these vertices. empty geometry takes up no room, and draws from
+	// the start of the buffers.
+	GeometryAllocation	Add(const void* vertices, UINT vertexCount, const UINT* indices, UINT indexCount);
+	void				Remove(const GeometryAllocation& allocation);
+
+	// pack everything together at the front of the buffers
+	void				Defragment();
+
+	inline ID3D11Buffer*	GetVertexBuffer() const { return vertices_.Buffer.Get(); }
+	inline ID3D11Buffer*	GetIndexBuffer() const { return indices_.Buffer.Get(); }
+	inline UINT			GetVertexStride() const { return vertices_.Stride; }
+
+	INT					GetBaseVertex(const GeometryAllocation& allocation) const;
+	UINT				GetStartIndex(const GeometryAllocation& allocation) const;
+
+	inline const RangeAllocator&	GetVertexRanges() const { return vertices_.Ranges; }
+	inline const RangeAllocator&	GetIndexRanges() const { return indices_.Ranges; }
+
+	// how often the buffers have had to be rebuilt, to pack or to grow
+	inline unsigned int	GetRebuilds() const { return rebuilds_; }
+
+private:
+	// one buffer, and the ranges it's cut up into
+	struct Pool {
+		ComPtr<ID3D11Buffer>	Buffer;
+		RangeAllocator			Ranges;
+		UINT					Stride;
+		UINT					BindFlags;
+	};
+
+	// allocate count elements, packing or growing the pool to fit
+	RangeHandle			Allocate(Pool& pool, UINT count);
+
+	// copy every range into a new buffer of capacity elements, packed
+	// against the front
+	void				Rebuild(Pool& pool, UINT capacity);
+
+	void				Upload(Pool& pool, RangeHandle range, const void* data);
+
+	ComPtr<ID3D11Device>			device_;
+	ComPtr<ID3D11DeviceContext>		deviceContext_;
+
+	Pool					vertices_;
+	Pool					indices_;
+
+	std::vector<RangeMove>	moves_;
+	unsigned int			rebuilds_;
+};
@@ -6,8 +6,12 @@
 #include "AudioNode.h"
 #include "SkyboxNode.h"
 #include "GameConstants.h"
+#include "SceneFile.h"
+#include "SceneBenchmarks.h"
 #include <cmath>
 #include <iostream>
+#include <sstream>
+#include <algorithm>
 
 Graphics2 app;
 
@@ -16,6 +20,26 @@ const int PALM_COUNT = 20;
 
 const float FOX_SCALE = 0.05f;
 
+const unsigned int DEFAULT_SEED = 1;
+
+// what the render queue and state cache did, as averages over frames.
+// the upload ring's stalls and overflows are totals, since any at all
+// are worth knowing about.
+static void PrintRenderStats(const FrameStats& totals, unsigned int frames)
+{
+	double perFrame = 1.0 / std::max<unsigned int>(frames, 1);
+
+	std::cout << "draws: " << (totals.DrawItems * perFrame) << "/frame through the render queue, "
+		<< (totals.InstancesDrawn * perFrame) << " instances in "
+		<< (totals.InstanceGroups * perFrame) << " groups/frame" << std::endl;
+	std::cout << "triangles: " << (totals.TrianglesDrawn * perFrame) << "/frame" << std::endl;
+	std::cout << "state calls: " << (totals.StateCallsIssued * perFrame) << " issued, "
+		<< (totals.StateCallsSkipped * perFrame) << " skipped/frame" << std::endl;
+	std::cout << "uploads: " << (totals.UploadBytes * perFrame / 1024.0) << "KB/frame, "
+		<< (totals.UploadHighWater / 1024.0) << "KB most in flight at once, "
+		<< totals.UploadStalls << " stalls, " << totals.UploadOverflows << " overflows" << std::endl;
+}
+
 Graphics2::Graphics2() :
 	DirectXFramework(WINDOW_WIDTH, WINDOW_HEIGHT)
 {
@@ -28,6 +52,52 @@ void Graphics2::CreateSceneGraph()
 		InitDebugConsole();
 
 	std::cout << ":: === welcome to paradise === ::" << std::endl;
+
+	// look for record/replay options. replays bring their own seed
+	// and run without a window as fast as possible. -render has them
+	// draw every frame as well, so what they draw can be counted.
+	unsigned int seed = DEFAULT_SEED;
+	std::wstring recordPath;
+	std::wstring replayPath;
+	std::wstring scenePath;
+	bool renderReplay = false;
+
+	std::wistringstream arguments(GetArguments());
+	std::wstring argument;
+
+	while (arguments >> argument) {
+		if (argument == L"-record")		arguments >> recordPath;
+		else if (argument == L"-replay")	arguments >> replayPath;
+		else if (argument == L"-seed")		arguments >> seed;
+		else if (argument == L"-dumpocclusion")	arguments >> occlusionDumpPath_;
+		else if (argument == L"-scene")		arguments >> scenePath;
+		else if (argument == L"-bakescene")	arguments >> bakePath_;
+		else if (argument == L"-benchmark")	arguments >> benchmark_;
+		else if (argument == L"-render")	renderReplay = true;
+	}
+
+	// benchmarks don't need a window, and shouldn't be held to vsync
+	if (!benchmark_.empty()) SetHeadless(true);
+
+	if (!replayPath.empty()) {
+		if (recorder_.StartReplay(replayPath)) {
+			seed = recorder_.GetSeed();
+			SetHeadless(true);
+			SetHeadlessRendering(renderReplay);
+			std::wcout << L"replaying " << recorder_.GetFrameCount() << L" frames from " << replayPath << std::endl;
+		}
+		else {
+			std::wcout << L"couldn't open replay " << replayPath << std::endl;
+		}
+	}
+	else if (!recordPath.empty()) {
+		if (recorder_.StartRecording(recordPath, seed))
+			std::wcout << L"recording input to " << recordPath << std::endl;
+	}
+
+	random_.seed(seed);
+	QueryPerformanceCounter(&startTime_);
+
 	std::cout << "initialising scene graph...\t";
 
 	// set our lighting state
@@ -48,22 +118,49 @@ void Graphics2::CreateSceneGraph()
 	sceneGraph->Add(terrain_);
 	GetCamera()->SetTerrain(terrain_);
 
-	// add a bunch o palms
-	SceneNodePointer palm;
-	for (int i = 0; i < PALM_COUNT; i++) {
-		palm = std::make_shared<MeshNode>(L"palm_" + std::to_wstring(i), PALM_MODEL);
+	// add a bunch o palms, either from a baked scene file or scattered
+	// about at random
+	palms_ = std::make_shared<SceneGraph>(L"palms");
+	sceneGraph->Add(palms_);
+
+	size_t loaded = 0;
+	LARGE_INTEGER loadStart, loadEnd, frequency;
+	QueryPerformanceCounter(&loadStart);
 
-		palm->GetTransform()->Rotate(XM_PIDIV2, XM_2PI * ((float)rand() / RAND_MAX), 0.0f);
-		palm->GetTransform()->SetScale(PALM_SCALE);
+	if (!scenePath.empty() && LoadScene(scenePath, palms_, &loaded)) {
+		QueryPerformanceCounter(&loadEnd);
+		QueryPerformanceFrequency(&frequency);
 
-		palm->CreateCollider(100.0f, 2.0f, XMFLOAT3(0, 0, 0), false);
+		double milliseconds = (double)(loadEnd.QuadPart - loadStart.QuadPart) * 1000.0 / frequency.QuadPart;
+		std::wcout << L"loaded " << loaded << L" nodes from " << scenePath << L" in " << milliseconds << L"ms" << std::endl;
 
-		sceneGraph->Add(palm);
+		// baked palms already know where they stand
+		for (size_t i = 0; i < palms_->GetChildCount(); i++) {
+			palmNames_.push_back(palms_->GetChild(i)->GetNameId());
+		}
+		palmsPlaced_ = true;
+	}
+	else {
+		if (!scenePath.empty()) std::wcout << L"couldn't load scene " << scenePath << std::endl;
+
+		SceneNodePointer palm;
+		for (int i = 0; i < PALM_COUNT; i++) {
+			palm = MakePooled<MeshNode>(L"palm_" + std::to_wstring(i), PALM_MODEL);
+
+			palm->GetTransform()->Rotate(XM_PIDIV2, XM_2PI * NextRandom(), 0.0f);
+			palm->GetTransform()->SetScale(PALM_SCALE);
+
+			palm->CreateCollider(100.0f, 2.0f, XMFLOAT3(0, 0, 0), false);
+
+			palms_->Add(palm);
+			palmNames_.push_back(palm->GetNameId());
+		}
 	}
 
 	// add a dog
-	SceneNodePointer dog = std::make_shared<MeshNode>(L"dog", DOG_MODEL);
+	SceneNodePointer dog = MakePooled<MeshNode>(L"dog", DOG_MODEL);
 	sceneGraph->Add(dog);
+	dogName_ = dog->GetNameId();
 	dog->GetTransform()->SetPosition(-1350.0f, -500.0f, 450.0f);
 	dog->GetTransform()->SetRotation(XM_PIDIV2, XM_PI, 0);
 	dog->GetTransform()->SetScale(1.0f);
@@ -79,6 +176,7 @@ void Graphics2::CreateSceneGraph()
 	player_->SetTerrain(terrain_);
 	player_->CreateCollider(0.0f, 3.0f, XMFLOAT3(0, 0, 0), true);
 	sceneGraph->Add(player_);
+	foxName_ = player_->GetNameId();
 	GetCamera()->FollowNode(player_, CAMERA_DISTANCE, CAMERA_YOFFSET);
 
 	// add some tunes
@@ -90,11 +188,36 @@ void Graphics2::CreateSceneGraph()
 
 void Graphics2::UpdateSceneGraph()
 {
+	// benchmarks run once the scene is up, and then we're done
+	if (!benchmark_.empty()) {
+		if (!benchmarkFinished_) {
+			benchmarkFinished_ = true;
+			PostQuitMessage(RunSceneBenchmark(benchmark_) ? 0 : 1);
+		}
+		return;
+	}
+
+	// === gather this frame's input === //
+	// do this before touching the scene, so that a finished replay
+	// leaves everything exactly as the last recorded frame did.
+	FrameInput input;
+
+	if (recorder_.IsReplaying()) {
+		if (!recorder_.NextFrame(input)) {
+			FinishReplay();
+			return;
+		}
+	}
+	else {
+		input = ReadInput();
+		recorder_.Record(input);
+	}
+
 	// === reference getting === //
 	SceneGraphPointer sceneGraph = GetSceneGraph();
 
 	SceneNodePointer fox;
-	fox = sceneGraph->Find(L"fox");
+	fox = sceneGraph->Find(foxName_);
 
 	SceneNodePointer palm;
 
@@ -115,57 +238,14 @@ void Graphics2::UpdateSceneGraph()
 
 	// === check our collisions === //
 	if (!firstFrame_) {
-		std::shared_ptr<Collider> currentCollider;
-		std::shared_ptr<Collider> otherCollider;
-
-		CollisionInfo info;
-
-		for (size_t i = 0; i < sceneGraph->GetChildCount(); i++) {
-			SceneNodePointer current = sceneGraph->GetChild(i);
-			currentCollider = current->GetCollider();
-
-			// don't collide with uncollidable objects
-			if (currentCollider == nullptr) continue;
-
-			for (size_t j = i + 1; j < sceneGraph->GetChildCount(); j++) {
-				SceneNodePointer other = sceneGraph->GetChild(j);
-				otherCollider = other->GetCollider();
-
-				// don't collide with uncollidable objects
-				if (otherCollider == nullptr) continue;
-
-				bool collided = (currentCollider->IsIntersecting(*otherCollider, info));
-
-				if (collided) {
-					std::wcout << current->GetName() << L" collided with " << other->GetName() << L"!" << std::endl;
-
-					// if both are pushable, push each half as far
-					float offsetScale = (currentCollider->IsPushable() && otherCollider->IsPushable())
-						? 0.5f
-						: 1.0f;
-
-					if (currentCollider->IsPushable()) {
-						current->GetTransform()->Translate(XMFLOAT3(
-							info.offset.x * offsetScale,
-							info.offset.y * offsetScale,
-							info.offset.z * offsetScale
-						));
-					}
-
-					if (otherCollider->IsPushable()) {
-						other->GetTransform()->Translate(XMFLOAT3(
-							info.offset.x * -offsetScale,
-							info.offset.y * -offsetScale,
-							info.offset.z * -offsetScale
-						));
-					}
-				}
-			}
-		}
+		GetCollisionSystem()->Step();
+
+		if (LOG_CONTACTS)
+			GetCollisionSystem()->LogContacts(std::wcout);
 	}
 
 	// === keep the good boy on the ground === //
-	SceneNodePointer goodBoy = sceneGraph->Find(L"dog");
+	SceneNodePointer goodBoy = sceneGraph->Find(dogName_);
 	XMFLOAT3 position;
 	XMStoreFloat3(&position, goodBoy->GetTransform()->GetPosition());
 	goodBoy->GetTransform()->SetPosition(
@@ -180,35 +260,15 @@ void Graphics2::UpdateSceneGraph()
 	// === handle input === //
 
 	a_ += FRAME_DELTA;
+	frameCount_++;
 	bool foxSelected = GetCamera()->IsFollowingNode();
 
-	float lr =
-		GetInput()->IsKeyPressed(MOVE_LEFT)		? -1.0f :
-		GetInput()->IsKeyPressed(MOVE_RIGHT)	? +1.0f :
-													0.0f;
-	float fb =
-		GetInput()->IsKeyPressed(MOVE_FORWARD)	? +1.0f :
-		GetInput()->IsKeyPressed(MOVE_BACKWARD)	? -1.0f :
-													0.0f;
-
-	// normalise our velocity
-	float sum = sqrtf((lr * lr) + (fb * fb));
-	if (sum > 1.0f) {
-		lr /= sum;
-		fb /= sum;
-	}
-
-	float ud =
-		GetInput()->IsKeyPressed(MOVE_DOWN)		? -1.0f :
-		GetInput()->IsKeyPressed(MOVE_UP)		? +1.0f :
-													0.0f;
-
-	float mod =
-		GetInput()->IsKeyPressed(MOVE_SPEEDY) ? SPEED_SPEEDY : SPEED_NORMAL;
+	float lr = input.Player.MoveX;
+	float fb = input.Player.MoveZ;
+	float ud = input.MoveY;
+	float mod = input.Player.HorizontalSpeed;
 
-	bool swapCam = GetInput()->IsKeyDown(TOGGLE_CAMERA);
-
-	if (swapCam) {
+	if (input.SwapCamera) {
 		// toggle our selection
 		foxSelected ^= true;
 
@@ -224,17 +284,8 @@ void Graphics2::UpdateSceneGraph()
 	}
 
 	// === player state updates === //
-	bool foxJump = GetInput()->IsKeyDown(PLAYER_JUMP);
-
-	PlayerControlState state{
-		lr,
-		fb,
-		mod,
-		foxJump
-	};
-
 	player_->SetActive(foxSelected);
-	player_->SetControlState(state);
+	player_->SetControlState(input.Player);
 
 	// === camera movement === //
 	if (!foxSelected) {
@@ -243,23 +294,22 @@ void Graphics2::UpdateSceneGraph()
 		GetCamera()->SetRelativeY(ud * mod);
 	}
 
-	XMFLOAT2 mouseInput = GetInput()->GetMouseDelta();
-	GetCamera()->SetYaw(-mouseInput.x * MOUSE_SENSITIVITY);
-	GetCamera()->SetPitch(-mouseInput.y * MOUSE_SENSITIVITY);
+	GetCamera()->SetYaw(-input.MouseDelta.x * MOUSE_SENSITIVITY);
+	GetCamera()->SetPitch(-input.MouseDelta.y * MOUSE_SENSITIVITY);
 
 	// === spinny palms === //
-	for (int i = 0; i < PALM_COUNT; i++) {
-		palm = sceneGraph->Find(L"palm_" + std::to_wstring(i));
+	for (size_t i = 0; i < palmNames_.size(); i++) {
+		palm = sceneGraph->Find(palmNames_[i]);
 		palm->GetTransform()->Rotate(0.0f, 0.015f, 0.0f);
 
 		// set their positions randomly. we have to do this in
 		// update, because in CreateSceneGraph() the terrain
 		// hasn't been generated yet.
-		if (firstFrame_) {
+		if (!palmsPlaced_) {
 			XMFLOAT3 position = {
-				(((float)rand() / (RAND_MAX + 1)) - 0.5f) * (GRID_SIZE * GRID_STEP),
+				(NextRandom() - 0.5f) * (GRID_SIZE * GRID_STEP),
 				0,
-				(((float)rand() / (RAND_MAX + 1)) - 0.5f) * (GRID_SIZE * GRID_STEP)
+				(NextRandom() - 0.5f) * (GRID_SIZE * GRID_STEP)
 			};
 			position.y = terrain_->GetHeightAtPoint(position.x, position.z) - 4.0f;
 
@@ -267,5 +317,121 @@ void Graphics2::UpdateSceneGraph()
 		}
 	}
 
+	palmsPlaced_ = true;
+
+	// bake the palms out once they've all found their feet
+	if (!bakePath_.empty()) {
+		if (SaveScene(bakePath_, palms_))	std::wcout << L"palms baked to " << bakePath_ << std::endl;
+		else								std::wcout << L"couldn't write " << bakePath_ << std::endl;
+
+		bakePath_.clear();
+	}
+
 	firstFrame_ = false;
 }
+
+FrameInput Graphics2::ReadInput()
+{
+	FrameInput input;
+
+	float lr =
+		GetInput()->IsKeyPressed(MOVE_LEFT)		? -1.0f :
+		GetInput()->IsKeyPressed(MOVE_RIGHT)	? +1.0f :
+													0.0f;
+	float fb =
+		GetInput()->IsKeyPressed(MOVE_FORWARD)	? +1.0f :
+		GetInput()->IsKeyPressed(MOVE_BACKWARD)	? -1.0f :
+													0.0f;
+
+	// normalise our velocity
+	float sum = sqrtf((lr * lr) + (fb * fb));
+	if (sum > 1.0f) {
+		lr /= sum;
+		fb /= sum;
+	}
+
+	float ud =
+		GetInput()->IsKeyPressed(MOVE_DOWN)		? -1.0f :
+		GetInput()->IsKeyPressed(MOVE_UP)		? +1.0f :
+													0.0f;
+
+	float mod =
+		GetInput()->IsKeyPressed(MOVE_SPEEDY) ? SPEED_SPEEDY : SPEED_NORMAL;
+
+	input.Player = PlayerControlState{
+		lr,
+		fb,
+		mod,
+		GetInput()->IsKeyDown(PLAYER_JUMP)
+	};
+
+	input.MoveY = ud;
+	input.MouseDelta = GetInput()->GetMouseDelta();
+	input.SwapCamera = GetInput()->IsKeyDown(TOGGLE_CAMERA);
+
+	return input;
+}
+
+void Graphics2::FinishReplay()
+{
+	// we may get a few more updates before the quit message arrives
+	if (replayFinished_) return;
+	replayFinished_ = true;
+
+	LARGE_INTEGER endTime;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&endTime);
+	QueryPerformanceFrequency(&frequency);
+
+	double seconds = (double)(endTime.QuadPart - startTime_.QuadPart) / frequency.QuadPart;
+
+	std::cout << "replay finished: " << frameCount_ << " frames in " << seconds << "s ("
+		<< (seconds * 1000.0 / std::max<unsigned int>(frameCount_, 1)) << "ms/frame)" << std::endl;
+	std::cout << "scene checksum: " << std::hex << ComputeSceneChecksum(GetSceneGraph()) << std::dec << std::endl;
+
+	std::shared_ptr<OcclusionBuffer> occlusion = GetOcclusionBuffer();
+	unsigned int occlusionFrames = std::max<unsigned int>(occlusion->GetFrames(), 1);
+
+	std::cout << "occlusion: " << occlusion->GetTotalRejected() << " draws rejected, "
+		<< (occlusion->GetTotalMilliseconds() / occlusionFrames) << "ms/frame" << std::endl;
+
+	// averages over the frames that were drawn, which is none unless the
+	// replay was run with -render
+	if (GetRenderedFrames() > 0)	PrintRenderStats(GetTotalStats(), GetRenderedFrames());
+	else							std::cout << "draws: not counted, replay with -render to count them" << std::endl;
+
+	// the buffer still holds the last frame
+	if (!occlusionDumpPath_.empty()) {
+		if (occlusion->DumpDepth(occlusionDumpPath_))	std::wcout << L"occlusion buffer written to " << occlusionDumpPath_ << std::endl;
+		else											std::wcout << L"couldn't write " << occlusionDumpPath_ << std::endl;
+	}
+
+	PostQuitMessage(0);
+}
+
+void Graphics2::Render()
+{
+	DirectXFramework::Render();
+
+	if (LOG_RENDER_STATS_INTERVAL == 0) return;
+
+	logStats_.Add(GetFrameStats());
+	if (++logFrames_ < LOG_RENDER_STATS_INTERVAL) return;
+
+	std::cout << "=== last " << logFrames_ << " frames ===" << std::endl;
+	PrintRenderStats(logStats_, logFrames_);
+
+	logStats_.Reset();
+	logFrames_ = 0;
+}
+
+float Graphics2::NextRandom()
+{
+	return std::uniform_real_distribution<float>(0.0f, 1.0f)(random_);
+}
+
+void Graphics2::Shutdown()
+{
+	recorder_.Stop();
+	DirectXFramework::Shutdown();
+}
@@ -2,6 +2,8 @@
 #include "DirectXFramework.h"
 #include "TerrainNode.h"
 #include "PlayerNode.h"
+#include "InputRecorder.h"
+#include <random>
 
 class Graphics2 : public DirectXFramework
 {
@@ -9,10 +11,43 @@ public:
 	Graphics2();
 	void CreateSceneGraph();
 	void UpdateSceneGraph();
+	void Render();
+	void Shutdown();
 private:
+	FrameInput ReadInput();
+	void FinishReplay();
+	float NextRandom();
+
 	bool firstFrame_ = true;
-	float a_;
+	float a_ = 0.0f;
+
+	InputRecorder recorder_;
+	std::mt19937 random_;
+	unsigned int frameCount_ = 0;
+	bool replayFinished_ = false;
+	LARGE_INTEGER startTime_;
+
+	// rendered frames' stats since the last time they were logged
+	FrameStats logStats_;
+	unsigned int logFrames_ = 0;
+
+	// where to write the occlusion depth buffer when a replay finishes
+	std::wstring occlusionDumpPath_;
+
+	// which scene benchmark to run instead of the game, if any
+	std::wstring benchmark_;
+	bool benchmarkFinished_ = false;
+
+	// where to save the palms once they've been placed
+	std::wstring bakePath_;
+	bool palmsPlaced_ = false;
+
+	// looked up every frame, so resolve the names once up front
+	NameId foxName_ = NAME_NONE;
+	NameId dogName_ = NAME_NONE;
+	std::vector<NameId> palmNames_;
 
+	SceneGraphPointer palms_;
 	std::shared_ptr<TerrainNode> terrain_;
 	std::shared_ptr<PlayerNode> player_;
 };
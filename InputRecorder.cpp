@@ -0,0 +1,152 @@
+#include "InputRecorder.h"
+#include <cstring>
+
+// === log format === //
+// header:	"BSIR", version, seed				(3 x 4 bytes)
+// frame:	6 floats followed by a flags byte	(25 bytes)
+
+const char			LOG_MAGIC[4] =			{ 'B', 'S', 'I', 'R' };
+const unsigned int	LOG_VERSION =			1;
+
+const unsigned char	FLAG_JUMP =				1 << 0;
+const unsigned char	FLAG_SWAP_CAMERA =		1 << 1;
+
+InputRecorder::InputRecorder()
+{
+}
+
+InputRecorder::~InputRecorder()
+{
+	Stop();
+}
+
+bool InputRecorder::StartRecording(std::wstring path, unsigned int seed)
+{
+	Stop();
+
+	output_.open(path.c_str(), std::ios_base::binary | std::ios_base::trunc);
+	if (!output_) return false;
+
+	output_.write(LOG_MAGIC, sizeof(LOG_MAGIC));
+	output_.write((const char*)&LOG_VERSION, sizeof(LOG_VERSION));
+	output_.write((const char*)&seed, sizeof(seed));
+
+	seed_ = seed;
+	recording_ = true;
+	return true;
+}
+
+bool InputRecorder::StartReplay(std::wstring path)
+{
+	Stop();
+
+	std::ifstream input;
+	input.open(path.c_str(), std::ios_base::binary);
+	if (!input) return false;
+
+	char magic[4];
+	unsigned int version;
+
+	input.read(magic, sizeof(magic));
+	input.read((char*)&version, sizeof(version));
+	input.read((char*)&seed_, sizeof(seed_));
+
+	if (!input || memcmp(magic, LOG_MAGIC, sizeof(magic)) != 0 || version != LOG_VERSION)
+		return false;
+
+	// read the whole log up front so replaying never touches the disk
+	frames_.clear();
+	currentFrame_ = 0;
+
+	float values[6];
+	unsigned char flags;
+
+	while (input.read((char*)values, sizeof(values)) && input.read((char*)&flags, sizeof(flags))) {
+		FrameInput frame;
+		frame.Player.MoveX =			values[0];
+		frame.Player.MoveZ =			values[1];
+		frame.Player.HorizontalSpeed =	values[2];
+		frame.MoveY =					values[3];
+		frame.MouseDelta =				XMFLOAT2(values[4], values[5]);
+		frame.Player.IsJumping =		(flags & FLAG_JUMP) != 0;
+		frame.SwapCamera =				(flags & FLAG_SWAP_CAMERA) != 0;
+
+		frames_.push_back(frame);
+	}
+
+	replaying_ = true;
+	return true;
+}
+
+void InputRecorder::Stop()
+{
+	if (output_.is_open()) output_.close();
+
+	recording_ = false;
+	replaying_ = false;
+}
+
+void InputRecorder::Record(const FrameInput& input)
+{
+	if (!recording_) return;
+
+	float values[6] = {
+		input.Player.MoveX,
+		input.Player.MoveZ,
+		input.Player.HorizontalSpeed,
+		input.MoveY,
+		input.MouseDelta.x,
+		input.MouseDelta.y
+	};
+
+	unsigned char flags = 0;
+	if (input.Player.IsJumping)	flags |= FLAG_JUMP;
+	if (input.SwapCamera)		flags |= FLAG_SWAP_CAMERA;
+
+	output_.write((const char*)values, sizeof(values));
+	output_.write((const char*)&flags, sizeof(flags));
+}
+
+bool InputRecorder::NextFrame(FrameInput& input)
+{
+	if (!replaying_ || currentFrame_ >= frames_.size()) return false;
+
+	input = frames_[currentFrame_++];
+	return true;
+}
+
+// === checksums === //
+
+static void HashBytes(unsigned long long& hash, const void* data, size_t size)
+{
+	// 64-bit FNV-1a
+	const unsigned char* bytes = (const unsigned char*)data;
+	for (size_t i = 0; i < size; i++) {
+		hash ^= bytes[i];
+		hash *= 1099511628211ULL;
+	}
+}
+
+static void HashNode(unsigned long long& hash, SceneNodePointer node)
+{
+	XMFLOAT4 values[3];
+	XMStoreFloat4(&values[0], node->GetTransform()->GetPosition());
+	XMStoreFloat4(&values[1], node->GetTransform()->GetRotation());
+	XMStoreFloat4(&values[2], node->GetTransform()->GetScale());
+
+	HashBytes(hash, values, sizeof(values));
+
+	SceneGraphPointer graph = std::dynamic_pointer_cast<SceneGraph>(node);
+	if (graph == nullptr) return;
+
+	for (size_t i = 0; i < graph->GetChildCount(); i++) {
+		HashNode(hash, graph->GetChild(i));
+	}
+}
+
+unsigned long long ComputeSceneChecksum(SceneNodePointer node)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	HashNode(hash, node);
+	return hash;
+}
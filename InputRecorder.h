@@ -0,0 +1,54 @@
+#pragma once
+#include "DirectXCore.h"
+#include "SceneGraph.h"
+#include "PlayerNode.h"
+#include <vector>
+#include <fstream>
+
+// Everything the game reads from the player in a single frame. This is
+// what gets recorded and what gets fed back in when replaying, so any
+// new input the game responds to needs to go through here.
+struct FrameInput {
+	PlayerControlState	Player;
+	float				MoveY;
+	XMFLOAT2			MouseDelta;
+	bool				SwapCamera;
+};
+
+// Records per-frame input (plus the seed used to lay out the scene) to a
+// compact binary log, and plays it back again. Replays are deterministic,
+// so two runs over the same log should end with the same scene checksum.
+
+class InputRecorder
+{
+public:
+	InputRecorder();
+	~InputRecorder();
+
+	bool					StartRecording(std::wstring path, unsigned int seed);
+	bool					StartReplay(std::wstring path);
+	void					Stop();
+
+	void					Record(const FrameInput& input);
+
+	// returns false once the log has run out
+	bool					NextFrame(FrameInput& input);
+
+	inline bool				IsRecording() const		{ return recording_; }
+	inline bool				IsReplaying() const		{ return replaying_; }
+	inline unsigned int		GetSeed() const			{ return seed_; }
+	inline size_t			GetFrameCount() const	{ return frames_.size(); }
+
+private:
+	bool					recording_ = false;
+	bool					replaying_ = false;
+	unsigned int			seed_ = 0;
+
+	std::ofstream			output_;
+
+	std::vector<FrameInput>	frames_;
+	size_t					currentFrame_ = 0;
+};
+
+// hashes every node's transform, for comparing the end state of two runs
+unsigned long long			ComputeSceneChecksum(SceneNodePointer node);
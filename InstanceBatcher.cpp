@@ -0,0 +1,60 @@
+#include "InstanceBatcher.h"
+
+InstanceBatcher::InstanceBatcher()
+{
+}
+
+InstanceBatcher::~InstanceBatcher()
+{
+}
+
+void InstanceBatcher::Clear()
+{
+	groupIndices_.clear();
+	groups_.clear();
+	pending_.clear();
+	instances_.clear();
+}
+
+void InstanceBatcher::Add(Renderer* owner, Mesh* model, unsigned int lod, FXMMATRIX world)
+{
+	unsigned int group;
+	GroupKey key = { model, lod };
+
+	auto found = groupIndices_.find(key);
+	if (found == groupIndices_.end()) {
+		group = (unsigned int)groups_.size();
+		groupIndices_[key] = group;
+		groups_.push_back({ owner, model, lod, 0, 0 });
+	}
+	else {
+		group = found->second;
+	}
+
+	groups_[group].Count++;
+
+	Pending instance;
+	instance.Group = group;
+	XMStoreFloat4x4(&instance.World, world);
+	pending_.push_back(instance);
+}
+
+void InstanceBatcher::Build()
+{
+	// a counting sort. groups already know their sizes, so lay them out
+	// one after another, then drop every instance into its group's space.
+	cursors_.resize(groups_.size());
+
+	unsigned int start = 0;
+	for (size_t i = 0; i < groups_.size(); i++) {
+		groups_[i].Start = start;
+		cursors_[i] = start;
+		start += groups_[i].Count;
+	}
+
+	instances_.resize(pending_.size());
+
+	for (const Pending& instance : pending_) {
+		instances_[cursors_[instance.Group]++] = instance.World;
+	}
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <DirectXMath.h>
+#include <vector>
+#include <unordered_map>
+
+using namespace DirectX;
+
+class Renderer;
+class Mesh;
+
+// Groups every instance of the same mesh queued in a frame, and packs
+// their world matrices into one array with each group's instances next
+// to each other, ready to be uploaded as a single instance buffer.
+//
+// None of this touches the device, and it only needs DirectXMath, so it
+// can be built and timed on its own.
+
+struct InstanceGroup {
+	Renderer*			Owner;
+	Mesh*				Model;
+	unsigned int		Lod;
+	unsigned int		Start;		// first instance in the packed array
+	unsigned int		Count;
+};
+
+class InstanceBatcher
+{
+public:
+	InstanceBatcher();
+	~InstanceBatcher();
+
+	// forget last frame's instances, keeping the memory they used
+	void				Clear();
+
+	// a mesh is always drawn by the same renderer, so it and the level of
+	// detail it's drawn at decide the group
+	void				Add(Renderer* owner, Mesh* model, unsigned int lod, FXMMATRIX world);
+
+	// sort everything added since Clear into its group
+	void				Build();
+
+	inline const std::vector<InstanceGroup>&	GetGroups() const { return groups_; }
+	inline const std::vector<XMFLOAT4X4>&		GetInstances() const { return instances_; }
+
+private:
+	struct Pending {
+		unsigned int	Group;
+		XMFLOAT4X4		World;
+	};
+
+	struct GroupKey {
+		const Mesh*		Model;
+		unsigned int	Lod;
+
+		bool operator==(const GroupKey& other) const { return Model == other.Model && Lod == other.Lod; }
+	};
+
+	struct GroupKeyHash {
+		size_t operator()(const GroupKey& key) const { return std::hash<const Mesh*>()(key.Model) ^ ((size_t)key.Lod * 0x9e3779b9); }
+	};
+
+	std::unordered_map<GroupKey, unsigned int, GroupKeyHash>	groupIndices_;
+	std::vector<InstanceGroup>	groups_;
+	std::vector<Pending>		pending_;
+	std::vector<XMFLOAT4X4>		instances_;
+	std::vector<unsigned int>	cursors_;
+};
@@ -0,0 +1,433 @@
+#include "JobSystem.h"
+
+// which queue belongs to the current thread. -1 for threads that aren't
+// part of the job system.
+static thread_local int currentWorker_ = -1;
+
+// each deque starts with room for this many jobs, and doubles when full
+static const long long QUEUE_CAPACITY = 256;
+
+// how many times Wait checks again before going to sleep
+static const int WAIT_SPINS = 64;
+
+// === work queue === //
+
+class JobSystem::WorkQueue
+{
+public:
+	WorkQueue() : top_(0), bottom_(0) { buffer_ = new Buffer(QUEUE_CAPACITY); }
+
+	~WorkQueue()
+	{
+		delete buffer_.load();
+
+		for (auto&& buffer : retired_) {
+			delete buffer;
+		}
+	}
+
+	// owner only
+	void Push(const QueuedJob& job)
+	{
+		long long bottom = bottom_.load(std::memory_order_relaxed);
+		long long top = top_.load(std::memory_order_acquire);
+		Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+
+		if (bottom - top >= buffer->Capacity) buffer = Grow(buffer, top, bottom);
+
+		buffer->Store(bottom, job);
+		std::atomic_thread_fence(std::memory_order_release);
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+	}
+
+	// owner only. takes the newest job.
+	bool Pop(QueuedJob& job)
+	{
+		long long bottom = bottom_.load(std::memory_order_relaxed) - 1;
+		Buffer* buffer = buffer_.load(std::memory_order_relaxed);
+		bottom_.store(bottom, std::memory_order_relaxed);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long top = top_.load(std::memory_order_relaxed);
+
+		if (top > bottom) {
+			// already empty
+			bottom_.store(bottom + 1, std::memory_order_relaxed);
+			return false;
+		}
+
+		job = buffer->Load(bottom);
+		if (top < bottom) return true;
+
+		// the last job, so we have to race any thieves for it
+		bool won = top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+		bottom_.store(bottom + 1, std::memory_order_relaxed);
+		return won;
+	}
+
+	// anyone. takes the oldest job, and fails if another thread got to
+	// it first.
+	bool Steal(QueuedJob& job)
+	{
+		long long top = top_.load(std::memory_order_acquire);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		long long bottom = bottom_.load(std::memory_order_acquire);
+
+		if (top >= bottom) return false;
+
+		// the slot may be overwritten as we read it, but then the owner
+		// has already moved top on and the exchange fails
+		job = buffer_.load(std::memory_order_acquire)->Load(top);
+		return top_.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+	}
+
+private:
+	// a ring of jobs. every field is atomic so a thief reading a slot
+	// the owner is writing isn't a data race, only a wasted read.
+	struct Slot {
+		std::atomic<JobFunction>	Function;
+		std::atomic<void*>			Data;
+		std::atomic<size_t>			Begin;
+		std::atomic<size_t>			End;
+		std::atomic<JobCounter*>	Counter;
+	};
+
+	struct Buffer {
+		Buffer(long long capacity) : Capacity(capacity), Slots(new Slot[capacity]) {}
+		~Buffer() { delete[] Slots; }
+
+		void Store(long long index, const QueuedJob& job)
+		{
+			Slot& slot = Slots[index & (Capacity - 1)];
+			slot.Function.store(job.Work.Function, std::memory_order_relaxed);
+			slot.Data.store(job.Work.Data, std::memory_order_relaxed);
+			slot.Begin.store(job.Work.Begin, std::memory_order_relaxed);
+			slot.End.store(job.Work.End, std::memory_order_relaxed);
+			slot.Counter.store(job.Counter, std::memory_order_relaxed);
+		}
+
+		QueuedJob Load(long long index) const
+		{
+			const Slot& slot = Slots[index & (Capacity - 1)];
+
+			QueuedJob job;
+			job.Work.Function = slot.Function.load(std::memory_order_relaxed);
+			job.Work.Data = slot.Data.load(std::memory_order_relaxed);
+			job.Work.Begin = slot.Begin.load(std::memory_order_relaxed);
+			job.Work.End = slot.End.load(std::memory_order_relaxed);
+			job.Counter = slot.Counter.load(std::memory_order_relaxed);
+			return job;
+		}
+
+		long long	Capacity;
+		Slot*		Slots;
+	};
+
+	// thieves may still be reading the old buffer, so it's kept until
+	// the queue goes away
+	Buffer* Grow(Buffer* buffer, long long top, long long bottom)
+	{
+		Buffer* grown = new Buffer(buffer->Capacity * 2);
+		for (long long i = top; i < bottom; i++) {
+			grown->Store(i, buffer->Load(i));
+		}
+
+		retired_.push_back(buffer);
+		buffer_.store(grown, std::memory_order_release);
+		return grown;
+	}
+
+	// kept a cache line apart, since thieves hammer top and the owner
+	// hammers bottom
+	std::atomic<long long>				top_;
+	char								topPadding_[64];
+	std::atomic<long long>				bottom_;
+	std::atomic<Buffer*>				buffer_;
+	std::vector<Buffer*>				retired_;
+};
+
+JobSystem::JobSystem(unsigned int workerCount) :
+	mainPending_(0),
+	sleepers_(0),
+	waiters_(0),
+	pendingJobs_(0),
+	quit_(false),
+	jobsRun_(0),
+	jobsStolen_(0)
+{
+	if (workerCount == 0) {
+		unsigned int hardwareThreads = std::thread::hardware_concurrency();
+		workerCount = (hardwareThreads > 1) ? hardwareThreads - 1 : 1;
+	}
+
+	mainThreadId_ = std::this_thread::get_id();
+	currentWorker_ = 0;
+
+	// queue 0 belongs to the main thread
+	for (unsigned int i = 0; i <= workerCount; i++) {
+		queues_.push_back(new WorkQueue());
+	}
+
+	for (unsigned int i = 1; i <= workerCount; i++) {
+		threads_.push_back(std::thread(&JobSystem::WorkerLoop, this, i));
+	}
+}
+
+JobSystem::~JobSystem()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+		quit_ = true;
+	}
+	wakeUp_.notify_all();
+
+	for (auto&& thread : threads_) {
+		thread.join();
+	}
+
+	for (auto&& queue : queues_) {
+		delete queue;
+	}
+}
+
+bool JobSystem::IsMainThread() const
+{
+	return std::this_thread::get_id() == mainThreadId_;
+}
+
+// === submission === //
+
+void JobSystem::Run(const Job& job, JobCounter* counter, JobCounter* dependency)
+{
+	if (counter != nullptr) counter->count_.fetch_add(1, std::memory_order_relaxed);
+
+	if (dependency != nullptr) {
+		std::lock_guard<std::mutex> lock(dependency->mutex_);
+
+		// checked under the lock, so we can't miss the counter finishing
+		if (!dependency->IsDone()) {
+			dependency->continuations_.push_back({ job, counter, false });
+			return;
+		}
+	}
+
+	Submit(job, counter, false);
+}
+
+void JobSystem::RunOnMainThread(const Job& job, JobCounter* counter, JobCounter* dependency)
+{
+	if (counter != nullptr) counter->count_.fetch_add(1, std::memory_order_relaxed);
+
+	if (dependency != nullptr) {
+		std::lock_guard<std::mutex> lock(dependency->mutex_);
+
+		if (!dependency->IsDone()) {
+			dependency->continuations_.push_back({ job, counter, true });
+			return;
+		}
+	}
+
+	Submit(job, counter, true);
+}
+
+void JobSystem::ParallelFor(size_t count, size_t batchSize, JobFunction function, void* data, JobCounter* counter)
+{
+	if (batchSize == 0) batchSize = 1;
+
+	for (size_t begin = 0; begin < count; begin += batchSize) {
+		size_t end = (begin + batchSize < count) ? begin + batchSize : count;
+		Run({ function, data, begin, end }, counter);
+	}
+}
+
+void JobSystem::Submit(const Job& job, JobCounter* counter, bool mainThread)
+{
+	QueuedJob queued;
+	queued.Work = job;
+	queued.Counter = counter;
+
+	Push(queued, mainThread);
+}
+
+void JobSystem::Push(const QueuedJob& job, bool mainThread)
+{
+	if (mainThread) {
+		{
+			std::lock_guard<std::mutex> lock(mainMutex_);
+			mainJobs_.push_back(job);
+		}
+
+		// only the main thread can run it, and it only sleeps in Wait
+		mainPending_.fetch_add(1);
+		if (waiters_.load() > 0) WakeSleepers(true);
+		return;
+	}
+
+	// our own queue if we have one, otherwise the shared one
+	if (currentWorker_ >= 0) {
+		queues_[currentWorker_]->Push(job);
+	}
+	else {
+		std::lock_guard<std::mutex> lock(sharedMutex_);
+		sharedJobs_.push_back(job);
+	}
+
+	pendingJobs_.fetch_add(1);
+	WakeSleepers(false);
+}
+
+void JobSystem::WakeSleepers(bool all)
+{
+	// sleepers count themselves in before they check whether there's
+	// anything to do, and we've already made there be something, so if
+	// this misses them they'll see it anyway
+	if (sleepers_.load() == 0) return;
+
+	// taking the lock means no one can be between checking and sleeping
+	{
+		std::lock_guard<std::mutex> lock(sleepMutex_);
+	}
+
+	if (all)	wakeUp_.notify_all();
+	else		wakeUp_.notify_one();
+}
+
+// === execution === //
+
+bool JobSystem::TryRunOne(int workerIndex)
+{
+	QueuedJob job;
+	bool found = false;
+
+	// newest first from our own queue, while it's still warm in cache
+	if (workerIndex >= 0) found = queues_[workerIndex]->Pop(job);
+
+	// otherwise steal the oldest job from someone else
+	unsigned int queueCount = (unsigned int)queues_.size();
+	unsigned int first = (workerIndex >= 0) ? (unsigned int)workerIndex + 1 : 0;
+
+	for (unsigned int i = 0; !found && i < queueCount; i++) {
+		unsigned int victim = (first + i) % queueCount;
+		if ((int)victim == workerIndex) continue;
+
+		if (queues_[victim]->Steal(job)) {
+			found = true;
+			jobsStolen_.fetch_add(1, std::memory_order_relaxed);
+		}
+	}
+
+	// and last of all, anything queued from outside
+	if (!found) {
+		std::lock_guard<std::mutex> lock(sharedMutex_);
+
+		if (!sharedJobs_.empty()) {
+			job = sharedJobs_.front();
+			sharedJobs_.pop_front();
+			found = true;
+		}
+	}
+
+	if (!found) return false;
+
+	pendingJobs_.fetch_sub(1, std::memory_order_relaxed);
+	Execute(job);
+	return true;
+}
+
+void JobSystem::Execute(const QueuedJob& job)
+{
+	job.Work.Function(job.Work.Data, job.Work.Begin, job.Work.End);
+	jobsRun_.fetch_add(1, std::memory_order_relaxed);
+
+	if (job.Counter != nullptr) Finish(job.Counter);
+}
+
+void JobSystem::Finish(JobCounter* counter)
+{
+	std::vector<JobCounter::PendingJob> released;
+	{
+		// the decrement happens under the lock, so that dependencies can't
+		// slip in after the last job and so the counter can't be destroyed
+		// while we're still using it
+		std::lock_guard<std::mutex> lock(counter->mutex_);
+		if (counter->count_.fetch_sub(1) != 1) return;
+
+		// we were the last job, so release anything that was waiting on us
+		released.swap(counter->continuations_);
+	}
+
+	// the counter may be gone as soon as the lock is dropped, but anyone
+	// asleep waiting on it needs to know
+	if (waiters_.load() > 0) WakeSleepers(true);
+
+	for (auto&& pending : released) {
+		Submit(pending.Work, pending.Counter, pending.MainThread);
+	}
+}
+
+void JobSystem::Wait(JobCounter* counter)
+{
+	// threads outside the system have no queue of their own, so can only steal
+	int workerIndex = currentWorker_;
+	bool mainThread = IsMainThread();
+	int spins = 0;
+
+	while (!counter->IsDone()) {
+		// main thread jobs might be what we're waiting on
+		if (mainThread && mainPending_.load(std::memory_order_relaxed) > 0) PumpMainThread();
+
+		if (TryRunOne(workerIndex)) {
+			spins = 0;
+			continue;
+		}
+
+		// the last few jobs are probably running elsewhere and about to
+		// finish, so check again a few times before going to sleep
+		if (spins++ < WAIT_SPINS) {
+			std::this_thread::yield();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleepMutex_);
+		sleepers_.fetch_add(1);
+		waiters_.fetch_add(1);
+
+		wakeUp_.wait(lock, [&] {
+			return counter->count_.load() == 0
+				|| pendingJobs_.load() > 0
+				|| (mainThread && mainPending_.load() > 0);
+		});
+
+		waiters_.fetch_sub(1);
+		sleepers_.fetch_sub(1);
+		spins = 0;
+	}
+}
+
+void JobSystem::PumpMainThread()
+{
+	std::deque<QueuedJob> jobs;
+	{
+		std::lock_guard<std::mutex> lock(mainMutex_);
+		jobs.swap(mainJobs_);
+	}
+
+	mainPending_.fetch_sub((int)jobs.size());
+
+	for (auto&& job : jobs) {
+		Execute(job);
+	}
+}
+
+void JobSystem::WorkerLoop(unsigned int workerIndex)
+{
+	currentWorker_ = (int)workerIndex;
+
+	while (!quit_) {
+		if (TryRunOne((int)workerIndex)) continue;
+
+		std::unique_lock<std::mutex> lock(sleepMutex_);
+		sleepers_.fetch_add(1);
+		wakeUp_.wait(lock, [this] { return quit_ || pendingJobs_.load() > 0; });
+		sleepers_.fetch_sub(1);
+	}
+}
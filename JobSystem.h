@@ -0,0 +1,142 @@
+#pragma once
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+// A job runs Function over the range [Begin, End). Data is whatever the
+// function needs, and has to outlive the job.
+typedef void (*JobFunction)(void* data, size_t begin, size_t end);
+
+struct Job {
+	JobFunction		Function;
+	void*			Data;
+	size_t			Begin;
+	size_t			End;
+};
+
+class JobSystem;
+
+// Counts jobs that haven't finished yet. Wait on one to join a batch of
+// jobs, or pass one as a dependency to hold jobs back until it's done.
+// Counters must outlive every job that refers to them.
+
+class JobCounter
+{
+public:
+	JobCounter() : count_(0) {}
+
+	// waits for the last job to let go of us
+	~JobCounter() { std::lock_guard<std::mutex> lock(mutex_); }
+
+	inline bool				IsDone() const { return count_.load(std::memory_order_acquire) == 0; }
+
+private:
+	friend class JobSystem;
+
+	struct PendingJob {
+		Job					Work;
+		JobCounter*			Counter;
+		bool				MainThread;
+	};
+
+	std::atomic<int>		count_;
+
+	// jobs waiting on this counter to reach zero
+	std::mutex				mutex_;
+	std::vector<PendingJob>	continuations_;
+};
+
+// Work-stealing job system. Every worker owns a deque: it takes work from
+// the back of its own and steals from the front of everyone else's. The
+// main thread counts as worker 0, but only runs jobs while it's waiting.
+// Jobs that have to stay on the main thread go on a separate queue that
+// is pumped once a frame.
+//
+// The deques are Chase-Lev deques ("Dynamic Circular Work-Stealing
+// Deque", with the memory orderings from Le et al.), so pushing, popping
+// and stealing never take a lock. Only the owner may push or pop, so jobs
+// queued from threads outside the system go on a shared, locked queue
+// that workers check after trying to steal. Idle workers, and threads
+// waiting on a counter with nothing left to run, sleep on a condition
+// variable, which is only signalled if someone is actually asleep.
+
+class JobSystem
+{
+public:
+	// zero picks one worker per hardware thread, less the main thread
+	JobSystem(unsigned int workerCount = 0);
+	~JobSystem();
+
+	// queue a job. counter is optional, and dependency holds the job back
+	// until that counter is done.
+	void					Run(const Job& job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+	// queue a job that will only ever run on the main thread
+	void					RunOnMainThread(const Job& job, JobCounter* counter = nullptr, JobCounter* dependency = nullptr);
+
+	// split [0, count) into batches of batchSize and run them in parallel
+	void					ParallelFor(size_t count, size_t batchSize, JobFunction function, void* data, JobCounter* counter);
+
+	// run jobs until the counter is done, rather than sitting idle. once
+	// there's nothing left to run, sleeps until the counter is done or
+	// more work arrives.
+	void					Wait(JobCounter* counter);
+
+	// run everything queued for the main thread. call from the main thread.
+	void					PumpMainThread();
+
+	inline unsigned int		GetWorkerCount() const { return (unsigned int)queues_.size(); }
+	bool					IsMainThread() const;
+
+	// totals since startup, for profiling
+	inline unsigned long long	GetJobsRun() const		{ return jobsRun_.load(); }
+	inline unsigned long long	GetJobsStolen() const	{ return jobsStolen_.load(); }
+
+private:
+	struct QueuedJob {
+		Job					Work;
+		JobCounter*			Counter;
+	};
+
+	// a lock-free deque for one worker, defined in JobSystem.cpp
+	class WorkQueue;
+
+	void					Submit(const Job& job, JobCounter* counter, bool mainThread);
+	void					Push(const QueuedJob& job, bool mainThread);
+	// workerIndex is -1 for threads that can only steal
+	bool					TryRunOne(int workerIndex);
+	void					Execute(const QueuedJob& job);
+	void					Finish(JobCounter* counter);
+	void					WorkerLoop(unsigned int workerIndex);
+
+	// wakes sleepers, if there are any. all of them if waiters need to
+	// recheck their counters, otherwise one to pick up a new job.
+	void					WakeSleepers(bool all);
+
+	std::vector<WorkQueue*>		queues_;
+	std::vector<std::thread>	threads_;
+	std::thread::id				mainThreadId_;
+
+	// jobs that can only run on the main thread, and jobs queued by
+	// threads that don't own a deque
+	std::mutex					mainMutex_;
+	std::deque<QueuedJob>		mainJobs_;
+	std::atomic<int>			mainPending_;
+	std::mutex					sharedMutex_;
+	std::deque<QueuedJob>		sharedJobs_;
+
+	// idle workers and waiters sleep here until there's something to do.
+	// sleepers_ counts both, waiters_ just the waiters.
+	std::mutex					sleepMutex_;
+	std::condition_variable		wakeUp_;
+	std::atomic<int>			sleepers_;
+	std::atomic<int>			waiters_;
+	std::atomic<int>			pendingJobs_;
+	std::atomic<bool>			quit_;
+
+	std::atomic<unsigned long long>	jobsRun_;
+	std::atomic<unsigned long long>	jobsStolen_;
+};
@@ -0,0 +1,80 @@
+#include "MemoryPool.h"
+#include <cstdint>
+
+void* AllocateAligned(size_t size, size_t alignment)
+{
+	if (alignment < sizeof(void*)) alignment = sizeof(void*);
+
+	// room to slide forward to the alignment, with the pointer we really
+	// got from the heap stashed just in front
+	char* memory = (char*)::operator new(size + alignment + sizeof(void*));
+
+	uintptr_t start = (uintptr_t)(memory + sizeof(void*));
+	uintptr_t aligned = (start + alignment - 1) & ~(uintptr_t)(alignment - 1);
+
+	((void**)aligned)[-1] = memory;
+	return (void*)aligned;
+}
+
+void FreeAligned(void* memory)
+{
+	if (memory == nullptr) return;
+
+	::operator delete(((void**)memory)[-1]);
+}
+
+BlockPool::BlockPool(size_t blockSize, size_t alignment, size_t blocksPerChunk) :
+	blockSize_(blockSize),
+	alignment_(alignment),
+	blocksPerChunk_(blocksPerChunk),
+	freeList_(nullptr),
+	liveCount_(0)
+{
+}
+
+BlockPool::~BlockPool()
+{
+	for (auto&& chunk : chunks_) {
+		FreeAligned(chunk);
+	}
+}
+
+void* BlockPool::Allocate()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	if (freeList_ == nullptr) AddChunk();
+
+	// free blocks store the next free block in their first bytes
+	void* block = freeList_;
+	freeList_ = *(void**)block;
+	liveCount_++;
+
+	return block;
+}
+
+void BlockPool::Free(void* block)
+{
+	if (block == nullptr) return;
+
+	std::lock_guard<std::mutex> lock(mutex_);
+
+	*(void**)block = freeList_;
+	freeList_ = block;
+	liveCount_--;
+}
+
+void BlockPool::AddChunk()
+{
+	// every block is a whole number of alignments in, so lining up the
+	// chunk lines them all up
+	char* chunk = (char*)AllocateAligned(blockSize_ * blocksPerChunk_, alignment_);
+	chunks_.push_back(chunk);
+
+	// thread the new blocks onto the free list, first block first
+	for (size_t i = blocksPerChunk_; i > 0; i--) {
+		void* block = chunk + (i - 1) * blockSize_;
+		*(void**)block = freeList_;
+		freeList_ = block;
+	}
+}
@@ -0,0 +1,96 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <mutex>
+#include <new>
+
+// heap memory aligned to any power of two, however large. operator new
+// only promises enough for the built in types, which isn't enough for
+// anything holding SIMD types or padded out to a cache line.
+void*		AllocateAligned(size_t size, size_t alignment);
+void		FreeAligned(void* memory);
+
+// Fixed-size block allocator. Memory comes from the heap in chunks and is
+// handed out from a free list, so allocating and freeing are both O(1) and
+// blocks of the same size end up packed together. Chunks are never given
+// back to the heap. blockSize has to be a multiple of alignment, and both
+// at least the size of a pointer.
+
+class BlockPool
+{
+public:
+	BlockPool(size_t blockSize, size_t alignment, size_t blocksPerChunk);
+	~BlockPool();
+
+	void*					Allocate();
+	void					Free(void* block);
+
+	inline size_t			GetBlockSize() const	{ return blockSize_; }
+	inline size_t			GetLiveCount() const	{ return liveCount_; }
+	inline size_t			GetChunkCount() const	{ return chunks_.size(); }
+
+private:
+	void					AddChunk();
+
+	std::mutex				mutex_;
+	size_t					blockSize_;
+	size_t					alignment_;
+	size_t					blocksPerChunk_;
+	std::vector<char*>		chunks_;
+	void*					freeList_;
+	size_t					liveCount_;
+};
+
+const size_t POOL_BLOCKS_PER_CHUNK = 256;
+
+// One pool per block size and alignment, shared by every type that fits.
+// Pools are deliberately never destroyed, as shared pointers held by
+// globals can still be released after static destructors have run.
+template<size_t Size, size_t Alignment>
+BlockPool& GetBlockPool()
+{
+	static const size_t unit = (Alignment > sizeof(void*)) ? Alignment : sizeof(void*);
+	static BlockPool* pool = new BlockPool(((Size + unit - 1) / unit) * unit, unit, POOL_BLOCKS_PER_CHUNK);
+	return *pool;
+}
+
+// Standard allocator on top of the block pools. Handing it to
+// std::allocate_shared puts the object and its reference counts in a
+// single pooled block.
+template<typename T>
+class PoolAllocator
+{
+public:
+	typedef T value_type;
+
+	PoolAllocator() {}
+	template<typename U> PoolAllocator(const PoolAllocator<U>&) {}
+
+	T* allocate(size_t count)
+	{
+		// only single objects are pooled
+		if (count != 1) return (T*)AllocateAligned(count * sizeof(T), alignof(T));
+
+		return (T*)GetBlockPool<sizeof(T), alignof(T)>().Allocate();
+	}
+
+	void deallocate(T* pointer, size_t count)
+	{
+		if (count != 1) {
+			FreeAligned(pointer);
+			return;
+		}
+
+		GetBlockPool<sizeof(T), alignof(T)>().Free(pointer);
+	}
+
+	template<typename U> bool operator==(const PoolAllocator<U>&) const { return true; }
+	template<typename U> bool operator!=(const PoolAllocator<U>&) const { return false; }
+};
+
+// make_shared, but from the pools
+template<typename T, typename... Arguments>
+std::shared_ptr<T> MakePooled(Arguments&&... arguments)
+{
+	return std::allocate_shared<T>(PoolAllocator<T>(), std::forward<Arguments>(arguments)...);
+}
@@ -1,8 +1,9 @@
 #include "Mesh.h"
+#include <algorithm>
 
 // Material methods
 
-Material::Material(std::wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, ComPtr<ID3D11ShaderResourceView> texture )
+Material::Material(NameId materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, ComPtr<ID3D11ShaderResourceView> texture )
 {
 	materialName_ =		materialName;
 	diffuseColour_ =	diffuseColour;
@@ -16,18 +17,41 @@ Material::~Material(void)
 {
 }
 
+void Material::BuildConstantBuffer(ComPtr<ID3D11Device> device)
+{
+	MaterialConstants constants;
+	constants.DiffuseCoefficient = diffuseColour_;
+	constants.SpecularCoefficient = specularColour_;
+	constants.Shininess = shininess_;
+	constants.Opacity = opacity_;
+	constants.Padding[0] = 0.0f;
+	constants.Padding[1] = 0.0f;
+
+	D3D11_BUFFER_DESC bufferDesc;
+	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.ByteWidth = sizeof(MaterialConstants);
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA initialisationData;
+	ZeroMemory(&initialisationData, sizeof(initialisationData));
+	initialisationData.pSysMem = &constants;
+
+	ThrowIfFailed(device->CreateBuffer(&bufferDesc, &initialisationData, constantBuffer_.GetAddressOf()));
+}
+
 // SubMesh methods
 
 SubMesh::SubMesh(
-		ComPtr<ID3D11Buffer> vertexBuffer,
-		ComPtr<ID3D11Buffer> indexBuffer,
+		std::shared_ptr<GeometryPool> pool,
+		GeometryAllocation geometry,
 		size_t vertexCount,
 		size_t indexCount,
 		std::shared_ptr<Material> material
 )
 {
-	vertexBuffer_ =		vertexBuffer;
-	indexBuffer_ =		indexBuffer;
+	pool_ =				pool;
+	geometry_ =			geometry;
 	vertexCount_ =		vertexCount;
 	indexCount_ =		indexCount;
 	material_ =			material;
@@ -35,6 +59,35 @@ SubMesh::SubMesh(
 
 SubMesh::~SubMesh(void)
 {
+	pool_->Remove(geometry_);
+
+	for (const SubMeshLod& lod : lods_)
+	{
+		pool_->Remove(lod.Geometry);
+	}
+}
+
+void SubMesh::AddLod(GeometryAllocation geometry, size_t indexCount, float error)
+{
+	lods_.push_back({ geometry, indexCount, error });
+}
+
+UINT SubMesh::GetStartIndex(unsigned int lod)
+{
+	if (lod == 0 || lods_.empty()) return GetStartIndex();
+	return pool_->GetStartIndex(lods_[std::min<size_t>(lod, lods_.size()) - 1].Geometry);
+}
+
+size_t SubMesh::GetIndexCount(unsigned int lod)
+{
+	if (lod == 0 || lods_.empty()) return indexCount_;
+	return lods_[std::min<size_t>(lod, lods_.size()) - 1].IndexCount;
+}
+
+float SubMesh::GetLodError(unsigned int lod)
+{
+	if (lod == 0 || lods_.empty()) return 0.0f;
+	return lods_[std::min<size_t>(lod, lods_.size()) - 1].Error;
 }
 
 // Mesh methods
@@ -67,3 +120,82 @@ void Mesh::SetRootNode(std::shared_ptr<Node> node)
 {
 	rootNode_ = node;
 }
+
+void Mesh::SetBounds(const BoundingBox& bounds)
+{
+	boundingBox_ = bounds;
+	BoundingSphere::CreateFromBoundingBox(boundingSphere_, bounds);
+}
+
+void Mesh::Bake()
+{
+	draws_.clear();
+	if (rootNode_ != nullptr) BakeNode(rootNode_.get(), XMMatrixIdentity());
+
+	// opaque draws first, each pass keeping the order the tree gave it
+	auto transparent = std::stable_partition(draws_.begin(), draws_.end(), [](const MeshDraw& draw) {
+		return draw.Surface->GetOpacity() >= 1.0f;
+	});
+	opaqueCount_ = transparent - draws_.begin();
+
+	// each level's error is the worst of any draw at it, scaled up by
+	// however much the draw is
+	unsigned int lodCount = 1;
+	for (const MeshDraw& draw : draws_)
+	{
+		lodCount = std::max<unsigned int>(lodCount, draw.Geometry->GetLodCount());
+	}
+
+	lodErrors_.assign(lodCount, 0.0f);
+
+	for (const MeshDraw& draw : draws_)
+	{
+		XMMATRIX transformation = XMLoadFloat4x4(&draw.Transformation);
+		float scale = std::max<float>(XMVectorGetX(XMVector3Length(transformation.r[0])),
+			std::max<float>(XMVectorGetX(XMVector3Length(transformation.r[1])), XMVectorGetX(XMVector3Length(transformation.r[2]))));
+
+		for (unsigned int lod = 1; lod < lodErrors_.size(); lod++)
+		{
+			lodErrors_[lod] = std::max<float>(lodErrors_[lod], draw.Geometry->GetLodError(lod) * scale);
+		}
+	}
+
+	if (draws_.empty()) return;
+
+	// the bounds of everything as it's drawn, rather than as it's stored
+	BoundingBox bounds;
+	draws_[0].Geometry->GetBounds().Transform(bounds, XMLoadFloat4x4(&draws_[0].Transformation));
+
+	for (size_t i = 1; i < draws_.size(); i++)
+	{
+		BoundingBox drawBounds;
+		draws_[i].Geometry->GetBounds().Transform(drawBounds, XMLoadFloat4x4(&draws_[i].Transformation));
+		BoundingBox::CreateMerged(bounds, bounds, drawBounds);
+	}
+
+	SetBounds(bounds);
+}
+
+void Mesh::BakeNode(Node* node, FXMMATRIX parentTransformation)
+{
+	XMMATRIX transformation = node->GetTransformation() * parentTransformation;
+
+	unsigned int subMeshCount = (unsigned int)node->GetMeshCount();
+
+	for (unsigned int i = 0; i < subMeshCount; i++)
+	{
+		MeshDraw draw;
+		draw.Geometry = subMeshList_[node->GetMesh(i)].get();
+		draw.Surface = draw.Geometry->GetMaterial().get();
+		XMStoreFloat4x4(&draw.Transformation, transformation);
+
+		draws_.push_back(draw);
+	}
+
+	unsigned int childrenCount = (unsigned int)node->GetChildrenCount();
+
+	for (unsigned int i = 0; i < childrenCount; i++)
+	{
+		BakeNode(node->GetChild(i).get(), transformation);
+	}
+}
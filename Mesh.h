@@ -1,58 +1,107 @@
 #pragma once
-#include "core.h"
+#include "Core.h"
 #include "DirectXCore.h"
+#include "NameTable.h"
+#include "GeometryPool.h"
 #include <vector>
 
 // Core material class.  Ideally, this should be extended to include more material attributes that can be
 // recovered from Assimp, but this handles the basics.
 
+// what a material looks like to the mesh shaders
+struct MaterialConstants
+{
+	XMFLOAT4	DiffuseCoefficient;
+	XMFLOAT4	SpecularCoefficient;
+	float		Shininess;
+	float		Opacity;
+	float		Padding[2];
+};
+
 class Material
 {
 public:
-	Material(std::wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, ComPtr<ID3D11ShaderResourceView> texture );
+	Material(NameId materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, ComPtr<ID3D11ShaderResourceView> texture );
 	~Material();
 
-	inline std::wstring						GetMaterialName() { return materialName_;  }
+	inline const std::wstring&				GetMaterialName() { return NameTable::GetString(materialName_); }
+	inline NameId							GetMaterialId() { return materialName_; }
 	inline XMFLOAT4							GetDiffuseColour() { return diffuseColour_; }
 	inline XMFLOAT4							GetSpecularColour() { return specularColour_; }
 	inline float							GetShininess() { return shininess_; }
 	inline float							GetOpacity() { return opacity_; }
-	inline ComPtr<ID3D11ShaderResourceView>	GetTexture() { return texture_; }
+	inline const ComPtr<ID3D11ShaderResourceView>&	GetTexture() { return texture_; }
+
+	// materials never change, so their constants are uploaded once and
+	// kept in an immutable buffer
+	void									BuildConstantBuffer(ComPtr<ID3D11Device> device);
+	inline const ComPtr<ID3D11Buffer>&		GetConstantBuffer() { return constantBuffer_; }
 
 private:
-	std::wstring							materialName_;
+	NameId									materialName_;
 	XMFLOAT4								diffuseColour_;
 	XMFLOAT4								specularColour_;
 	float									shininess_;
 	float									opacity_;
     ComPtr<ID3D11ShaderResourceView>		texture_;
+	ComPtr<ID3D11Buffer>					constantBuffer_;
 };
 
 // Basic SubMesh class.  A Mesh consists of one or more sub-meshes.  The submesh provides everything that is needed to
-// draw the sub-mesh.
+// draw the sub-mesh.  Its vertices and indices live in a geometry pool shared with every other sub-mesh, and are
+// given back to it when the sub-mesh goes.
+//
+// Level of detail 0 is the sub-mesh as loaded. Each level after it is a simplified set of indices into the same
+// vertices, with the error it was allowed.
+
+struct SubMeshLod
+{
+	GeometryAllocation						Geometry;
+	size_t									IndexCount;
+	float									Error;
+};
 
 class SubMesh
 {
 public:
-	SubMesh(ComPtr<ID3D11Buffer> vertexBuffer,
-		ComPtr<ID3D11Buffer> indexBuffer,
+	SubMesh(std::shared_ptr<GeometryPool> pool,
+		GeometryAllocation geometry,
 		size_t vertexCount,
 		size_t indexCount,
 		std::shared_ptr<Material> material);
 	~SubMesh();
 
-	inline ComPtr<ID3D11Buffer>				GetVertexBuffer() { return vertexBuffer_; }
-	inline ComPtr<ID3D11Buffer>				GetIndexBuffer() { return indexBuffer_; }
+	// the pool's buffers, and where in them this sub-mesh is. these can
+	// change whenever geometry is added to the pool.
+	inline ID3D11Buffer*					GetVertexBuffer() { return pool_->GetVertexBuffer(); }
+	inline ID3D11Buffer*					GetIndexBuffer() { return pool_->GetIndexBuffer(); }
+	inline INT								GetBaseVertex() { return pool_->GetBaseVertex(geometry_); }
+	inline UINT								GetStartIndex() { return pool_->GetStartIndex(geometry_); }
 	inline std::shared_ptr<Material>		GetMaterial() { return material_; }
 	inline size_t							GetVertexCount() { return vertexCount_; }
 	inline size_t							GetIndexCount() { return indexCount_; }
 
+	// add the next level of detail. its geometry is only indices.
+	void									AddLod(GeometryAllocation geometry, size_t indexCount, float error);
+	inline unsigned int						GetLodCount() { return (unsigned int)lods_.size() + 1; }
+
+	// levels past the last one this sub-mesh has get the last one
+	UINT									GetStartIndex(unsigned int lod);
+	size_t									GetIndexCount(unsigned int lod);
+	float									GetLodError(unsigned int lod);
+
+	// bounds of the sub-mesh's own vertices
+	inline void								SetBounds(const BoundingBox& bounds) { bounds_ = bounds; }
+	inline const BoundingBox&				GetBounds() { return bounds_; }
+
 private:
-   	ComPtr<ID3D11Buffer>					vertexBuffer_;
-	ComPtr<ID3D11Buffer>					indexBuffer_;
+	std::shared_ptr<GeometryPool>			pool_;
+	GeometryAllocation						geometry_;
 	std::shared_ptr<Material>				material_;
 	size_t									vertexCount_;
 	size_t									indexCount_;
+	BoundingBox								bounds_;
+	std::vector<SubMeshLod>					lods_;
 };
 
 // The core Mesh class.  A Mesh corresponds to a scene in ASSIMP. A mesh consists of one or more sub-meshes.
@@ -60,8 +109,9 @@ private:
 class Node
 {
 public	:
-	inline void								SetName(std::wstring name) { name_ = name; }
-	inline std::wstring						GetName() { return name_; }
+	inline void								SetName(NameId name) { name_ = name; }
+	inline const std::wstring&				GetName() { return NameTable::GetString(name_); }
+	inline NameId							GetNameId() { return name_; }
 	inline size_t							GetMeshCount() { return meshIndices_.size(); }
 	inline unsigned int						GetMesh(unsigned int index) { return meshIndices_[index]; }
 	inline void								AddMesh(unsigned int meshIndex) { meshIndices_.push_back(meshIndex); }
@@ -69,12 +119,27 @@ public	:
 	inline std::shared_ptr<Node>			GetChild(unsigned int index) { return children_[index]; }
 	inline void								AddChild(std::shared_ptr<Node> node) { children_.push_back(node); }
 
+	// relative to the parent node
+	inline void								SetTransformation(FXMMATRIX transformation) { XMStoreFloat4x4(&transformation_, transformation); }
+	inline XMMATRIX							GetTransformation() { return XMLoadFloat4x4(&transformation_); }
+
 private:
-	std::wstring							name_;
+	NameId									name_ = NAME_NONE;
+	XMFLOAT4X4								transformation_ = XMFLOAT4X4(1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f);
 	std::vector<unsigned int>				meshIndices_;
 	std::vector<std::shared_ptr<Node>>		children_;
 };
 
+// One sub-mesh as it's drawn, placed by every node above it. Baked from
+// the node tree when the mesh is loaded, so drawing never has to walk it.
+
+struct MeshDraw
+{
+	SubMesh*								Geometry;
+	Material*								Surface;
+	XMFLOAT4X4								Transformation;
+};
+
 class Mesh
 {
 public:
@@ -84,9 +149,33 @@ public:
 	std::shared_ptr<Node>					GetRootNode();
 	void									SetRootNode(std::shared_ptr<Node> node);
 
+	// flatten the node tree into draws, opaque ones first, and fit the
+	// bounds around them. has to be redone if the tree changes.
+	void									Bake();
+	inline const std::vector<MeshDraw>&		GetDraws() { return draws_; }
+	inline size_t							GetOpaqueCount() { return opaqueCount_; }
+
+	// as many levels of detail as the most detailed sub-mesh has, and the
+	// most any draw strays from the original at each, once placed
+	inline unsigned int						GetLodCount() { return (unsigned int)lodErrors_.size(); }
+	inline float							GetLodError(unsigned int lod) { return lodErrors_[lod]; }
+
+	// bounds of every vertex in every sub-mesh, in model space
+	void									SetBounds(const BoundingBox& bounds);
+	inline const BoundingBox&				GetBoundingBox() { return boundingBox_; }
+	inline const BoundingSphere&			GetBoundingSphere() { return boundingSphere_; }
+
 private:
 	std::vector<std::shared_ptr<SubMesh>>	subMeshList_;
 	std::shared_ptr<Node>					rootNode_;
+	BoundingBox								boundingBox_;
+	BoundingSphere							boundingSphere_;
+
+	std::vector<MeshDraw>					draws_;
+	size_t									opaqueCount_ = 0;
+	std::vector<float>						lodErrors_;
+
+	void									BakeNode(Node* node, FXMMATRIX parentTransformation);
 };
 
 
@@ -1,4 +1,5 @@
 #include "MeshNode.h"
+#include <algorithm>
 
 bool MeshNode::Initialise()
 {
@@ -9,6 +10,9 @@ bool MeshNode::Initialise()
 	{
 		return false;
 	}
+
+	RegisterBounds();
+
 	return renderer_->Initialise();
 }
 
@@ -18,29 +22,86 @@ void MeshNode::Start()
 
 void MeshNode::Shutdown()
 {
+	UnregisterBounds();
 	resourceManager_->ReleaseMesh(modelName_);
 }
 
-void MeshNode::Render()
+void MeshNode::OnAttached()
+{
+	SceneNode::OnAttached();
+
+	// our transform handle has changed, so the culling entry has to follow.
+	// before Initialise there's no mesh to take bounds from.
+	if (mesh_ != nullptr) RegisterBounds();
+}
+
+void MeshNode::OnDetached()
+{
+	UnregisterBounds();
+	SceneNode::OnDetached();
+}
+
+void MeshNode::RegisterBounds()
+{
+	UnregisterBounds();
+	cullHandle_ = DirectXFramework::GetDXFramework()->GetCullingSystem()->Register(this, transformHandle_, mesh_->GetBoundingBox());
+}
+
+void MeshNode::UnregisterBounds()
 {
-	// grab useful references
-	std::shared_ptr<Camera> camera = DirectXFramework::GetDXFramework()->GetCamera();
-	std::shared_ptr<Lighting> lighting = DirectXFramework::GetDXFramework()->GetLighting();
+	if (cullHandle_ == INVALID_CULL_HANDLE) return;
 
-	XMFLOAT4 cameraPosition;
-	XMStoreFloat4(&cameraPosition, camera->GetCameraPosition());
+	DirectXFramework::GetDXFramework()->GetCullingSystem()->Unregister(cullHandle_);
+	cullHandle_ = INVALID_CULL_HANDLE;
+}
 
-	XMVECTOR lightDirection = XMLoadFloat4(&lighting->DirectionalLightVector);
+void MeshNode::Render()
+{
+	if (cullHandle_ != INVALID_CULL_HANDLE && !DirectXFramework::GetDXFramework()->GetCullingSystem()->IsVisible(cullHandle_)) return;
 
-	renderer_->SetMesh(mesh_);
-	renderer_->SetWorldTransformation(XMLoadFloat4x4(&combinedWorldTransformation_));
-	renderer_->SetCameraPosition(cameraPosition);
-	renderer_->SetAmbientLight(lighting->AmbientLight);
-	renderer_->SetDirectionalLight(
-		XMVector3InverseRotate(lightDirection, GetTransform()->GetRotation()),
-		lighting->DirectionalLightColor
-	);
+	XMMATRIX worldTransformation = GetCombinedWorldTransformation();
+	lod_ = SelectLod(worldTransformation);
 
-	renderer_->Render();
+	// drawn later, along with everything else the frame queued
+	renderer_->Queue(*DirectXFramework::GetDXFramework()->GetRenderQueue(), mesh_.get(), lod_, worldTransformation);
 }
 
+unsigned int MeshNode::SelectLod(FXMMATRIX worldTransformation)
+{
+	unsigned int lodCount = mesh_->GetLodCount();
+	if (lodCount <= 1) return 0;
+
+	DirectXFramework* framework = DirectXFramework::GetDXFramework();
+
+	// how many pixels one unit of the mesh covers, at the nearest point
+	// of its bounds
+	BoundingSphere bounds;
+	mesh_->GetBoundingSphere().Transform(bounds, worldTransformation);
+
+	XMVECTOR centre = XMLoadFloat3(&bounds.Center);
+	float distance = XMVectorGetX(XMVector3Length(centre - framework->GetCamera()->GetCameraPosition())) - bounds.Radius;
+	distance = std::max<float>(distance, 1.0f);
+
+	XMFLOAT4X4 projection;
+	XMStoreFloat4x4(&projection, framework->GetProjectionTransformation());
+
+	float scale = std::max<float>(XMVectorGetX(XMVector3Length(worldTransformation.r[0])),
+		std::max<float>(XMVectorGetX(XMVector3Length(worldTransformation.r[1])), XMVectorGetX(XMVector3Length(worldTransformation.r[2]))));
+	float pixelsPerUnit = scale * projection._22 * framework->GetHeight() * 0.5f / distance;
+
+	// step to finer levels while this one is well over, then coarser ones
+	// while the next is well under
+	unsigned int lod = std::min<unsigned int>(lod_, lodCount - 1);
+
+	while (lod > 0 && mesh_->GetLodError(lod) * pixelsPerUnit > MESH_LOD_PIXEL_ERROR * (1.0f + MESH_LOD_HYSTERESIS))
+	{
+		lod--;
+	}
+
+	while (lod + 1 < lodCount && mesh_->GetLodError(lod + 1) * pixelsPerUnit < MESH_LOD_PIXEL_ERROR * (1.0f - MESH_LOD_HYSTERESIS))
+	{
+		lod++;
+	}
+
+	return lod;
+}
@@ -7,18 +7,34 @@ class MeshNode : public SceneNode
 {
 public:
 public:
-	MeshNode(std::wstring name, std::wstring modelName) : SceneNode(name) { modelName_ = modelName; }
+	MeshNode(std::wstring name, std::wstring modelName) : SceneNode(name) { modelName_ = NameTable::Intern(modelName); }
+	MeshNode(NameId name, NameId modelName) : SceneNode(name) { modelName_ = modelName; }
 
 	bool Initialise();
 	void Start();
 	void Render();
 	void Shutdown();
 
+	void OnAttached();
+	void OnDetached();
+
+	inline NameId GetModelName() { return modelName_; }
+
 private:
+	void								RegisterBounds();
+	void								UnregisterBounds();
+
+	// the level of detail to draw at this frame, from how big the mesh
+	// is on screen and what it was drawn at last time
+	unsigned int						SelectLod(FXMMATRIX worldTransformation);
+
 	std::shared_ptr<MeshRenderer>		renderer_;
 
-	std::wstring						modelName_;
+	NameId								modelName_;
 	std::shared_ptr<ResourceManager>	resourceManager_;
 	std::shared_ptr<Mesh>				mesh_;
+
+	CullHandle							cullHandle_ = INVALID_CULL_HANDLE;
+	unsigned int						lod_ = 0;
 };
 
@@ -0,0 +1,367 @@
+#include "MeshOptimiser.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// a cluster is cut short wherever its own ACMR so far has dropped to this,
+// giving the overdraw sort more pieces to work with
+const float			OVERDRAW_SPLIT_ACMR =			0.8f;
+
+// and the sorted order is only kept if it costs less than this much ACMR
+const float			OVERDRAW_MAX_ACMR_INCREASE =	1.05f;
+
+const unsigned int	NO_VERTEX =						0xffffffff;
+
+MeshOptimiserStats OptimiseMesh(void* vertices, unsigned int vertexCount, unsigned int stride, std::vector<unsigned int>& indices)
+{
+	MeshOptimiserStats stats;
+	stats.VerticesBefore = vertexCount;
+	stats.Triangles = (unsigned int)indices.size() / 3;
+	stats.AcmrBefore = CalculateACMR(indices, vertexCount);
+
+	vertexCount = WeldVertices(vertices, vertexCount, stride, indices);
+
+	std::vector<unsigned int> clusters;
+	OptimiseVertexCache(indices, vertexCount, &clusters);
+	OptimiseOverdraw(indices, clusters, vertices, vertexCount, stride);
+
+	vertexCount = OptimiseVertexFetch(vertices, vertexCount, stride, indices);
+
+	stats.VerticesAfter = vertexCount;
+	stats.AcmrAfter = CalculateACMR(indices, vertexCount);
+	return stats;
+}
+
+// === welding === //
+
+static unsigned int HashVertex(const unsigned char* vertex, unsigned int stride)
+{
+	// FNV-1a
+	unsigned int hash = 2166136261u;
+	for (unsigned int i = 0; i < stride; i++) {
+		hash ^= vertex[i];
+		hash *= 16777619u;
+	}
+	return hash;
+}
+
+unsigned int WeldVertices(void* vertices, unsigned int vertexCount, unsigned int stride, std::vector<unsigned int>& indices)
+{
+	unsigned char* data = (unsigned char*)vertices;
+
+	// open addressing, kept under half full
+	unsigned int tableSize = 1;
+	while (tableSize < vertexCount * 2) tableSize *= 2;
+
+	std::vector<unsigned int> table(tableSize, NO_VERTEX);
+	std::vector<unsigned int> remap(vertexCount);
+	unsigned int unique = 0;
+
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		const unsigned char* vertex = data + (size_t)v * stride;
+		unsigned int slot = HashVertex(vertex, stride) & (tableSize - 1);
+
+		while (table[slot] != NO_VERTEX && memcmp(data + (size_t)table[slot] * stride, vertex, stride) != 0) {
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == NO_VERTEX) {
+			// everything before us has already been moved down, so this
+			// never overwrites anything still to be read
+			if (unique != v) memmove(data + (size_t)unique * stride, vertex, stride);
+			table[slot] = unique++;
+		}
+
+		remap[v] = table[slot];
+	}
+
+	for (unsigned int& index : indices) index = remap[index];
+
+	return unique;
+}
+
+// === vertex cache === //
+
+static unsigned int SkipDeadEnd(std::vector<unsigned int>& deadEnds, const std::vector<unsigned int>& liveTriangles, unsigned int& cursor)
+{
+	// the most recently used vertex with anything left
+	while (!deadEnds.empty()) {
+		unsigned int vertex = deadEnds.back();
+		deadEnds.pop_back();
+
+		if (liveTriangles[vertex] > 0) return vertex;
+	}
+
+	// otherwise the next one, in input order
+	while (cursor < liveTriangles.size()) {
+		if (liveTriangles[cursor] > 0) return cursor;
+		cursor++;
+	}
+
+	return NO_VERTEX;
+}
+
+void OptimiseVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, std::vector<unsigned int>* clusters)
+{
+	// Tipsify, from Sander, Nehab and Barczak's "Fast Triangle Reordering
+	// for Vertex Locality and Reduced Overdraw". we fan around one vertex
+	// at a time, then move on to whichever vertex touched by that fan will
+	// still be in the cache once its own triangles are drawn.
+	unsigned int triangleCount = (unsigned int)indices.size() / 3;
+
+	if (clusters != nullptr) clusters->clear();
+	if (triangleCount == 0) return;
+
+	// every vertex's triangles, packed one vertex after another
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	for (unsigned int index : indices) liveTriangles[index]++;
+
+	std::vector<unsigned int> offsets(vertexCount + 1, 0);
+	for (unsigned int v = 0; v < vertexCount; v++) offsets[v + 1] = offsets[v] + liveTriangles[v];
+
+	std::vector<unsigned int> adjacency(indices.size());
+	std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+	for (unsigned int t = 0; t < triangleCount; t++) {
+		for (unsigned int c = 0; c < 3; c++) adjacency[fill[indices[t * 3 + c]]++] = t;
+	}
+
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> deadEnds;
+	std::vector<unsigned int> candidates;
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	unsigned int time = VERTEX_CACHE_SIZE + 1;
+	unsigned int cursor = 0;
+	unsigned int fan = SkipDeadEnd(deadEnds, liveTriangles, cursor);
+
+	if (clusters != nullptr) clusters->push_back(0);
+
+	while (fan != NO_VERTEX) {
+		candidates.clear();
+
+		for (unsigned int a = offsets[fan]; a < offsets[fan + 1]; a++) {
+			unsigned int t = adjacency[a];
+			if (emitted[t]) continue;
+
+			for (unsigned int c = 0; c < 3; c++) {
+				unsigned int vertex = indices[t * 3 + c];
+
+				output.push_back(vertex);
+				deadEnds.push_back(vertex);
+				candidates.push_back(vertex);
+				liveTriangles[vertex]--;
+
+				if (time - cacheTime[vertex] > VERTEX_CACHE_SIZE) cacheTime[vertex] = time++;
+			}
+
+			emitted[t] = true;
+		}
+
+		// the candidate that'll still be cached after its own fan, and
+		// has been in the cache longest
+		unsigned int next = NO_VERTEX;
+		int best = -1;
+
+		for (unsigned int vertex : candidates) {
+			if (liveTriangles[vertex] == 0) continue;
+
+			int priority = 0;
+			if (time - cacheTime[vertex] + 2 * liveTriangles[vertex] <= VERTEX_CACHE_SIZE) priority = time - cacheTime[vertex];
+
+			if (priority > best) {
+				best = priority;
+				next = vertex;
+			}
+		}
+
+		if (next == NO_VERTEX) {
+			next = SkipDeadEnd(deadEnds, liveTriangles, cursor);
+
+			// a jump to somewhere unconnected starts a new cluster
+			if (next != NO_VERTEX && clusters != nullptr && output.size() / 3 != clusters->back()) {
+				clusters->push_back((unsigned int)output.size() / 3);
+			}
+		}
+
+		fan = next;
+	}
+
+	indices.swap(output);
+}
+
+// === overdraw === //
+
+void OptimiseOverdraw(std::vector<unsigned int>& indices, const std::vector<unsigned int>& clusters, const void* vertices, unsigned int vertexCount, unsigned int stride)
+{
+	unsigned int triangleCount = (unsigned int)indices.size() / 3;
+	if (triangleCount == 0 || clusters.empty()) return;
+
+	const unsigned char* data = (const unsigned char*)vertices;
+	auto position = [data, stride](unsigned int vertex) {
+		return (const float*)(data + (size_t)vertex * stride);
+	};
+
+	// split the clusters further wherever the cache has warmed up
+	std::vector<unsigned int> starts;
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int time = VERTEX_CACHE_SIZE + 1;
+
+	for (size_t c = 0; c < clusters.size(); c++) {
+		unsigned int end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+		unsigned int clusterMisses = 0;
+		unsigned int clusterStart = clusters[c];
+
+		starts.push_back(clusterStart);
+
+		for (unsigned int t = clusters[c]; t < end; t++) {
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int vertex = indices[t * 3 + k];
+
+				if (time - cacheTime[vertex] > VERTEX_CACHE_SIZE) {
+					cacheTime[vertex] = time++;
+					clusterMisses++;
+				}
+			}
+
+			unsigned int clusterTriangles = t + 1 - clusterStart;
+
+			if (t + 1 < end && (float)clusterMisses / clusterTriangles <= OVERDRAW_SPLIT_ACMR) {
+				clusterStart = t + 1;
+				clusterMisses = 0;
+				starts.push_back(clusterStart);
+			}
+		}
+	}
+
+	// each cluster's area weighted centre and normal
+	struct Cluster {
+		unsigned int	Start;
+		unsigned int	End;
+		float			Centre[3];
+		float			Normal[3];
+		float			Sort;
+	};
+
+	std::vector<Cluster> sorted(starts.size());
+	float meshCentre[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < starts.size(); c++) {
+		Cluster& cluster = sorted[c];
+		cluster.Start = starts[c];
+		cluster.End = (c + 1 < starts.size()) ? starts[c + 1] : triangleCount;
+
+		float area = 0.0f;
+		for (int k = 0; k < 3; k++) cluster.Centre[k] = cluster.Normal[k] = 0.0f;
+
+		for (unsigned int t = cluster.Start; t < cluster.End; t++) {
+			const float* p0 = position(indices[t * 3]);
+			const float* p1 = position(indices[t * 3 + 1]);
+			const float* p2 = position(indices[t * 3 + 2]);
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float normal[3] = {
+				e1[1] * e2[2] - e1[2] * e2[1],
+				e1[2] * e2[0] - e1[0] * e2[2],
+				e1[0] * e2[1] - e1[1] * e2[0]
+			};
+
+			// twice the triangle's area
+			float weight = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+			for (int k = 0; k < 3; k++) {
+				cluster.Centre[k] += (p0[k] + p1[k] + p2[k]) * weight / 3.0f;
+				cluster.Normal[k] += normal[k];
+			}
+			area += weight;
+		}
+
+		for (int k = 0; k < 3; k++) meshCentre[k] += cluster.Centre[k];
+		meshArea += area;
+
+		if (area > 0.0f) {
+			for (int k = 0; k < 3; k++) cluster.Centre[k] /= area;
+		}
+	}
+
+	if (meshArea <= 0.0f) return;
+	for (int k = 0; k < 3; k++) meshCentre[k] /= meshArea;
+
+	// clusters facing out from the middle of the mesh are the ones most
+	// likely to hide the rest, so they go first
+	for (Cluster& cluster : sorted) {
+		float length = sqrtf(cluster.Normal[0] * cluster.Normal[0] + cluster.Normal[1] * cluster.Normal[1] + cluster.Normal[2] * cluster.Normal[2]);
+		cluster.Sort = 0.0f;
+
+		if (length > 0.0f) {
+			for (int k = 0; k < 3; k++) cluster.Sort += (cluster.Centre[k] - meshCentre[k]) * cluster.Normal[k] / length;
+		}
+	}
+
+	std::stable_sort(sorted.begin(), sorted.end(), [](const Cluster& a, const Cluster& b) {
+		return a.Sort > b.Sort;
+	});
+
+	std::vector<unsigned int> output;
+	output.reserve(indices.size());
+
+	for (const Cluster& cluster : sorted) {
+		output.insert(output.end(), indices.begin() + cluster.Start * 3, indices.begin() + cluster.End * 3);
+	}
+
+	// splitting can cost a lot more cache misses than it's worth
+	if (CalculateACMR(output, vertexCount) <= CalculateACMR(indices, vertexCount) * OVERDRAW_MAX_ACMR_INCREASE) {
+		indices.swap(output);
+	}
+}
+
+// === vertex fetch === //
+
+unsigned int OptimiseVertexFetch(void* vertices, unsigned int vertexCount, unsigned int stride, std::vector<unsigned int>& indices)
+{
+	unsigned char* data = (unsigned char*)vertices;
+
+	std::vector<unsigned int> remap(vertexCount, NO_VERTEX);
+	std::vector<unsigned char> reordered((size_t)vertexCount * stride);
+	unsigned int used = 0;
+
+	for (unsigned int& index : indices) {
+		if (remap[index] == NO_VERTEX) {
+			memcpy(&reordered[(size_t)used * stride], data + (size_t)index * stride, stride);
+			remap[index] = used++;
+		}
+
+		index = remap[index];
+	}
+
+	if (used > 0) memcpy(data, reordered.data(), (size_t)used * stride);
+
+	return used;
+}
+
+// === measuring === //
+
+float CalculateACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize)
+{
+	unsigned int triangleCount = (unsigned int)indices.size() / 3;
+	if (triangleCount == 0) return 0.0f;
+
+	// a FIFO cache. a vertex is in it if it went in during the last
+	// cacheSize misses.
+	std::vector<unsigned int> cacheTime(vertexCount, 0);
+	unsigned int misses = 0;
+	unsigned int time = cacheSize + 1;
+
+	for (unsigned int index : indices) {
+		if (time - cacheTime[index] > cacheSize) {
+			cacheTime[index] = time++;
+			misses++;
+		}
+	}
+
+	return (float)misses / triangleCount;
+}
@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+
+// Import-time clean up for triangle lists, run on the CPU before geometry
+// goes anywhere near the GPU. Vertices are treated as opaque blocks of
+// stride bytes, except by OptimiseOverdraw, which takes the first three
+// floats of each to be its position.
+//
+// OptimiseMesh runs every stage, in the order they have to go in:
+//
+//	1. weld vertices that are exactly the same, byte for byte
+//	2. reorder triangles for the post-transform vertex cache (Tipsify)
+//	3. reorder clusters of those triangles so the ones facing outwards
+//	   are drawn first, as long as the cache doesn't suffer much for it
+//	4. reorder vertices into the order they're first used, dropping any
+//	   that aren't
+//
+// Cache behaviour is measured as the ACMR, the average number of cache
+// misses per triangle, for a FIFO cache of VERTEX_CACHE_SIZE entries. It
+// ranges from 3 at worst down to about 0.5 for a regular grid.
+
+const unsigned int VERTEX_CACHE_SIZE = 16;
+
+struct MeshOptimiserStats {
+	unsigned int		VerticesBefore;
+	unsigned int		VerticesAfter;
+	unsigned int		Triangles;
+	float				AcmrBefore;
+	float				AcmrAfter;
+};
+
+// rewrites vertices in place. whatever's past VerticesAfter is no longer
+// used.
+MeshOptimiserStats	OptimiseMesh(void* vertices, unsigned int vertexCount, unsigned int stride, std::vector<unsigned int>& indices);
+
+// returns how many vertices are left, packed at the front
+unsigned int		WeldVertices(void* vertices, unsigned int vertexCount, unsigned int stride, std::vector<unsigned int>& indices);
+
+// clusters, if given, gets the first triangle of each run that had to
+// jump to a triangle not sharing a vertex with the one before
+void				OptimiseVertexCache(std::vector<unsigned int>& indices, unsigned int vertexCount, std::vector<unsigned int>* clusters = nullptr);
+
+// takes the clusters OptimiseVertexCache gave back for these indices
+void				OptimiseOverdraw(std::vector<unsigned int>& indices, const std::vector<unsigned int>& clusters, const void* vertices, unsigned int vertexCount, unsigned int stride);
+
+// returns how many vertices are left, packed at the front
+unsigned int		OptimiseVertexFetch(void* vertices, unsigned int vertexCount, unsigned int stride, std::vector<unsigned int>& indices);
+
+float				CalculateACMR(const std::vector<unsigned int>& indices, unsigned int vertexCount, unsigned int cacheSize = VERTEX_CACHE_SIZE);
@@ -1,53 +1,42 @@
 #include "MeshRenderer.h"
 #include "DirectXFramework.h"
+#include "RenderContext.h"
 
-struct CBUFFER
+// constants for the whole frame
+struct FrameConstants
 {
-	XMMATRIX    CompleteTransformation;
-	XMMATRIX	WorldTransformation;
+	XMFLOAT4X4	ViewProjection;
 	XMFLOAT4	CameraPosition;
-	XMVECTOR    LightVector;
-	XMFLOAT4    LightColor;
-	XMFLOAT4    AmbientColor;
-	XMFLOAT4    DiffuseCoefficient;
-	XMFLOAT4	SpecularCoefficient;
-	float		Shininess;
-	float		Opacity;
-	float       Padding[2];
+	XMFLOAT4	LightVector;
+	XMFLOAT4	LightColor;
+	XMFLOAT4	AmbientColor;
 };
 
-CBUFFER cBuffer;
-
-void MeshRenderer::SetMesh(std::shared_ptr<Mesh> mesh)
-{
-	mesh_ = mesh;
-}
-
-void MeshRenderer::SetWorldTransformation(FXMMATRIX worldTransformation)
-{
-	XMStoreFloat4x4(&worldTransformation_, worldTransformation);
-}
-
-void MeshRenderer::SetAmbientLight(XMFLOAT4 ambientLight)
-{
-	ambientLight_ = ambientLight;
-}
-
-void MeshRenderer::SetDirectionalLight(FXMVECTOR lightVector, XMFLOAT4 lightColour)
+// and for one object that isn't instanced
+struct ObjectConstants
 {
-	directionalLightColour_ = lightColour;
-	XMStoreFloat4(&directionalLightVector_, lightVector);
-}
+	XMFLOAT4X4	World;
+};
 
-void MeshRenderer::SetCameraPosition(XMFLOAT4 cameraPosition)
+// the queue's view of one of a mesh's draws. the caller places it.
+static DrawItem MakeDrawItem(MeshRenderer* renderer, const MeshDraw& draw, unsigned int lod)
 {
-	cameraPosition_ = cameraPosition;
+	DrawItem item;
+	item.Owner = renderer;
+	item.Geometry = draw.Geometry;
+	item.Surface = draw.Surface;
+	item.Lod = lod;
+	item.Texture = draw.Surface->GetTexture().Get();
+	item.IndexCount = static_cast<unsigned int>(draw.Geometry->GetIndexCount(lod));
+	item.World = draw.Transformation;
+	item.InstanceStart = 0;
+	item.InstanceCount = 0;
+	return item;
 }
 
 bool MeshRenderer::Initialise()
 {
 	device_ = DirectXFramework::GetDXFramework()->GetDevice();
-	deviceContext_ = DirectXFramework::GetDXFramework()->GetDeviceContext();
 
 	BuildShaders();
 	BuildVertexLayout();
@@ -57,102 +46,150 @@ bool MeshRenderer::Initialise()
 	return true;
 }
 
-void MeshRenderer::RenderNode(std::shared_ptr<Node> node, bool renderTransparent)
+void MeshRenderer::Queue(RenderQueue& queue, Mesh* mesh, unsigned int lod, FXMMATRIX worldTransformation)
 {
-	unsigned int subMeshCount = (unsigned int)node->GetMeshCount();
+	const std::vector<MeshDraw>& draws = mesh->GetDraws();
+	size_t opaqueCount = mesh->GetOpaqueCount();
 
-	// loop through all submeshes in the mesh, rendering them
-	for (unsigned int i = 0; i < subMeshCount; i++)
+	// opaque draws are made once for every instance of the mesh in the
+	// frame. only the transparent ones still need drawing one at a time,
+	// since they have to be sorted back to front.
+	if (HARDWARE_INSTANCING)
 	{
-		unsigned int meshIndex = node->GetMesh(i);
-		std::shared_ptr<SubMesh> subMesh = mesh_->GetSubMesh(meshIndex);
-		std::shared_ptr<Material> material = subMesh->GetMaterial();
-		float opacity = material->GetOpacity();
-		if ((renderTransparent && opacity < 1.0f) ||
-			(!renderTransparent && opacity == 1.0f))
+		if (opaqueCount > 0) queue.AddInstance(this, mesh, lod, worldTransformation);
+	}
+	else
+	{
+		for (size_t i = 0; i < opaqueCount; i++)
 		{
-			UINT stride = sizeof(VERTEX);
-			UINT offset = 0;
-
-			vertexBuffer_ = subMesh->GetVertexBuffer();
-			indexBuffer_ = subMesh->GetIndexBuffer();
-			deviceContext_->IASetVertexBuffers(0, 1, vertexBuffer_.GetAddressOf(), &stride, &offset);
-			deviceContext_->IASetIndexBuffer(indexBuffer_.Get(), DXGI_FORMAT_R32_UINT, 0);
-
-			cBuffer.DiffuseCoefficient = material->GetDiffuseColour();
-			cBuffer.SpecularCoefficient = material->GetSpecularColour();
-			cBuffer.Shininess = material->GetShininess();
-			cBuffer.Opacity = opacity;
-
-			// update the constant buffer 
-			deviceContext_->VSSetConstantBuffers(0, 1, constantBuffer_.GetAddressOf());
-			deviceContext_->UpdateSubresource(constantBuffer_.Get(), 0, 0, &cBuffer, 0, 0);
-			texture_ = material->GetTexture();
-			deviceContext_->PSSetShaderResources(0, 1, texture_.GetAddressOf());
-			deviceContext_->PSSetConstantBuffers(0, 1, constantBuffer_.GetAddressOf());
-			deviceContext_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
-			deviceContext_->DrawIndexed(static_cast<UINT>(subMesh->GetIndexCount()), 0, 0);
+			DrawItem item = MakeDrawItem(this, draws[i], lod);
+			XMStoreFloat4x4(&item.World, XMLoadFloat4x4(&draws[i].Transformation) * worldTransformation);
+			queue.Add(RenderPass::Opaque, item);
 		}
 	}
 
-	// render the children
-	unsigned int childrenCount = (unsigned int)node->GetChildrenCount();
+	// transparent draws go in their own pass, after everything opaque.
+	// blending always mixes with whatever's already in the render target,
+	// so a transparent draw made first would come out opaque.
+	for (size_t i = opaqueCount; i < draws.size(); i++)
+	{
+		DrawItem item = MakeDrawItem(this, draws[i], lod);
+		XMStoreFloat4x4(&item.World, XMLoadFloat4x4(&draws[i].Transformation) * worldTransformation);
+		queue.Add(RenderPass::Transparent, item);
+	}
+}
+
+void MeshRenderer::QueueInstances(RenderQueue& queue, const InstanceGroup& group)
+{
+	const std::vector<MeshDraw>& draws = group.Model->GetDraws();
+	size_t opaqueCount = group.Model->GetOpaqueCount();
 
-	// loop through all submeshes in the mesh, rendering them
-	for (unsigned int i = 0; i < childrenCount; i++)
+	// World only places the sub-mesh within the mesh. each instance
+	// brings its own world matrix.
+	for (size_t i = 0; i < opaqueCount; i++)
 	{
-		RenderNode(node->GetChild(i), renderTransparent);
+		DrawItem item = MakeDrawItem(this, draws[i], group.Lod);
+		item.InstanceStart = group.Start;
+		item.InstanceCount = group.Count;
+		queue.Add(RenderPass::Opaque, item);
 	}
 }
 
-void MeshRenderer::Render()
+void MeshRenderer::BeginQueued(RenderContext& context)
 {
+	std::shared_ptr<Camera> camera = DirectXFramework::GetDXFramework()->GetCamera();
+	std::shared_ptr<Lighting> lighting = DirectXFramework::GetDXFramework()->GetLighting();
+
+	// everything the items share goes up once
+	XMMATRIX viewTransformation = camera->GetViewMatrix();
+	XMMATRIX projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation();
+
+	FrameConstants frame;
+	XMStoreFloat4x4(&frame.ViewProjection, viewTransformation * projectionTransformation);
+	XMStoreFloat4(&frame.CameraPosition, camera->GetCameraPosition());
+	XMStoreFloat4(&frame.LightVector, XMVector3Normalize(XMLoadFloat4(&lighting->DirectionalLightVector)));
+	frame.LightColor = lighting->DirectionalLightColor;
+	frame.AmbientColor = lighting->AmbientLight;
+
+	context.UpdateBuffer(frameConstantBuffer_.Get(), &frame, sizeof(frame));
+
 	// turn off back face culling while we render a mesh. 
 	// we do this since ASSIMP does not appear to be setting the
 	// TWOSIDED property on materials correctly. without turning off
 	// back face culling, some materials do not render correctly.
-	deviceContext_->RSSetState(noCullRasteriserState_.Get());
+	context.SetRasteriserState(noCullRasteriserState_.Get());
 
-	XMMATRIX projectionTransformation = DirectXFramework::GetDXFramework()->GetProjectionTransformation();
-	XMMATRIX viewTransformation = DirectXFramework::GetDXFramework()->GetCamera()->GetViewMatrix();
+	context.SetPixelShader(pixelShader_.Get());
+	context.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
 
-	XMMATRIX completeTransformation = XMLoadFloat4x4(&worldTransformation_) * viewTransformation * projectionTransformation;
+	// set the blend state correctly to handle opacity
+	context.SetBlendState(transparentBlendState_.Get());
 
-	cBuffer.CompleteTransformation = completeTransformation;
-	cBuffer.WorldTransformation = XMLoadFloat4x4(&worldTransformation_);
-	cBuffer.AmbientColor = ambientLight_;
-	cBuffer.LightVector = XMVector4Normalize(XMLoadFloat4(&directionalLightVector_)); 
-	cBuffer.LightColor = directionalLightColour_;
-	cBuffer.CameraPosition = cameraPosition_;
+	context.SetVSConstantBuffer(0, frameConstantBuffer_.Get());
+	context.SetPSConstantBuffer(0, frameConstantBuffer_.Get());
+}
 
-	deviceContext_->VSSetShader(vertexShader_.Get(), 0, 0);
-	deviceContext_->PSSetShader(pixelShader_.Get(), 0, 0);
-	deviceContext_->IASetInputLayout(layout_.Get());
+void MeshRenderer::DrawQueued(RenderContext& context, const DrawItem& item, const DrawItem* previous)
+{
+	SubMesh* subMesh = item.Geometry;
+	Material* material = item.Surface;
+	bool instanced = item.InstanceCount > 0;
 
-	// set the blend state correctly to handle opacity
-	float blendFactors[] = { 0.0f, 0.0f, 0.0f, 0.0f }; 
-	deviceContext_->OMSetBlendState(transparentBlendState_.Get(), blendFactors, 0xffffffff);
+	if (previous == nullptr || (previous->InstanceCount > 0) != instanced)
+	{
+		context.SetVertexShader(instanced ? instancedVertexShader_.Get() : vertexShader_.Get());
+		context.SetInputLayout(instanced ? instancedLayout_.Get() : layout_.Get());
+	}
+
+	// every sub-mesh shares the same pooled buffers, so those hardly
+	// ever change. items come sorted, so runs of the same material and
+	// texture only need binding once too.
+	if (previous == nullptr || previous->Geometry->GetVertexBuffer() != subMesh->GetVertexBuffer())
+	{
+		context.SetVertexBuffer(subMesh->GetVertexBuffer(), sizeof(VERTEX));
+		context.SetIndexBuffer(subMesh->GetIndexBuffer());
+	}
+
+	Material* previousMaterial = (previous != nullptr) ? previous->Surface : nullptr;
+
+	if (previousMaterial != material)
+	{
+		context.SetPSConstantBuffer(2, material->GetConstantBuffer().Get());
+	}
+
+	if (previousMaterial == nullptr || previousMaterial->GetTexture() != material->GetTexture())
+	{
+		context.SetPSResource(0, material->GetTexture().Get());
+	}
 
-	// we do two passes through the nodes.  The first time we render nodes
-	// that aren't transparent (i.e. their opacity == 1.0f).
-	RenderNode(mesh_->GetRootNode(), false);
+	// for instanced draws this only places the sub-mesh within the mesh,
+	// and each instance brings its own world matrix
+	ObjectConstants object;
+	object.World = item.World;
+	context.SetVSConstantRange(1, context.UploadConstants(&object, sizeof(object)));
 
-	// now we render any transparent nodes
-	// we have to do this since blending always blends the submesh with
-	// whatever is in the render target.  If we render a transparent node
-	// first, it will be opaque.
-	RenderNode(mesh_->GetRootNode(), true);
+	if (instanced)
+	{
+		context.DrawIndexedInstanced(item.IndexCount, item.InstanceCount, subMesh->GetStartIndex(item.Lod), subMesh->GetBaseVertex(), item.InstanceStart);
+	}
+	else
+	{
+		context.DrawIndexed(item.IndexCount, subMesh->GetStartIndex(item.Lod), subMesh->GetBaseVertex());
+	}
+}
 
+void MeshRenderer::EndQueued(RenderContext& context)
+{
 	// turn back face culling back on in case another renderer 
 	// relies on it
-	deviceContext_->RSSetState(defaultRasteriserState_.Get());
+	context.SetRasteriserState(defaultRasteriserState_.Get());
 }
 
 void MeshRenderer::Shutdown(void)
 {
 }
 
-void MeshRenderer::BuildShaders()
+void MeshRenderer::CompileShader(const std::wstring& filename, const char* entryPoint, const char* target, ComPtr<ID3DBlob>& byteCode)
 {
 	DWORD shaderCompileFlags = 0;
 #if defined( _DEBUG )
@@ -161,16 +198,15 @@ void MeshRenderer::BuildShaders()
 
 	ComPtr<ID3DBlob> compilationMessages = nullptr;
 
-	// === vertex shader === //
 	HRESULT hr = D3DCompileFromFile(
-		MESH_SHADER.c_str(),
+		filename.c_str(),
 		nullptr, 
 		D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"VShader", 
-		"vs_5_0",
+		entryPoint, 
+		target,
 		shaderCompileFlags, 
 		0,
-		vertexShaderByteCode_.GetAddressOf(),
+		byteCode.ReleaseAndGetAddressOf(),
 		compilationMessages.GetAddressOf()
 	);
 
@@ -182,40 +218,40 @@ void MeshRenderer::BuildShaders()
 
 	// even if there are no compiler messages, check to make sure there were no other errors.
 	ThrowIfFailed(hr);
+}
+
+void MeshRenderer::BuildShaders()
+{
+	// === vertex shaders === //
+	CompileShader(MESH_SHADER, "VShader", "vs_5_0", vertexShaderByteCode_);
 	ThrowIfFailed(
 		device_->CreateVertexShader(
 			vertexShaderByteCode_->GetBufferPointer(), 
 			vertexShaderByteCode_->GetBufferSize(), 
 			NULL, 
-			vertexShader_.GetAddressOf()
+			vertexShader_.ReleaseAndGetAddressOf()
 		)
 	);
 
-	// === pixel shader === //
-	hr = D3DCompileFromFile(
-		MESH_SHADER.c_str(),
-		nullptr,
-		D3D_COMPILE_STANDARD_FILE_INCLUDE,
-		"PShader",
-		"ps_5_0",
-		shaderCompileFlags,
-		0,
-		pixelShaderByteCode_.GetAddressOf(),
-		compilationMessages.GetAddressOf()
+	// the same, but taking its world matrix from a second vertex stream
+	CompileShader(MESH_SHADER, "VShaderInstanced", "vs_5_0", instancedVertexShaderByteCode_);
+	ThrowIfFailed(
+		device_->CreateVertexShader(
+			instancedVertexShaderByteCode_->GetBufferPointer(), 
+			instancedVertexShaderByteCode_->GetBufferSize(), 
+			NULL, 
+			instancedVertexShader_.ReleaseAndGetAddressOf()
+		)
 	);
 
-	if (compilationMessages.Get() != nullptr)
-	{
-		MessageBoxA(0, (char*)compilationMessages->GetBufferPointer(), 0, 0);
-	}
-
-	ThrowIfFailed(hr);
+	// === pixel shader === //
+	CompileShader(MESH_SHADER, "PShader", "ps_5_0", pixelShaderByteCode_);
 	ThrowIfFailed(
 		device_->CreatePixelShader(
 			pixelShaderByteCode_->GetBufferPointer(), 
 			pixelShaderByteCode_->GetBufferSize(), 
 			NULL, 
-			pixelShader_.GetAddressOf()
+			pixelShader_.ReleaseAndGetAddressOf()
 		)
 	);
 }
@@ -236,7 +272,29 @@ void MeshRenderer::BuildVertexLayout()
 			ARRAYSIZE(vertexDesc), 
 			vertexShaderByteCode_->GetBufferPointer(), 
 			vertexShaderByteCode_->GetBufferSize(), 
-			layout_.GetAddressOf()
+			layout_.ReleaseAndGetAddressOf()
+		)
+	);
+
+	// the same again, followed by one world matrix per instance
+	D3D11_INPUT_ELEMENT_DESC instancedVertexDesc[] =
+	{
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R32G32_FLOAT, 0, D3D11_APPEND_ALIGNED_ELEMENT , D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "WORLD", 0, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 0, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 1, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 16, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 2, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 32, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+		{ "WORLD", 3, DXGI_FORMAT_R32G32B32A32_FLOAT, 1, 48, D3D11_INPUT_PER_INSTANCE_DATA, 1 },
+	};
+
+	ThrowIfFailed(
+		device_->CreateInputLayout(
+			instancedVertexDesc, 
+			ARRAYSIZE(instancedVertexDesc), 
+			instancedVertexShaderByteCode_->GetBufferPointer(), 
+			instancedVertexShaderByteCode_->GetBufferSize(), 
+			instancedLayout_.ReleaseAndGetAddressOf()
 		)
 	);
 }
@@ -246,9 +304,9 @@ void MeshRenderer::BuildConstantBuffer()
 	D3D11_BUFFER_DESC bufferDesc;
 	ZeroMemory(&bufferDesc, sizeof(bufferDesc));
 	bufferDesc.Usage = D3D11_USAGE_DEFAULT;
-	bufferDesc.ByteWidth = sizeof(CBUFFER);
+	bufferDesc.ByteWidth = sizeof(FrameConstants);
 	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	ThrowIfFailed(device_->CreateBuffer(&bufferDesc, NULL, constantBuffer_.GetAddressOf()));
+	ThrowIfFailed(device_->CreateBuffer(&bufferDesc, NULL, frameConstantBuffer_.ReleaseAndGetAddressOf()));
 }
 
 void MeshRenderer::BuildBlendState()
@@ -1,42 +1,39 @@
 #pragma once
 #include "Renderer.h"
 #include "Mesh.h"
+#include "RenderQueue.h"
 
 class MeshRenderer : public Renderer
 {
 public:
 
-	void SetMesh(std::shared_ptr<Mesh> mesh);
-	void SetWorldTransformation(FXMMATRIX worldTransformation);
-	void SetAmbientLight(XMFLOAT4 ambientLight);
-	void SetDirectionalLight(FXMVECTOR lightVector, XMFLOAT4 lightColour);
-	void SetCameraPosition(XMFLOAT4 cameraPosition);
 	bool Initialise();
-	void Render();
 	void Shutdown(void);
 
-private:
-	std::shared_ptr<Mesh>			mesh_;
-	XMFLOAT4X4						worldTransformation_;
-	XMFLOAT4						ambientLight_;
-	XMFLOAT4						directionalLightVector_;
-	XMFLOAT4						directionalLightColour_;
-	XMFLOAT4						cameraPosition_;
+	// queue every draw baked into mesh at level of detail lod, in the
+	// opaque or transparent pass
+	void Queue(RenderQueue& queue, Mesh* mesh, unsigned int lod, FXMMATRIX worldTransformation);
+	void QueueInstances(RenderQueue& queue, const InstanceGroup& group);
 
-	ComPtr<ID3D11Device>			device_;
-	ComPtr<ID3D11DeviceContext>		deviceContext_;
+	void BeginQueued(RenderContext& context);
+	void DrawQueued(RenderContext& context, const DrawItem& item, const DrawItem* previous);
+	void EndQueued(RenderContext& context);
 
-	ComPtr<ID3D11Buffer>			vertexBuffer_;
-	ComPtr<ID3D11Buffer>			indexBuffer_;
+private:
+	ComPtr<ID3D11Device>			device_;
 
 	ComPtr<ID3DBlob>				vertexShaderByteCode_ = nullptr;
 	ComPtr<ID3DBlob>				pixelShaderByteCode_ = nullptr;
 	ComPtr<ID3D11VertexShader>		vertexShader_;
 	ComPtr<ID3D11PixelShader>		pixelShader_;
 	ComPtr<ID3D11InputLayout>		layout_;
-	ComPtr<ID3D11Buffer>			constantBuffer_;
+	ComPtr<ID3DBlob>				instancedVertexShaderByteCode_ = nullptr;
+	ComPtr<ID3D11VertexShader>		instancedVertexShader_;
+	ComPtr<ID3D11InputLayout>		instancedLayout_;
 
-	ComPtr<ID3D11ShaderResourceView> texture_;
+	// camera and lighting. objects get their constants from the render
+	// context's upload space, and materials have their own buffers.
+	ComPtr<ID3D11Buffer>			frameConstantBuffer_;
 
 	ComPtr<ID3D11BlendState>		 transparentBlendState_;
 
@@ -44,12 +41,11 @@ private:
 	ComPtr<ID3D11RasterizerState>    noCullRasteriserState_;
 
 
+	void CompileShader(const std::wstring& filename, const char* entryPoint, const char* target, ComPtr<ID3DBlob>& byteCode);
 	void BuildShaders();
 	void BuildVertexLayout();
 	void BuildConstantBuffer();
 	void BuildBlendState();
 	void BuildRendererState();
-
-	void RenderNode(std::shared_ptr<Node> node, bool renderTransparent);
 };
 
@@ -0,0 +1,473 @@
+#include "MeshSimplifier.h"
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+
+// the most a triangle's normal can turn in a collapse, as the cosine of
+// the angle
+const float			MAX_NORMAL_TURN =				0.25f;
+
+const unsigned int	NO_VERTEX =						0xffffffff;
+
+enum class VertexKind : unsigned char {
+	Manifold,
+	Border,
+	Locked
+};
+
+// a symmetric 4x4 matrix, as the upper triangle. evaluated at p, it gives
+// the sum of the squared distances from p to every plane added to it.
+struct Quadric {
+	double			A00, A01, A02, A11, A12, A22;
+	double			B0, B1, B2;
+	double			C;
+};
+
+struct Collapse {
+	unsigned int	From;
+	unsigned int	To;
+	double			Cost;
+};
+
+static void AddPlane(Quadric& q, const double normal[3], double distance)
+{
+	q.A00 += normal[0] * normal[0];
+	q.A01 += normal[0] * normal[1];
+	q.A02 += normal[0] * normal[2];
+	q.A11 += normal[1] * normal[1];
+	q.A12 += normal[1] * normal[2];
+	q.A22 += normal[2] * normal[2];
+	q.B0 += normal[0] * distance;
+	q.B1 += normal[1] * distance;
+	q.B2 += normal[2] * distance;
+	q.C += distance * distance;
+}
+
+static void AddQuadric(Quadric& q, const Quadric& r)
+{
+	q.A00 += r.A00; q.A01 += r.A01; q.A02 += r.A02;
+	q.A11 += r.A11; q.A12 += r.A12; q.A22 += r.A22;
+	q.B0 += r.B0; q.B1 += r.B1; q.B2 += r.B2;
+	q.C += r.C;
+}
+
+static double EvaluateQuadric(const Quadric& q, const float* p)
+{
+	double x = p[0], y = p[1], z = p[2];
+
+	double result = q.A00 * x * x + q.A11 * y * y + q.A22 * z * z
+		+ 2.0 * (q.A01 * x * y + q.A02 * x * z + q.A12 * y * z)
+		+ 2.0 * (q.B0 * x + q.B1 * y + q.B2 * z)
+		+ q.C;
+
+	// rounding can take it just under zero
+	return std::max<double>(result, 0.0);
+}
+
+// twice the area, along the normal
+static void TriangleNormal(const float* p0, const float* p1, const float* p2, double normal[3])
+{
+	double e1[3] = { (double)p1[0] - p0[0], (double)p1[1] - p0[1], (double)p1[2] - p0[2] };
+	double e2[3] = { (double)p2[0] - p0[0], (double)p2[1] - p0[1], (double)p2[2] - p0[2] };
+
+	normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static bool Normalise(double v[3])
+{
+	double length = sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+	if (length <= 0.0) return false;
+
+	v[0] /= length;
+	v[1] /= length;
+	v[2] /= length;
+	return true;
+}
+
+static unsigned long long EdgeKey(unsigned int a, unsigned int b)
+{
+	return (a < b) ? ((unsigned long long)a << 32 | b) : ((unsigned long long)b << 32 | a);
+}
+
+// how many triangles share the edge, given every edge's key, sorted
+static size_t CountEdge(const std::vector<unsigned long long>& edges, unsigned int a, unsigned int b)
+{
+	auto range = std::equal_range(edges.begin(), edges.end(), EdgeKey(a, b));
+	return range.second - range.first;
+}
+
+static void BuildEdges(const std::vector<unsigned int>& indices, const std::vector<unsigned int>& positionIds, std::vector<unsigned long long>& edges)
+{
+	edges.clear();
+
+	for (size_t t = 0; t < indices.size(); t += 3) {
+		for (unsigned int k = 0; k < 3; k++) {
+			edges.push_back(EdgeKey(positionIds[indices[t + k]], positionIds[indices[t + (k + 1) % 3]]));
+		}
+	}
+
+	std::sort(edges.begin(), edges.end());
+}
+
+// the first vertex with each vertex's position
+static void BuildPositionIds(const unsigned char* data, unsigned int vertexCount, unsigned int stride, std::vector<unsigned int>& positionIds)
+{
+	const unsigned int positionSize = sizeof(float) * 3;
+
+	unsigned int tableSize = 1;
+	while (tableSize < vertexCount * 2) tableSize *= 2;
+
+	std::vector<unsigned int> table(tableSize, NO_VERTEX);
+	positionIds.resize(vertexCount);
+
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		const unsigned char* position = data + (size_t)v * stride;
+
+		// FNV-1a
+		unsigned int hash = 2166136261u;
+		for (unsigned int i = 0; i < positionSize; i++) {
+			hash ^= position[i];
+			hash *= 16777619u;
+		}
+
+		unsigned int slot = hash & (tableSize - 1);
+		while (table[slot] != NO_VERTEX && memcmp(data + (size_t)table[slot] * stride, position, positionSize) != 0) {
+			slot = (slot + 1) & (tableSize - 1);
+		}
+
+		if (table[slot] == NO_VERTEX) table[slot] = v;
+		positionIds[v] = table[slot];
+	}
+}
+
+float SimplifyMesh(const void* vertices, unsigned int vertexCount, unsigned int stride, const std::vector<unsigned int>& indices, unsigned int targetIndexCount, float maxError, std::vector<unsigned int>& destination)
+{
+	const unsigned char* data = (const unsigned char*)vertices;
+	auto position = [data, stride](unsigned int vertex) {
+		return (const float*)(data + (size_t)vertex * stride);
+	};
+
+	destination = indices;
+	if (destination.size() <= targetIndexCount || vertexCount == 0) return 0.0f;
+
+	std::vector<unsigned int> positionIds;
+	BuildPositionIds(data, vertexCount, stride, positionIds);
+
+	std::vector<unsigned int> positionCounts(vertexCount, 0);
+	for (unsigned int v = 0; v < vertexCount; v++) positionCounts[positionIds[v]]++;
+
+	std::vector<unsigned long long> edges;
+	BuildEdges(destination, positionIds, edges);
+
+	// what each vertex is free to do, and the planes it starts with
+	std::vector<VertexKind> kinds(vertexCount, VertexKind::Manifold);
+	std::vector<Quadric> quadrics(vertexCount);
+	memset(quadrics.data(), 0, quadrics.size() * sizeof(Quadric));
+
+	for (unsigned int v = 0; v < vertexCount; v++) {
+		if (positionCounts[positionIds[v]] > 1) kinds[v] = VertexKind::Locked;
+	}
+
+	for (size_t t = 0; t < destination.size(); t += 3) {
+		double normal[3];
+		TriangleNormal(position(destination[t]), position(destination[t + 1]), position(destination[t + 2]), normal);
+		if (!Normalise(normal)) continue;
+
+		const float* p0 = position(destination[t]);
+		double distance = -(normal[0] * p0[0] + normal[1] * p0[1] + normal[2] * p0[2]);
+
+		for (unsigned int k = 0; k < 3; k++) {
+			unsigned int a = destination[t + k];
+			unsigned int b = destination[t + (k + 1) % 3];
+			AddPlane(quadrics[a], normal, distance);
+
+			size_t shared = CountEdge(edges, positionIds[a], positionIds[b]);
+
+			if (shared > 2) {
+				kinds[a] = kinds[b] = VertexKind::Locked;
+			}
+			else if (shared == 1) {
+				if (kinds[a] == VertexKind::Manifold) kinds[a] = VertexKind::Border;
+				if (kinds[b] == VertexKind::Manifold) kinds[b] = VertexKind::Border;
+
+				// a plane standing up along the border keeps it from
+				// being pulled in
+				const float* pa = position(a);
+				const float* pb = position(b);
+				double edge[3] = { (double)pb[0] - pa[0], (double)pb[1] - pa[1], (double)pb[2] - pa[2] };
+				double side[3] = {
+					edge[1] * normal[2] - edge[2] * normal[1],
+					edge[2] * normal[0] - edge[0] * normal[2],
+					edge[0] * normal[1] - edge[1] * normal[0]
+				};
+
+				if (Normalise(side)) {
+					double sideDistance = -(side[0] * pa[0] + side[1] * pa[1] + side[2] * pa[2]);
+					AddPlane(quadrics[a], side, sideDistance);
+					AddPlane(quadrics[b], side, sideDistance);
+				}
+			}
+		}
+	}
+
+	double maxCost = (double)maxError * maxError;
+	double worstCost = 0.0;
+
+	std::vector<unsigned int> offsets;
+	std::vector<unsigned int> adjacency;
+	std::vector<unsigned long long> candidates;
+	std::vector<Collapse> collapses;
+	std::vector<unsigned int> remap(vertexCount);
+	std::vector<bool> touched(vertexCount);
+
+	// can from move onto to without folding any triangle over
+	auto flips = [&](unsigned int from, unsigned int to) {
+		const float* target = position(to);
+
+		for (unsigned int a = offsets[from]; a < offsets[from + 1]; a++) {
+			const unsigned int* triangle = &destination[adjacency[a] * 3];
+
+			// triangles across the edge go altogether
+			bool collapsing = false;
+			for (unsigned int k = 0; k < 3; k++) {
+				if (positionIds[triangle[k]] == positionIds[to]) collapsing = true;
+			}
+			if (collapsing) continue;
+
+			const float* before[3];
+			const float* after[3];
+			for (unsigned int k = 0; k < 3; k++) {
+				before[k] = position(triangle[k]);
+				after[k] = (triangle[k] == from) ? target : before[k];
+			}
+
+			double normalBefore[3];
+			double normalAfter[3];
+			TriangleNormal(before[0], before[1], before[2], normalBefore);
+			TriangleNormal(after[0], after[1], after[2], normalAfter);
+
+			if (!Normalise(normalBefore)) continue;
+			if (!Normalise(normalAfter)) return true;
+
+			double turn = normalBefore[0] * normalAfter[0] + normalBefore[1] * normalAfter[1] + normalBefore[2] * normalAfter[2];
+			if (turn < MAX_NORMAL_TURN) return true;
+		}
+
+		return false;
+	};
+
+	auto allowed = [&](unsigned int from, unsigned int to) {
+		if (kinds[from] == VertexKind::Locked) return false;
+
+		// borders only slide along themselves
+		if (kinds[from] == VertexKind::Border) return CountEdge(edges, positionIds[from], positionIds[to]) == 1;
+
+		return true;
+	};
+
+	while (destination.size() > targetIndexCount) {
+		unsigned int triangleCount = (unsigned int)destination.size() / 3;
+
+		// every vertex's triangles, packed one vertex after another
+		offsets.assign(vertexCount + 1, 0);
+		for (unsigned int index : destination) offsets[index + 1]++;
+		for (unsigned int v = 0; v < vertexCount; v++) offsets[v + 1] += offsets[v];
+
+		adjacency.resize(destination.size());
+		std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+		for (unsigned int t = 0; t < triangleCount; t++) {
+			for (unsigned int k = 0; k < 3; k++) adjacency[fill[destination[t * 3 + k]]++] = t;
+		}
+
+		if (offsets[vertexCount] != destination.size()) break;
+
+		BuildEdges(destination, positionIds, edges);
+
+		// every edge once, and the cheaper way of collapsing it
+		candidates.clear();
+		for (unsigned int t = 0; t < triangleCount; t++) {
+			for (unsigned int k = 0; k < 3; k++) {
+				unsigned int a = destination[t * 3 + k];
+				unsigned int b = destination[t * 3 + (k + 1) % 3];
+				if (positionIds[a] != positionIds[b]) candidates.push_back(EdgeKey(a, b));
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+		candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+		collapses.clear();
+		for (unsigned long long key : candidates) {
+			unsigned int a = (unsigned int)(key >> 32);
+			unsigned int b = (unsigned int)(key & 0xffffffff);
+
+			Quadric merged = quadrics[a];
+			AddQuadric(merged, quadrics[b]);
+
+			Collapse best = { NO_VERTEX, NO_VERTEX, 0.0 };
+
+			if (allowed(a, b)) best = { a, b, EvaluateQuadric(merged, position(b)) };
+
+			if (allowed(b, a)) {
+				double cost = EvaluateQuadric(merged, position(a));
+				if (best.From == NO_VERTEX || cost < best.Cost) best = { b, a, cost };
+			}
+
+			if (best.From != NO_VERTEX && best.Cost <= maxCost) collapses.push_back(best);
+		}
+
+		std::sort(collapses.begin(), collapses.end(), [](const Collapse& a, const Collapse& b) {
+			if (a.Cost != b.Cost) return a.Cost < b.Cost;
+			return (a.From != b.From) ? a.From < b.From : a.To < b.To;
+		});
+
+		// a collapse takes two triangles with it, most of the time. going
+		// no further than halfway there keeps the cheap collapses from
+		// being crowded out by ones that happened to sort early.
+		unsigned int goal = std::max<unsigned int>((triangleCount - targetIndexCount / 3) / 2, 1);
+		unsigned int made = 0;
+		double passCost = 0.0;
+
+		for (unsigned int v = 0; v < vertexCount; v++) remap[v] = v;
+		std::fill(touched.begin(), touched.end(), false);
+
+		for (const Collapse& collapse : collapses) {
+			if (made >= goal) break;
+			if (touched[collapse.From] || touched[collapse.To]) continue;
+			if (flips(collapse.From, collapse.To)) continue;
+
+			remap[collapse.From] = collapse.To;
+			AddQuadric(quadrics[collapse.To], quadrics[collapse.From]);
+			passCost = std::max<double>(passCost, collapse.Cost);
+			made++;
+
+			// nothing whose triangles just changed can go again until the
+			// next pass has looked at them afresh
+			touched[collapse.To] = true;
+			for (unsigned int a = offsets[collapse.From]; a < offsets[collapse.From + 1]; a++) {
+				for (unsigned int k = 0; k < 3; k++) touched[destination[adjacency[a] * 3 + k]] = true;
+			}
+		}
+
+		if (made == 0) break;
+
+		// the targets never moved this pass, so one lookup is enough
+		size_t kept = 0;
+		for (size_t t = 0; t < destination.size(); t += 3) {
+			unsigned int a = remap[destination[t]];
+			unsigned int b = remap[destination[t + 1]];
+			unsigned int c = remap[destination[t + 2]];
+
+			if (positionIds[a] == positionIds[b] || positionIds[b] == positionIds[c] || positionIds[c] == positionIds[a]) continue;
+
+			destination[kept++] = a;
+			destination[kept++] = b;
+			destination[kept++] = c;
+		}
+
+		// nothing was written over, so a pass that would leave nothing at
+		// all can be dropped, keeping the last mesh that had a shape
+		if (kept == 0) break;
+
+		destination.resize(kept);
+		worstCost = std::max<double>(worstCost, passCost);
+	}
+
+	return (float)sqrt(worstCost);
+}
+
+// === measuring === //
+
+static double PointTriangleDistanceSquared(const double p[3], const double a[3], const double b[3], const double c[3])
+{
+	// Ericson's closest point on a triangle, from "Real-Time Collision
+	// Detection"
+	auto dot = [](const double* u, const double* v) { return u[0] * v[0] + u[1] * v[1] + u[2] * v[2]; };
+
+	double ab[3], ac[3], ap[3], closest[3];
+	for (int k = 0; k < 3; k++) {
+		ab[k] = b[k] - a[k];
+		ac[k] = c[k] - a[k];
+		ap[k] = p[k] - a[k];
+	}
+
+	double d1 = dot(ab, ap), d2 = dot(ac, ap);
+	double bp[3] = { p[0] - b[0], p[1] - b[1], p[2] - b[2] };
+	double d3 = dot(ab, bp), d4 = dot(ac, bp);
+	double cp[3] = { p[0] - c[0], p[1] - c[1], p[2] - c[2] };
+	double d5 = dot(ab, cp), d6 = dot(ac, cp);
+
+	double va = d3 * d6 - d5 * d4;
+	double vb = d5 * d2 - d1 * d6;
+	double vc = d1 * d4 - d3 * d2;
+
+	if (d1 <= 0.0 && d2 <= 0.0) {
+		for (int k = 0; k < 3; k++) closest[k] = a[k];
+	}
+	else if (d3 >= 0.0 && d4 <= d3) {
+		for (int k = 0; k < 3; k++) closest[k] = b[k];
+	}
+	else if (d6 >= 0.0 && d5 <= d6) {
+		for (int k = 0; k < 3; k++) closest[k] = c[k];
+	}
+	else if (vc <= 0.0 && d1 >= 0.0 && d3 <= 0.0) {
+		double v = d1 / (d1 - d3);
+		for (int k = 0; k < 3; k++) closest[k] = a[k] + v * ab[k];
+	}
+	else if (vb <= 0.0 && d2 >= 0.0 && d6 <= 0.0) {
+		double w = d2 / (d2 - d6);
+		for (int k = 0; k < 3; k++) closest[k] = a[k] + w * ac[k];
+	}
+	else if (va <= 0.0 && (d4 - d3) >= 0.0 && (d5 - d6) >= 0.0) {
+		double w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+		for (int k = 0; k < 3; k++) closest[k] = b[k] + w * (c[k] - b[k]);
+	}
+	else {
+		double denominator = 1.0 / (va + vb + vc);
+		double v = vb * denominator;
+		double w = vc * denominator;
+		for (int k = 0; k < 3; k++) closest[k] = a[k] + ab[k] * v + ac[k] * w;
+	}
+
+	double offset[3] = { p[0] - closest[0], p[1] - closest[1], p[2] - closest[2] };
+	return dot(offset, offset);
+}
+
+float MeasureSimplificationError(const void* vertices, unsigned int stride, const std::vector<unsigned int>& original, const std::vector<unsigned int>& simplified)
+{
+	const unsigned char* data = (const unsigned char*)vertices;
+	auto load = [data, stride](unsigned int vertex, double p[3]) {
+		const float* position = (const float*)(data + (size_t)vertex * stride);
+		for (int k = 0; k < 3; k++) p[k] = position[k];
+	};
+
+	if (simplified.empty()) return original.empty() ? 0.0f : INFINITY;
+
+	std::vector<unsigned int> used(original);
+	std::sort(used.begin(), used.end());
+	used.erase(std::unique(used.begin(), used.end()), used.end());
+
+	double worst = 0.0;
+
+	for (unsigned int vertex : used) {
+		double p[3];
+		load(vertex, p);
+
+		double nearest = INFINITY;
+		for (size_t t = 0; t < simplified.size() && nearest > worst; t += 3) {
+			double a[3], b[3], c[3];
+			load(simplified[t], a);
+			load(simplified[t + 1], b);
+			load(simplified[t + 2], c);
+
+			nearest = std::min<double>(nearest, PointTriangleDistanceSquared(p, a, b, c));
+		}
+
+		// anything already nearer than the worst so far can't change it
+		worst = std::max<double>(worst, nearest);
+	}
+
+	return (float)sqrt(worst);
+}
@@ -0,0 +1,33 @@
+#pragma once
+#include <vector>
+
+// Builds coarser versions of a triangle list by collapsing edges, cheapest
+// first, in the style of Garland and Heckbert's "Surface Simplification
+// Using Quadric Error Metrics". Like MeshOptimiser, vertices are opaque
+// blocks of stride bytes with their position in the first three floats,
+// and nothing here touches a device.
+//
+// Every collapse moves one vertex onto another that's already there, so
+// the simplified indices still point into the original vertices and can
+// share them. Each vertex carries a quadric holding the planes of every
+// original triangle merged into it, and the cost of a collapse is the sum
+// of the squared distances from where the vertex ends up to those planes.
+//
+// Vertices that can't move without tearing the mesh are left alone. That
+// covers seams, where vertices share a position but not a normal or
+// texture coordinate, and edges shared by more than two triangles. Open
+// borders only collapse along themselves, so their outline is kept.
+//
+// Collapses are made in passes, sorted by cost with ties broken by vertex
+// index, so the same input always gives the same output.
+
+// indices is left alone. destination gets the simplified triangles, with
+// at most targetIndexCount indices if that can be reached without any
+// collapse costing more than maxError, but never down to no triangles at
+// all. returns the largest distance any vertex was moved off the planes
+// of the triangles merged into it, which is never more than maxError.
+float				SimplifyMesh(const void* vertices, unsigned int vertexCount, unsigned int stride, const std::vector<unsigned int>& indices, unsigned int targetIndexCount, float maxError, std::vector<unsigned int>& destination);
+
+// the furthest any vertex used by original is from the nearest triangle of
+// simplified. brute force, so only for checking.
+float				MeasureSimplificationError(const void* vertices, unsigned int stride, const std::vector<unsigned int>& original, const std::vector<unsigned int>& simplified);
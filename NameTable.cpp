@@ -0,0 +1,46 @@
+#include "NameTable.h"
+
+NameTable::NameTable()
+{
+	// reserve id 0 for the empty string
+	auto inserted = ids_.emplace(std::wstring(), NAME_NONE);
+	strings_.push_back(&inserted.first->first);
+}
+
+NameTable& NameTable::Get()
+{
+	static NameTable table;
+	return table;
+}
+
+NameId NameTable::Intern(const std::wstring& name)
+{
+	NameTable& table = Get();
+	std::lock_guard<std::mutex> lock(table.mutex_);
+
+	auto found = table.ids_.find(name);
+	if (found != table.ids_.end()) return found->second;
+
+	NameId id = (NameId)table.strings_.size();
+	auto inserted = table.ids_.emplace(name, id);
+	table.strings_.push_back(&inserted.first->first);
+
+	return id;
+}
+
+NameId NameTable::Find(const std::wstring& name)
+{
+	NameTable& table = Get();
+	std::lock_guard<std::mutex> lock(table.mutex_);
+
+	auto found = table.ids_.find(name);
+	return (found != table.ids_.end()) ? found->second : NAME_NONE;
+}
+
+const std::wstring& NameTable::GetString(NameId id)
+{
+	NameTable& table = Get();
+	std::lock_guard<std::mutex> lock(table.mutex_);
+
+	return *table.strings_[id];
+}
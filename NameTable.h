@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+
+// A name interned in the global name table. Two ids are equal exactly when
+// their strings are, so ids can be compared and hashed instead of strings.
+typedef unsigned int NameId;
+
+// the empty string. also what Find() returns for names that were never interned.
+const NameId NAME_NONE = 0;
+
+// Global string interning table. Ids are stable for the lifetime of the
+// program and strings are never removed, so a reference returned by
+// GetString() stays valid. Safe to call from any thread.
+
+class NameTable
+{
+public:
+	// returns the id for this name, adding it if we haven't seen it before
+	static NameId				Intern(const std::wstring& name);
+
+	// returns the id for this name without adding it, or NAME_NONE
+	static NameId				Find(const std::wstring& name);
+
+	static const std::wstring&	GetString(NameId id);
+
+private:
+	NameTable();
+
+	static NameTable&			Get();
+
+	std::mutex									mutex_;
+	std::unordered_map<std::wstring, NameId>	ids_;
+
+	// points at the keys in ids_, which don't move once inserted
+	std::vector<const std::wstring*>			strings_;
+};
@@ -0,0 +1,287 @@
+#include "OcclusionBuffer.h"
+#include "CullingSystem.h"
+#include <algorithm>
+#include <fstream>
+#include <cmath>
+#include <cfloat>
+
+// anything with a smaller w is treated as behind the camera
+const float MIN_W = 0.0001f;
+
+// screen coordinates can be huge once something is well off screen, so
+// clamp them before they go anywhere near an int
+static int ClampPixel(float value, int limit)
+{
+	return (int)std::max<float>(-1.0f, std::min<float>(value, (float)limit));
+}
+
+OcclusionBuffer::OcclusionBuffer(unsigned int width, unsigned int height) :
+	width_(width),
+	height_(height),
+	rejected_(0),
+	trianglesRasterised_(0),
+	milliseconds_(0.0),
+	totalRejected_(0),
+	totalMilliseconds_(0.0),
+	frames_(0)
+{
+	depth_.resize(width_ * height_, 1.0f);
+	XMStoreFloat4x4(&viewProjection_, XMMatrixIdentity());
+}
+
+OcclusionBuffer::~OcclusionBuffer()
+{
+}
+
+void OcclusionBuffer::AddOccluder(const std::vector<XMFLOAT3>& vertices, const std::vector<unsigned int>& indices)
+{
+	if (vertices.empty() || indices.empty()) return;
+
+	Occluder occluder;
+	occluder.Vertices = vertices;
+	occluder.Indices = indices;
+	BoundingBox::CreateFromPoints(occluder.Bounds, vertices.size(), vertices.data(), sizeof(XMFLOAT3));
+
+	occluders_.push_back(std::move(occluder));
+}
+
+void OcclusionBuffer::ClearOccluders()
+{
+	occluders_.clear();
+}
+
+void OcclusionBuffer::Begin(FXMMATRIX viewProjection, const CullingSystem& culling)
+{
+	QueryPerformanceCounter(&beginTime_);
+
+	rejected_ = 0;
+	trianglesRasterised_ = 0;
+
+	XMStoreFloat4x4(&viewProjection_, viewProjection);
+	std::fill(depth_.begin(), depth_.end(), 1.0f);
+
+	float halfWidth = 0.5f * width_;
+	float halfHeight = 0.5f * height_;
+
+	for (auto&& occluder : occluders_) {
+		if (!culling.IsVisible(occluder.Bounds)) continue;
+
+		// project every vertex once, rather than once per triangle
+		screen_.resize(occluder.Vertices.size());
+
+		for (size_t i = 0; i < occluder.Vertices.size(); i++) {
+			XMFLOAT4 clip;
+			XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&occluder.Vertices[i]), viewProjection));
+
+			if (clip.w < MIN_W || clip.z < 0.0f) {
+				screen_[i] = XMFLOAT3(0.0f, 0.0f, -1.0f);
+				continue;
+			}
+
+			float inverseW = 1.0f / clip.w;
+			screen_[i] = XMFLOAT3(
+				(clip.x * inverseW + 1.0f) * halfWidth,
+				(1.0f - clip.y * inverseW) * halfHeight,
+				clip.z * inverseW
+			);
+		}
+
+		for (size_t i = 0; i + 2 < occluder.Indices.size(); i += 3) {
+			const XMFLOAT3& v0 = screen_[occluder.Indices[i]];
+			const XMFLOAT3& v1 = screen_[occluder.Indices[i + 1]];
+			const XMFLOAT3& v2 = screen_[occluder.Indices[i + 2]];
+
+			if (v0.z < 0.0f || v1.z < 0.0f || v2.z < 0.0f) continue;
+
+			RasteriseTriangle(v0, v1, v2);
+		}
+	}
+}
+
+void OcclusionBuffer::End()
+{
+	LARGE_INTEGER endTime;
+	LARGE_INTEGER frequency;
+	QueryPerformanceCounter(&endTime);
+	QueryPerformanceFrequency(&frequency);
+
+	milliseconds_ = (double)(endTime.QuadPart - beginTime_.QuadPart) * 1000.0 / frequency.QuadPart;
+
+	totalMilliseconds_ += milliseconds_;
+	totalRejected_ += rejected_;
+	frames_++;
+}
+
+void OcclusionBuffer::RasteriseTriangle(XMFLOAT3 v0, XMFLOAT3 v1, XMFLOAT3 v2)
+{
+	float area = (v1.x - v0.x) * (v2.y - v0.y) - (v1.y - v0.y) * (v2.x - v0.x);
+
+	// occluders are solid, so either winding will do
+	if (area < 0.0f) {
+		std::swap(v1, v2);
+		area = -area;
+	}
+
+	if (area < 1e-6f) return;
+
+	int minX = std::max<int>(0, ClampPixel(floorf(std::min<float>(v0.x, std::min<float>(v1.x, v2.x))), width_));
+	int maxX = std::min<int>(width_ - 1, ClampPixel(ceilf(std::max<float>(v0.x, std::max<float>(v1.x, v2.x))), width_));
+	int minY = std::max<int>(0, ClampPixel(floorf(std::min<float>(v0.y, std::min<float>(v1.y, v2.y))), height_));
+	int maxY = std::min<int>(height_ - 1, ClampPixel(ceilf(std::max<float>(v0.y, std::max<float>(v1.y, v2.y))), height_));
+
+	if (minX > maxX || minY > maxY) return;
+
+	trianglesRasterised_++;
+
+	// each edge function is a*x + b*y + c, positive on the inside. the
+	// weights they give at a pixel also interpolate its depth.
+	const XMFLOAT3* vertices[3] = { &v0, &v1, &v2 };
+	float a[3], b[3], c[3];
+
+	for (int e = 0; e < 3; e++) {
+		const XMFLOAT3& from = *vertices[(e + 1) % 3];
+		const XMFLOAT3& to = *vertices[(e + 2) % 3];
+
+		a[e] = from.y - to.y;
+		b[e] = to.x - from.x;
+		c[e] = -a[e] * from.x - b[e] * from.y;
+	}
+
+	float inverseArea = 1.0f / area;
+	float depthA = (a[0] * v0.z + a[1] * v1.z + a[2] * v2.z) * inverseArea;
+	float depthB = (b[0] * v0.z + b[1] * v1.z + b[2] * v2.z) * inverseArea;
+	float depthC = (c[0] * v0.z + c[1] * v1.z + c[2] * v2.z) * inverseArea;
+
+	XMVECTOR edgeA[3], edgeB[3], edgeC[3];
+	for (int e = 0; e < 3; e++) {
+		edgeA[e] = XMVectorReplicate(a[e]);
+		edgeB[e] = XMVectorReplicate(b[e]);
+		edgeC[e] = XMVectorReplicate(c[e]);
+	}
+
+	XMVECTOR laneOffsets = XMVectorSet(0.5f, 1.5f, 2.5f, 3.5f);
+	XMVECTOR zero = XMVectorZero();
+
+	// start on a multiple of four, so each block lines up with the rows
+	int startX = minX & ~3;
+
+	for (int y = minY; y <= maxY; y++) {
+		XMVECTOR py = XMVectorReplicate(y + 0.5f);
+		float* row = &depth_[y * width_];
+
+		for (int x = startX; x <= maxX; x += 4) {
+			XMVECTOR px = XMVectorAdd(XMVectorReplicate((float)x), laneOffsets);
+
+			XMVECTOR inside = XMVectorTrueInt();
+			for (int e = 0; e < 3; e++) {
+				XMVECTOR edge = XMVectorMultiplyAdd(edgeA[e], px, XMVectorMultiplyAdd(edgeB[e], py, edgeC[e]));
+				inside = XMVectorAndInt(inside, XMVectorGreaterOrEqual(edge, zero));
+			}
+
+			if (XMVector4EqualInt(inside, zero)) continue;
+
+			XMVECTOR depth = XMVectorMultiplyAdd(XMVectorReplicate(depthA), px,
+							 XMVectorMultiplyAdd(XMVectorReplicate(depthB), py, XMVectorReplicate(depthC)));
+
+			XMVECTOR current = XMLoadFloat4((const XMFLOAT4*)&row[x]);
+			XMStoreFloat4((XMFLOAT4*)&row[x], XMVectorSelect(current, XMVectorMin(current, depth), inside));
+		}
+	}
+}
+
+bool OcclusionBuffer::IsOccluded(const BoundingBox& bounds)
+{
+	XMMATRIX viewProjection = XMLoadFloat4x4(&viewProjection_);
+
+	XMFLOAT3 corners[BoundingBox::CORNER_COUNT];
+	bounds.GetCorners(corners);
+
+	float minX = FLT_MAX, maxX = -FLT_MAX;
+	float minY = FLT_MAX, maxY = -FLT_MAX;
+	float nearest = FLT_MAX;
+
+	for (size_t i = 0; i < BoundingBox::CORNER_COUNT; i++) {
+		XMFLOAT4 clip;
+		XMStoreFloat4(&clip, XMVector3Transform(XMLoadFloat3(&corners[i]), viewProjection));
+
+		// anything reaching past the near plane is too close to call
+		if (clip.w < MIN_W || clip.z < 0.0f) return false;
+
+		float inverseW = 1.0f / clip.w;
+		float x = (clip.x * inverseW + 1.0f) * 0.5f * width_;
+		float y = (1.0f - clip.y * inverseW) * 0.5f * height_;
+
+		minX = std::min<float>(minX, x);
+		maxX = std::max<float>(maxX, x);
+		minY = std::min<float>(minY, y);
+		maxY = std::max<float>(maxY, y);
+		nearest = std::min<float>(nearest, clip.z * inverseW);
+	}
+
+	// entirely off screen. that's for the frustum cull to decide.
+	if (maxX < 0.0f || maxY < 0.0f || minX >= width_ || minY >= height_) return false;
+
+	// grow the rectangle by a pixel, since occluders are only sampled at
+	// pixel centres
+	int left = std::max<int>(0, ClampPixel(floorf(minX), width_) - 1);
+	int right = std::min<int>(width_ - 1, ClampPixel(ceilf(maxX), width_) + 1);
+	int top = std::max<int>(0, ClampPixel(floorf(minY), height_) - 1);
+	int bottom = std::min<int>(height_ - 1, ClampPixel(ceilf(maxY), height_) + 1);
+
+	XMVECTOR nearestDepth = XMVectorReplicate(nearest);
+	XMVECTOR laneIndices = XMVectorSet(0.0f, 1.0f, 2.0f, 3.0f);
+	XMVECTOR leftEdge = XMVectorReplicate((float)left);
+	XMVECTOR rightEdge = XMVectorReplicate((float)right);
+	XMVECTOR zero = XMVectorZero();
+
+	int startX = left & ~3;
+
+	for (int y = top; y <= bottom; y++) {
+		const float* row = &depth_[y * width_];
+
+		for (int x = startX; x <= right; x += 4) {
+			XMVECTOR column = XMVectorAdd(XMVectorReplicate((float)x), laneIndices);
+			XMVECTOR inRange = XMVectorAndInt(XMVectorGreaterOrEqual(column, leftEdge), XMVectorLessOrEqual(column, rightEdge));
+
+			// any pixel where the occluders are behind our nearest point
+			// means some of us might show
+			XMVECTOR behind = XMVectorGreaterOrEqual(XMLoadFloat4((const XMFLOAT4*)&row[x]), nearestDepth);
+
+			if (XMVector4NotEqualInt(XMVectorAndInt(behind, inRange), zero)) return false;
+		}
+	}
+
+	rejected_++;
+	return true;
+}
+
+bool OcclusionBuffer::DumpDepth(const std::wstring& filename) const
+{
+	std::ofstream file(filename.c_str(), std::ios_base::binary);
+	if (!file) return false;
+
+	// stretch whatever range of depths is in use over the full greyscale
+	// range. post-projection depth bunches up near the far plane otherwise.
+	float nearest = 1.0f;
+	float furthest = 0.0f;
+
+	for (float depth : depth_) {
+		if (depth >= 1.0f) continue;
+
+		nearest = std::min<float>(nearest, depth);
+		furthest = std::max<float>(furthest, depth);
+	}
+
+	float scale = (furthest > nearest) ? 254.0f / (furthest - nearest) : 0.0f;
+
+	std::vector<unsigned char> pixels(depth_.size());
+	for (size_t i = 0; i < depth_.size(); i++) {
+		// empty pixels stay white
+		pixels[i] = (depth_[i] >= 1.0f) ? 255 : (unsigned char)((depth_[i] - nearest) * scale);
+	}
+
+	file << "P5\n" << width_ << " " << height_ << "\n255\n";
+	file.write((const char*)pixels.data(), pixels.size());
+
+	return file.good();
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include "Core.h"
+#include "DirectXCore.h"
+#include <vector>
+
+class CullingSystem;
+
+// Coarse software depth buffer for occlusion culling. A small set of
+// occluders (terrain chunk proxies and the like) is rasterised on the CPU
+// every frame, and the screen-space bounds of anything the frustum cull
+// let through are tested against it before they're drawn.
+//
+// Both the rasteriser and the test work on four pixels of a row at a
+// time. Triangles that cross the near plane are dropped rather than
+// clipped, which only ever makes the buffer see through more than it
+// should.
+
+class OcclusionBuffer
+{
+public:
+	// width has to be a multiple of four
+	OcclusionBuffer(unsigned int width, unsigned int height);
+	~OcclusionBuffer();
+
+	// occluders are in world space, and have to sit inside whatever they
+	// stand in for. they stay until cleared.
+	void					AddOccluder(const std::vector<XMFLOAT3>& vertices, const std::vector<unsigned int>& indices);
+	void					ClearOccluders();
+
+	// clear the buffer and rasterise every occluder the culling system's
+	// last frustum can see
+	void					Begin(FXMMATRIX viewProjection, const CullingSystem& culling);
+	void					End();
+
+	// true if the box is hidden behind the occluders. counted towards
+	// the rejected total.
+	bool					IsOccluded(const BoundingBox& bounds);
+
+	// write the buffer out as a greyscale PGM, nearest in black
+	bool					DumpDepth(const std::wstring& filename) const;
+
+	inline unsigned int		GetWidth() const { return width_; }
+	inline unsigned int		GetHeight() const { return height_; }
+
+	// between the last Begin and End
+	inline unsigned int		GetRejected() const { return rejected_; }
+	inline unsigned int		GetTrianglesRasterised() const { return trianglesRasterised_; }
+	inline double			GetMilliseconds() const { return milliseconds_; }
+
+	// totals since startup, for profiling
+	inline unsigned long long	GetTotalRejected() const { return totalRejected_; }
+	inline double			GetTotalMilliseconds() const { return totalMilliseconds_; }
+	inline unsigned int		GetFrames() const { return frames_; }
+
+private:
+	struct Occluder {
+		std::vector<XMFLOAT3>		Vertices;
+		std::vector<unsigned int>	Indices;
+		BoundingBox					Bounds;
+	};
+
+	void					RasteriseTriangle(XMFLOAT3 v0, XMFLOAT3 v1, XMFLOAT3 v2);
+
+	unsigned int			width_;
+	unsigned int			height_;
+
+	// post-projection depth, one per pixel. cleared to the far plane.
+	std::vector<float>		depth_;
+
+	std::vector<Occluder>	occluders_;
+
+	// each occluder's vertices in screen space, with z < 0 for any
+	// vertex behind the near plane
+	std::vector<XMFLOAT3>	screen_;
+
+	XMFLOAT4X4				viewProjection_;
+
+	LARGE_INTEGER			beginTime_;
+	unsigned int			rejected_;
+	unsigned int			trianglesRasterised_;
+	double					milliseconds_;
+
+	unsigned long long		totalRejected_;
+	double					totalMilliseconds_;
+	unsigned int			frames_;
+};
@@ -15,9 +15,9 @@ void PlayerNode::Start()
 	GetTransform()->SetPosition(-1370.0f, 20.0f, 540.0f);
 }
 
-void PlayerNode::Update(FXMMATRIX& currentWorldTransformation)
+void PlayerNode::Update()
 {
-	SceneNode::Update(currentWorldTransformation);
+	SceneNode::Update();
 	if (!active_) return;
 
 	// take camera rotation into account
@@ -27,8 +27,14 @@ public:
 	void SetControlState(PlayerControlState state)
 		{ currentState_ = state; };
 
+	PlayerControlState GetControlState()
+		{ return currentState_; }
+
 	void Start();
-	void Update(FXMMATRIX& currentWorldTransformation);
+	void Update();
+
+	// we steer by the camera and stand on the terrain
+	bool IsThreadSafe() { return false; }
 
 	bool IsGrounded();
 
@@ -0,0 +1,134 @@
+#include "RangeAllocator.h"
+#include <algorithm>
+
+RangeAllocator::RangeAllocator(unsigned int capacity) :
+	capacity_(0),
+	used_(0)
+{
+	Grow(capacity);
+}
+
+RangeAllocator::~RangeAllocator()
+{
+}
+
+RangeHandle RangeAllocator::Allocate(unsigned int count)
+{
+	if (count == 0) return INVALID_RANGE;
+
+	// the tightest fit leaves the biggest ranges alone for whatever
+	// needs them
+	size_t best = free_.size();
+
+	for (size_t i = 0; i < free_.size(); i++) {
+		if (free_[i].Count < count) continue;
+		if (best == free_.size() || free_[i].Count < free_[best].Count) best = i;
+		if (free_[i].Count == count) break;
+	}
+
+	if (best == free_.size()) return INVALID_RANGE;
+
+	Range range = { free_[best].Offset, count };
+
+	free_[best].Offset += count;
+	free_[best].Count -= count;
+	if (free_[best].Count == 0) free_.erase(free_.begin() + best);
+
+	RangeHandle handle;
+
+	if (freeHandles_.empty()) {
+		handle = (RangeHandle)ranges_.size();
+		ranges_.push_back(range);
+		live_.push_back(true);
+	}
+	else {
+		handle = freeHandles_.back();
+		freeHandles_.pop_back();
+		ranges_[handle] = range;
+		live_[handle] = true;
+	}
+
+	used_ += count;
+	return handle;
+}
+
+void RangeAllocator::Free(RangeHandle handle)
+{
+	if (handle == INVALID_RANGE || handle >= ranges_.size() || !live_[handle]) return;
+
+	AddFree(ranges_[handle].Offset, ranges_[handle].Count);
+	used_ -= ranges_[handle].Count;
+
+	live_[handle] = false;
+	freeHandles_.push_back(handle);
+}
+
+void RangeAllocator::AddFree(unsigned int offset, unsigned int count)
+{
+	Range range = { offset, count };
+
+	auto next = std::lower_bound(free_.begin(), free_.end(), range, [](const Range& a, const Range& b) {
+		return a.Offset < b.Offset;
+	});
+
+	size_t index = next - free_.begin();
+
+	// merge with whatever's free right after us
+	if (index < free_.size() && range.Offset + range.Count == free_[index].Offset) {
+		range.Count += free_[index].Count;
+		free_.erase(free_.begin() + index);
+	}
+
+	// and right before us
+	if (index > 0 && free_[index - 1].Offset + free_[index - 1].Count == range.Offset) {
+		free_[index - 1].Count += range.Count;
+		return;
+	}
+
+	free_.insert(free_.begin() + index, range);
+}
+
+void RangeAllocator::Defragment(std::vector<RangeMove>& moves)
+{
+	moves.clear();
+
+	std::vector<RangeHandle> order;
+	for (RangeHandle handle = 0; handle < (RangeHandle)ranges_.size(); handle++) {
+		if (live_[handle]) order.push_back(handle);
+	}
+
+	std::sort(order.begin(), order.end(), [this](RangeHandle a, RangeHandle b) {
+		return ranges_[a].Offset < ranges_[b].Offset;
+	});
+
+	unsigned int cursor = 0;
+
+	for (RangeHandle handle : order) {
+		Range& range = ranges_[handle];
+
+		moves.push_back({ range.Offset, cursor, range.Count });
+		range.Offset = cursor;
+		cursor += range.Count;
+	}
+
+	free_.clear();
+	if (cursor < capacity_) free_.push_back({ cursor, capacity_ - cursor });
+}
+
+void RangeAllocator::Grow(unsigned int capacity)
+{
+	if (capacity <= capacity_) return;
+
+	unsigned int added = capacity - capacity_;
+	unsigned int offset = capacity_;
+
+	capacity_ = capacity;
+	AddFree(offset, added);
+}
+
+unsigned int RangeAllocator::GetLargestFree() const
+{
+	unsigned int largest = 0;
+	for (const Range& range : free_) largest = std::max<unsigned int>(largest, range.Count);
+	return largest;
+}
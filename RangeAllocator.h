@@ -0,0 +1,72 @@
+#pragma once
+#include <cstddef>
+#include <vector>
+
+// Hands out ranges of a fixed-size space of elements, such as the
+// vertices of one big vertex buffer. Freed ranges go back on a free list,
+// merged with whatever's free either side of them, and new ranges come
+// from whichever free range fits them most tightly.
+//
+// Ranges are known by handle rather than by offset, so Defragment can
+// slide them all down to the front and close up the gaps between them.
+// Nothing here touches the memory itself, so it all runs without a
+// device.
+
+typedef unsigned int RangeHandle;
+const RangeHandle INVALID_RANGE = 0xffffffff;
+
+// where Defragment put a range
+struct RangeMove {
+	unsigned int		From;
+	unsigned int		To;
+	unsigned int		Count;
+};
+
+class RangeAllocator
+{
+public:
+	RangeAllocator(unsigned int capacity = 0);
+	~RangeAllocator();
+
+	// INVALID_RANGE if no one free range is big enough, even if there's
+	// enough free space in total. count has to be at least one.
+	RangeHandle			Allocate(unsigned int count);
+	void				Free(RangeHandle handle);
+
+	inline unsigned int	GetOffset(RangeHandle handle) const { return ranges_[handle].Offset; }
+	inline unsigned int	GetCount(RangeHandle handle) const { return ranges_[handle].Count; }
+
+	// pack every range against the front, in the order they already
+	// were, leaving all the free space in one piece at the end. fills
+	// moves with where every range went, including any that stayed put.
+	void				Defragment(std::vector<RangeMove>& moves);
+
+	// add free space on the end. the capacity never shrinks.
+	void				Grow(unsigned int capacity);
+
+	inline unsigned int	GetCapacity() const { return capacity_; }
+	inline unsigned int	GetUsed() const { return used_; }
+	inline unsigned int	GetFree() const { return capacity_ - used_; }
+	inline size_t		GetFreeRangeCount() const { return free_.size(); }
+	unsigned int		GetLargestFree() const;
+
+private:
+	struct Range {
+		unsigned int	Offset;
+		unsigned int	Count;
+	};
+
+	// put a range back on the free list, merging it with its neighbours
+	void				AddFree(unsigned int offset, unsigned int count);
+
+	unsigned int		capacity_;
+	unsigned int		used_;
+
+	// by handle. freed handles are reused.
+	std::vector<Range>	ranges_;
+	std::vector<bool>	live_;
+	std::vector<RangeHandle>	freeHandles_;
+
+	// sorted by offset, and never touching each other
+	std::vector<Range>	free_;
+};
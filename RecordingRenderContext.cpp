@@ -0,0 +1,149 @@
+#include "RecordingRenderContext.h"
+
+RecordingRenderContext::RecordingRenderContext()
+{
+	Clear();
+}
+
+RecordingRenderContext::~RecordingRenderContext()
+{
+}
+
+void RecordingRenderContext::SetVertexShader(ID3D11VertexShader* shader)
+{
+	Record(RenderCall::VertexShader, shader, 0);
+}
+
+void RecordingRenderContext::SetPixelShader(ID3D11PixelShader* shader)
+{
+	Record(RenderCall::PixelShader, shader, 0);
+}
+
+void RecordingRenderContext::SetInputLayout(ID3D11InputLayout* layout)
+{
+	Record(RenderCall::InputLayout, layout, 0);
+}
+
+void RecordingRenderContext::SetBlendState(ID3D11BlendState* state)
+{
+	Record(RenderCall::BlendState, state, 0);
+}
+
+void RecordingRenderContext::SetRasteriserState(ID3D11RasterizerState* state)
+{
+	Record(RenderCall::RasteriserState, state, 0);
+}
+
+void RecordingRenderContext::SetDepthStencilState(ID3D11DepthStencilState* state)
+{
+	Record(RenderCall::DepthStencilState, state, 0);
+}
+
+void RecordingRenderContext::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	Record(RenderCall::PrimitiveTopology, nullptr, (unsigned int)topology);
+}
+
+void RecordingRenderContext::SetVertexBuffer(ID3D11Buffer* buffer, unsigned int stride)
+{
+	Record(RenderCall::VertexBuffer, buffer, stride);
+}
+
+void RecordingRenderContext::SetIndexBuffer(ID3D11Buffer* buffer)
+{
+	Record(RenderCall::IndexBuffer, buffer, 0);
+}
+
+void RecordingRenderContext::SetVSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer)
+{
+	Record(RenderCall::VSConstantBuffer, buffer, slot);
+}
+
+void RecordingRenderContext::SetPSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer)
+{
+	Record(RenderCall::PSConstantBuffer, buffer, slot);
+}
+
+void RecordingRenderContext::SetPSResource(unsigned int slot, ID3D11ShaderResourceView* view)
+{
+	Record(RenderCall::PSResource, view, slot);
+}
+
+void RecordingRenderContext::SetVSConstantRange(unsigned int slot, const ConstantRange& range)
+{
+	Record(RenderCall::VSConstantRange, range.Buffer, slot);
+}
+
+void RecordingRenderContext::UpdateBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size)
+{
+	Record(RenderCall::UpdateBuffer, buffer, size);
+}
+
+ConstantRange RecordingRenderContext::UploadConstants(const void* data, unsigned int size)
+{
+	Record(RenderCall::UploadConstants, data, size);
+
+	// hand out ranges that look like the real thing, so anything
+	// comparing them still sees each upload as different
+	unsigned int constants = (size + 15) / 16;
+	ConstantRange range = { (ID3D11Buffer*)&constantRing_, constantOffset_, constants };
+	constantOffset_ += constants;
+
+	return range;
+}
+
+void RecordingRenderContext::SetInstanceData(const void* data, unsigned int stride, unsigned int count)
+{
+	Record(RenderCall::InstanceData, data, count);
+}
+
+void RecordingRenderContext::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	Record(RenderCall::DrawIndexed, nullptr, indexCount);
+}
+
+void RecordingRenderContext::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	Record(RenderCall::DrawIndexedInstanced, nullptr, instanceCount);
+}
+
+void RecordingRenderContext::BeginFrame()
+{
+}
+
+void RecordingRenderContext::EndFrame()
+{
+}
+
+UploadStats RecordingRenderContext::GetUploadStats() const
+{
+	// nothing's ever really uploaded
+	return UploadStats();
+}
+
+unsigned int RecordingRenderContext::GetStateChanges() const
+{
+	unsigned int changes = 0;
+
+	for (int i = 0; i < (int)RenderCall::Count; i++) {
+		if (i == (int)RenderCall::UpdateBuffer || i == (int)RenderCall::InstanceData) continue;
+		if (i == (int)RenderCall::UploadConstants) continue;
+		if (i == (int)RenderCall::DrawIndexed || i == (int)RenderCall::DrawIndexedInstanced) continue;
+		changes += counts_[i];
+	}
+
+	return changes;
+}
+
+void RecordingRenderContext::Clear()
+{
+	calls_.clear();
+	constantOffset_ = 0;
+	for (int i = 0; i < (int)RenderCall::Count; i++) counts_[i] = 0;
+}
+
+void RecordingRenderContext::Record(RenderCall call, const void* object, unsigned int value)
+{
+	calls_.push_back({ call, object, value });
+	counts_[(int)call]++;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include "RenderContext.h"
+#include <vector>
+
+// Writes down every call instead of making it, for checking what a frame
+// submits without a device. Nothing it's given is ever dereferenced, so
+// any distinct pointers will do for shaders, buffers and so on.
+
+enum class RenderCall {
+	VertexShader,
+	PixelShader,
+	InputLayout,
+	BlendState,
+	RasteriserState,
+	DepthStencilState,
+	PrimitiveTopology,
+	VertexBuffer,
+	IndexBuffer,
+	VSConstantBuffer,
+	PSConstantBuffer,
+	PSResource,
+	VSConstantRange,
+	UpdateBuffer,
+	UploadConstants,
+	InstanceData,
+	DrawIndexed,
+	DrawIndexedInstanced,
+
+	Count
+};
+
+struct RecordedCall {
+	RenderCall			Call;
+	const void*			Object;		// whatever was bound or updated
+	unsigned int		Value;		// the slot, stride, topology, size, index
+									// count or instance count
+};
+
+class RecordingRenderContext : public RenderContext
+{
+public:
+	RecordingRenderContext();
+	~RecordingRenderContext();
+
+	void				SetVertexShader(ID3D11VertexShader* shader);
+	void				SetPixelShader(ID3D11PixelShader* shader);
+	void				SetInputLayout(ID3D11InputLayout* layout);
+
+	void				SetBlendState(ID3D11BlendState* state);
+	void				SetRasteriserState(ID3D11RasterizerState* state);
+	void				SetDepthStencilState(ID3D11DepthStencilState* state);
+
+	void				SetPrimitiveTopology(PrimitiveTopology topology);
+	void				SetVertexBuffer(ID3D11Buffer* buffer, unsigned int stride);
+	void				SetIndexBuffer(ID3D11Buffer* buffer);
+
+	void				SetVSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer);
+	void				SetPSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer);
+	void				SetPSResource(unsigned int slot, ID3D11ShaderResourceView* view);
+	void				SetVSConstantRange(unsigned int slot, const ConstantRange& range);
+
+	void				UpdateBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size);
+	ConstantRange		UploadConstants(const void* data, unsigned int size);
+
+	void				SetInstanceData(const void* data, unsigned int stride, unsigned int count);
+
+	void				DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void				DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+
+	void				BeginFrame();
+	void				EndFrame();
+	UploadStats			GetUploadStats() const;
+
+	inline const std::vector<RecordedCall>&	GetCalls() const { return calls_; }
+	inline unsigned int	GetCount(RenderCall call) const { return counts_[(int)call]; }
+
+	// every call that only binds something, so everything but uploads
+	// and draws
+	unsigned int		GetStateChanges() const;
+
+	void				Clear();
+
+private:
+	void				Record(RenderCall call, const void* object, unsigned int value);
+
+	// stands in for the buffer uploaded constants go to
+	char				constantRing_;
+	unsigned int		constantOffset_;
+
+	std::vector<RecordedCall>	calls_;
+	unsigned int		counts_[(int)RenderCall::Count];
+};
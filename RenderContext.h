@@ -0,0 +1,85 @@
+#pragma once
+#include "UploadRing.h"
+
+// The device context calls the renderers make, behind an interface so
+// that what a frame submits can be replayed against something other than
+// a real device. D3D objects only ever pass through as opaque pointers.
+//
+// Index buffers are always 32 bit, and blend states always use a zero
+// blend factor and a full sample mask, since that's all we ever ask for.
+//
+// None of this needs the Direct3D headers, so the contexts that don't
+// talk to a device can be built and tested anywhere.
+
+struct ID3D11Buffer;
+struct ID3D11VertexShader;
+struct ID3D11PixelShader;
+struct ID3D11InputLayout;
+struct ID3D11BlendState;
+struct ID3D11RasterizerState;
+struct ID3D11DepthStencilState;
+struct ID3D11ShaderResourceView;
+
+// the topologies we draw with, turned into D3D11_PRIMITIVE_TOPOLOGY by
+// the device context
+enum class PrimitiveTopology {
+	TriangleList,
+	TriangleStrip,
+	LineList
+};
+
+// a slice of a constant buffer, counted in 16 byte constants
+struct ConstantRange {
+	ID3D11Buffer*		Buffer;
+	unsigned int		FirstConstant;
+	unsigned int		ConstantCount;
+};
+
+class RenderContext
+{
+public:
+	RenderContext() {}
+	virtual ~RenderContext() {}
+
+	virtual void		SetVertexShader(ID3D11VertexShader* shader) = 0;
+	virtual void		SetPixelShader(ID3D11PixelShader* shader) = 0;
+	virtual void		SetInputLayout(ID3D11InputLayout* layout) = 0;
+
+	virtual void		SetBlendState(ID3D11BlendState* state) = 0;
+	virtual void		SetRasteriserState(ID3D11RasterizerState* state) = 0;
+	virtual void		SetDepthStencilState(ID3D11DepthStencilState* state) = 0;
+
+	virtual void		SetPrimitiveTopology(PrimitiveTopology topology) = 0;
+	virtual void		SetVertexBuffer(ID3D11Buffer* buffer, unsigned int stride) = 0;
+	virtual void		SetIndexBuffer(ID3D11Buffer* buffer) = 0;
+
+	virtual void		SetVSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer) = 0;
+	virtual void		SetPSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer) = 0;
+	virtual void		SetPSResource(unsigned int slot, ID3D11ShaderResourceView* view) = 0;
+
+	// bind part of a constant buffer, as handed out by UploadConstants
+	virtual void		SetVSConstantRange(unsigned int slot, const ConstantRange& range) = 0;
+
+	// replace the whole contents of a default-usage buffer
+	virtual void		UpdateBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size) = 0;
+
+	// copy constants somewhere the GPU can read them. the range stays good
+	// until the GPU has finished the frame, so it's meant for data that
+	// changes from one draw to the next.
+	virtual ConstantRange	UploadConstants(const void* data, unsigned int size) = 0;
+
+	// upload this frame's per-instance data and bind it as the second
+	// vertex stream, for DrawIndexedInstanced to index into
+	virtual void		SetInstanceData(const void* data, unsigned int stride, unsigned int count) = 0;
+
+	virtual void		DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex) = 0;
+	virtual void		DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance) = 0;
+
+	// bracket everything uploaded for one frame, so the space it used can
+	// be handed out again once the GPU has finished with it
+	virtual void		BeginFrame() = 0;
+	virtual void		EndFrame() = 0;
+
+	// how full the upload space has got, and how often it's had to wait
+	virtual UploadStats	GetUploadStats() const = 0;
+};
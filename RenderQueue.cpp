@@ -0,0 +1,152 @@
+#include "RenderQueue.h"
+#include "Renderer.h"
+#include "RenderContext.h"
+#include <algorithm>
+
+const unsigned int		RENDERER_BITS =		8;
+const unsigned int		MATERIAL_BITS =		16;
+const unsigned int		TEXTURE_BITS =		16;
+const unsigned int		DEPTH_BITS =		22;
+
+RenderQueue::RenderQueue(float sortDepth) :
+	sortDepth_(sortDepth),
+	submitted_(0),
+	instanceCount_(0),
+	instanceGroupCount_(0),
+	triangleCount_(0),
+	rendererChanges_(0),
+	materialChanges_(0),
+	textureChanges_(0)
+{
+	XMStoreFloat4x4(&view_, XMMatrixIdentity());
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::Begin(FXMMATRIX view)
+{
+	XMStoreFloat4x4(&view_, view);
+
+	items_.clear();
+	order_.clear();
+	instances_.Clear();
+}
+
+unsigned int RenderQueue::GetSortId(std::unordered_map<const void*, unsigned int>& ids, const void* object, unsigned int limit)
+{
+	auto found = ids.find(object);
+	if (found != ids.end()) return found->second;
+
+	// past the limit ids wrap around. that only costs some sorting, since
+	// items are never told apart by their key.
+	unsigned int id = (unsigned int)ids.size() & (limit - 1);
+	ids[object] = id;
+	return id;
+}
+
+void RenderQueue::Add(RenderPass pass, const DrawItem& item)
+{
+	unsigned long long rendererId = GetSortId(rendererIds_, item.Owner, 1 << RENDERER_BITS);
+	unsigned long long materialId = GetSortId(materialIds_, item.Surface, 1 << MATERIAL_BITS);
+	unsigned long long textureId = GetSortId(textureIds_, item.Texture, 1 << TEXTURE_BITS);
+
+	// a group as a whole sorts by its first instance
+	const XMFLOAT4X4& placed = (item.InstanceCount > 0) ? instances_.GetInstances()[item.InstanceStart] : item.World;
+	XMVECTOR position = XMVectorSet(placed._41, placed._42, placed._43, 1.0f);
+
+	// how far in front of the camera the item is, squashed down to
+	// DEPTH_BITS
+	XMVECTOR viewPosition = XMVector3Transform(position, XMLoadFloat4x4(&view_));
+	float depth = std::max<float>(0.0f, std::min<float>(XMVectorGetZ(viewPosition) / sortDepth_, 1.0f));
+
+	unsigned long long maxDepth = (1ull << DEPTH_BITS) - 1;
+	unsigned long long depthBits = (unsigned long long)(depth * maxDepth);
+
+	unsigned long long key = (unsigned long long)pass << 62;
+
+	if (pass == RenderPass::Opaque) {
+		key |= rendererId << (MATERIAL_BITS + TEXTURE_BITS + DEPTH_BITS);
+		key |= materialId << (TEXTURE_BITS + DEPTH_BITS);
+		key |= textureId << DEPTH_BITS;
+		key |= depthBits;
+	}
+	else {
+		key |= (maxDepth - depthBits) << (RENDERER_BITS + MATERIAL_BITS + TEXTURE_BITS);
+		key |= rendererId << (MATERIAL_BITS + TEXTURE_BITS);
+		key |= materialId << TEXTURE_BITS;
+		key |= textureId;
+	}
+
+	order_.push_back({ key, (unsigned int)items_.size() });
+	items_.push_back(item);
+}
+
+void RenderQueue::AddInstance(Renderer* renderer, Mesh* model, unsigned int lod, FXMMATRIX world)
+{
+	instances_.Add(renderer, model, lod, world);
+}
+
+void RenderQueue::Submit(RenderContext& context)
+{
+	// turn the instances into groups, and let each group's renderer queue
+	// whatever it takes to draw them
+	instances_.Build();
+
+	const std::vector<InstanceGroup>& groups = instances_.GetGroups();
+	const std::vector<XMFLOAT4X4>& instances = instances_.GetInstances();
+
+	for (const InstanceGroup& group : groups) {
+		group.Owner->QueueInstances(*this, group);
+	}
+
+	context.SetInstanceData(instances.data(), sizeof(XMFLOAT4X4), (unsigned int)instances.size());
+
+	instanceCount_ = instances.size();
+	instanceGroupCount_ = groups.size();
+
+	// ties go to whichever was queued first, so the order is the same
+	// every run
+	std::sort(order_.begin(), order_.end(), [](const SortEntry& a, const SortEntry& b) {
+		return (a.Key != b.Key) ? a.Key < b.Key : a.Index < b.Index;
+	});
+
+	rendererChanges_ = 0;
+	materialChanges_ = 0;
+	textureChanges_ = 0;
+	triangleCount_ = 0;
+
+	Renderer* current = nullptr;
+	const DrawItem* previous = nullptr;
+
+	for (const SortEntry& entry : order_) {
+		const DrawItem& item = items_[entry.Index];
+
+		if (item.Owner != current) {
+			if (current != nullptr) current->EndQueued(context);
+
+			current = item.Owner;
+			current->BeginQueued(context);
+
+			previous = nullptr;
+			rendererChanges_++;
+		}
+
+		if (previous == nullptr || previous->Surface != item.Surface) materialChanges_++;
+		if (previous == nullptr || previous->Texture != item.Texture) textureChanges_++;
+
+		current->DrawQueued(context, item, previous);
+		previous = &item;
+
+		triangleCount_ += item.IndexCount / 3 * std::max<unsigned int>(item.InstanceCount, 1);
+	}
+
+	if (current != nullptr) current->EndQueued(context);
+
+	submitted_ = items_.size();
+
+	items_.clear();
+	order_.clear();
+	instances_.Clear();
+}
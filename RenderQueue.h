@@ -0,0 +1,125 @@
+#pragma once
+#include "InstanceBatcher.h"
+#include <vector>
+#include <unordered_map>
+
+class Renderer;
+class RenderContext;
+class SubMesh;
+class Material;
+
+// Collects every draw in a frame so they can be made in whatever order
+// changes the least state, rather than the order the scene graph happens
+// to be walked in.
+//
+// Each item gets a 64 bit sort key. Opaque items sort by renderer, then
+// material, then texture, then front to back:
+//
+//	| pass:2 | renderer:8 | material:16 | texture:16 | depth:22 |
+//
+// Transparent items come after every opaque one, and have to be drawn back
+// to front whatever that costs, so their depth moves up front:
+//
+//	| pass:2 | far-to-near depth:22 | renderer:8 | material:16 | texture:16 |
+//
+// Opaque meshes can also be queued as instances. Every instance of the
+// same mesh is gathered into one group when the queue is submitted, and
+// its renderer queues one instanced item per sub-mesh for the whole group.
+//
+// The queue never looks inside the meshes or materials it's given, so it
+// only needs DirectXMath and can be tested against a recording context.
+
+enum class RenderPass {
+	Opaque = 0,
+	Transparent = 1
+};
+
+struct DrawItem {
+	Renderer*			Owner;
+	SubMesh*			Geometry;
+	Material*			Surface;
+	unsigned int		Lod;
+
+	// the surface's texture, to sort by, and how many indices the
+	// geometry has at Lod, to count triangles by
+	const void*			Texture;
+	unsigned int		IndexCount;
+
+	// for instanced items, this only places the sub-mesh within its mesh,
+	// and the group's world matrices are in the instance data. the
+	// instance range is zero for everything else.
+	XMFLOAT4X4			World;
+	unsigned int		InstanceStart;
+	unsigned int		InstanceCount;
+};
+
+class RenderQueue
+{
+public:
+	// items further away than sortDepth sort as if they were that far
+	RenderQueue(float sortDepth);
+	~RenderQueue();
+
+	// start a new frame, seen through view
+	void				Begin(FXMMATRIX view);
+
+	// queue a draw. items that aren't instanced sort by where World puts
+	// them, and instanced ones by the first instance of their group.
+	// whatever the item points to has to outlive the call to Submit.
+	void				Add(RenderPass pass, const DrawItem& item);
+
+	// queue one instance of model, to be drawn along with every other
+	// instance of it at the same level of detail. its renderer gets a
+	// call to QueueInstances for the whole group when the queue is
+	// submitted.
+	void				AddInstance(Renderer* renderer, Mesh* model, unsigned int lod, FXMMATRIX world);
+
+	// sort everything queued since Begin, draw it and empty the queue
+	void				Submit(RenderContext& context);
+
+	inline size_t		GetCount() const { return items_.size(); }
+	inline size_t		GetSubmittedCount() const { return submitted_; }
+
+	// instances, and the groups they were drawn in, in the last submit
+	inline size_t		GetInstanceCount() const { return instanceCount_; }
+	inline size_t		GetInstanceGroupCount() const { return instanceGroupCount_; }
+
+	// triangles drawn in the last submit, counting every instance
+	inline unsigned long long	GetTriangleCount() const { return triangleCount_; }
+
+	// how often consecutive items switched renderer, material or texture
+	// in the last submit, for comparing against the unsorted order
+	inline unsigned int	GetRendererChanges() const { return rendererChanges_; }
+	inline unsigned int	GetMaterialChanges() const { return materialChanges_; }
+	inline unsigned int	GetTextureChanges() const { return textureChanges_; }
+
+private:
+	struct SortEntry {
+		unsigned long long	Key;
+		unsigned int		Index;
+	};
+
+	// small ids for the key, handed out in order of first use. they stay
+	// the same from frame to frame, so equal keys stay equal.
+	unsigned int		GetSortId(std::unordered_map<const void*, unsigned int>& ids, const void* object, unsigned int limit);
+
+	float				sortDepth_;
+	XMFLOAT4X4			view_;
+
+	std::vector<DrawItem>	items_;
+	std::vector<SortEntry>	order_;
+
+	InstanceBatcher		instances_;
+
+	std::unordered_map<const void*, unsigned int>	rendererIds_;
+	std::unordered_map<const void*, unsigned int>	materialIds_;
+	std::unordered_map<const void*, unsigned int>	textureIds_;
+
+	size_t				submitted_;
+	size_t				instanceCount_;
+	size_t				instanceGroupCount_;
+	unsigned long long	triangleCount_;
+	unsigned int		rendererChanges_;
+	unsigned int		materialChanges_;
+	unsigned int		textureChanges_;
+};
@@ -1,5 +1,10 @@
 #pragma once
 
+class RenderContext;
+class RenderQueue;
+struct DrawItem;
+struct InstanceGroup;
+
 class Renderer
 {
 public:
@@ -7,7 +12,16 @@ public:
 	virtual ~Renderer() {}
 
 	virtual bool Initialise() = 0;
-	virtual void Render() = 0;
+	virtual void Render() {};
 	virtual void Shutdown() {};
-};
 
+	// drawing through the render queue. each run of items a renderer
+	// queued is drawn between one Begin and End, and previous is the item
+	// drawn just before this one in the same run, if any.
+	virtual void BeginQueued(RenderContext& context) {};
+	virtual void DrawQueued(RenderContext& context, const DrawItem& item, const DrawItem* previous) {};
+	virtual void EndQueued(RenderContext& context) {};
+
+	// queue the draws for a group of instances this renderer added
+	virtual void QueueInstances(RenderQueue& queue, const InstanceGroup& group) {};
+};
@@ -7,7 +7,12 @@
 #include "WICTextureLoader.h"
 #include <locale>
 #include <codecvt>
+#include <cfloat>
+#include <algorithm>
 #include "MeshRenderer.h"
+#include "MeshOptimiser.h"
+#include "MeshSimplifier.h"
+#include <chrono>
 
 #pragma comment(lib, "../Assimp/lib/release/assimp-vc140-mt.lib")
 
@@ -36,6 +41,9 @@ ResourceManager::ResourceManager()
 	device_ = DirectXFramework::GetDXFramework()->GetDevice();
 	deviceContext_ = DirectXFramework::GetDXFramework()->GetDeviceContext();
 
+	// every static mesh shares the same vertex and index buffers
+	geometryPool_ = std::make_shared<GeometryPool>(device_, deviceContext_, sizeof(VERTEX), GEOMETRY_POOL_VERTICES, GEOMETRY_POOL_INDICES);
+
 	// create our default texture
 	HRESULT result
 		= CreateWICTextureFromFile(
@@ -54,9 +62,11 @@ ResourceManager::~ResourceManager(void)
 {
 }
 
-std::shared_ptr<Renderer> ResourceManager::GetRenderer(std::wstring rendererName)
+std::shared_ptr<Renderer> ResourceManager::GetRenderer(const std::wstring& rendererName)
 {
-	RendererResourceMap::iterator it = rendererResources_.find(rendererName);
+	NameId rendererId = NameTable::Intern(rendererName);
+
+	RendererResourceMap::iterator it = rendererResources_.find(rendererId);
 	if (it != rendererResources_.end())
 	{
 		return it->second;
@@ -66,14 +76,14 @@ std::shared_ptr<Renderer> ResourceManager::GetRenderer(std::wstring rendererName
 		if (rendererName == L"PNT")
 		{
 			std::shared_ptr<Renderer> renderer = std::make_shared<MeshRenderer>();
-			rendererResources_[rendererName] = renderer;
+			rendererResources_[rendererId] = renderer;
 			return renderer;
 		}
 	}
 	return nullptr;
 }
 
-std::shared_ptr<Mesh> ResourceManager::GetMesh(std::wstring modelName)
+std::shared_ptr<Mesh> ResourceManager::GetMesh(NameId modelName)
 {
 	// check if the mesh is cached
 	MeshResourceMap::iterator it = meshResources_.find(modelName);
@@ -86,7 +96,7 @@ std::shared_ptr<Mesh> ResourceManager::GetMesh(std::wstring modelName)
 	else
 	{
 		// we need to load the mesh file
-		std::wcout << L"loading mesh " << modelName << L"...\t";
+		std::wcout << L"loading mesh " << NameTable::GetString(modelName) << L"...\t";
 		std::shared_ptr<Mesh> mesh = LoadModelFromFile(modelName);
 
 		if (mesh != nullptr)
@@ -107,7 +117,7 @@ std::shared_ptr<Mesh> ResourceManager::GetMesh(std::wstring modelName)
 	}
 }
 
-void ResourceManager::ReleaseMesh(std::wstring modelName)
+void ResourceManager::ReleaseMesh(NameId modelName)
 {
 	MeshResourceMap::iterator it = meshResources_.find(modelName);
 	if (it != meshResources_.end())
@@ -123,8 +133,7 @@ void ResourceManager::ReleaseMesh(std::wstring modelName)
 			for (unsigned int i = 0; i < subMeshCount; i++)
 			{
 				std::shared_ptr<SubMesh> subMesh = mesh->GetSubMesh(i);
-				std::wstring materialName = subMesh->GetMaterial()->GetMaterialName();
-				ReleaseMaterial(materialName);
+				ReleaseMaterial(subMesh->GetMaterial()->GetMaterialId());
 			}
 
 			// if no other nodes are using this mesh, remove it from the map
@@ -135,10 +144,10 @@ void ResourceManager::ReleaseMesh(std::wstring modelName)
 	}
 }
 
-void ResourceManager::CreateMaterialFromTexture(std::wstring textureName)
+void ResourceManager::CreateMaterialFromTexture(const std::wstring& textureName)
 {
     return InitialiseMaterial(
-		textureName, 
+		NameTable::Intern(textureName), 
 		XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f), 
 		XMFLOAT4(0.0f, 0.0f, 0.0f, 1.0f),
 		0,
@@ -147,17 +156,17 @@ void ResourceManager::CreateMaterialFromTexture(std::wstring textureName)
 	);
 }
 
-void ResourceManager::CreateMaterialWithNoTexture(std::wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity)
+void ResourceManager::CreateMaterialWithNoTexture(const std::wstring& materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity)
 {
-    return InitialiseMaterial(materialName, diffuseColour, specularColour, shininess, opacity, L"");
+    return InitialiseMaterial(NameTable::Intern(materialName), diffuseColour, specularColour, shininess, opacity, L"");
 }
 
-void ResourceManager::CreateMaterial(std::wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, std::wstring textureName)
+void ResourceManager::CreateMaterial(const std::wstring& materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, const std::wstring& textureName)
 {
-    return InitialiseMaterial(materialName, diffuseColour, specularColour, shininess, opacity, textureName);
+    return InitialiseMaterial(NameTable::Intern(materialName), diffuseColour, specularColour, shininess, opacity, textureName);
 }
 
-std::shared_ptr<Material> ResourceManager::GetMaterial(std::wstring materialName)
+std::shared_ptr<Material> ResourceManager::GetMaterial(NameId materialName)
 {
 	MaterialResourceMap::iterator it = materialResources_.find(materialName);
 	if (it != materialResources_.end())
@@ -168,7 +177,7 @@ std::shared_ptr<Material> ResourceManager::GetMaterial(std::wstring materialName
 	return nullptr;
 }
 
-void ResourceManager::ReleaseMaterial(std::wstring materialName)
+void ResourceManager::ReleaseMaterial(NameId materialName)
 {
 	MaterialResourceMap::iterator it = materialResources_.find(materialName);
 	if (it != materialResources_.end())
@@ -177,12 +186,12 @@ void ResourceManager::ReleaseMaterial(std::wstring materialName)
 		if (it->second.ReferenceCount == 0)
 		{
 			it->second.MaterialPointer = nullptr;
-			meshResources_.erase(materialName);
+			materialResources_.erase(materialName);
 		}
 	}
 }
 
-void ResourceManager::InitialiseMaterial(std::wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, std::wstring textureName)
+void ResourceManager::InitialiseMaterial(NameId materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, const std::wstring& textureName)
 {
 	MaterialResourceMap::iterator it = materialResources_.find(materialName);
 	if (it == materialResources_.end())
@@ -212,6 +221,7 @@ void ResourceManager::InitialiseMaterial(std::wstring materialName, XMFLOAT4 dif
 			texture = defaultTexture_;
 		}
 		std::shared_ptr<Material> material = std::make_shared<Material>(materialName, diffuseColour, specularColour, shininess, opacity, texture);
+		material->BuildConstantBuffer(device_);
 		MaterialResourceStruct resourceStruct;
 		resourceStruct.ReferenceCount = 0;
 		resourceStruct.MaterialPointer = material;
@@ -222,7 +232,19 @@ void ResourceManager::InitialiseMaterial(std::wstring materialName, XMFLOAT4 dif
 std::shared_ptr<Node> ResourceManager::CreateNodes(aiNode * sceneNode)
 {
 	std::shared_ptr<Node> node = std::make_shared<Node>();
-	node->SetName(s2ws(std::string(sceneNode->mName.C_Str())));
+	node->SetName(NameTable::Intern(s2ws(std::string(sceneNode->mName.C_Str()))));
+
+	if (MESH_NODE_TRANSFORMS)
+	{
+		// assimp's matrices transform column vectors, so transpose them
+		const aiMatrix4x4& m = sceneNode->mTransformation;
+		node->SetTransformation(XMMATRIX(
+			m.a1, m.b1, m.c1, m.d1,
+			m.a2, m.b2, m.c2, m.d2,
+			m.a3, m.b3, m.c3, m.d3,
+			m.a4, m.b4, m.c4, m.d4
+		));
+	}
 
 	// get the meshes associated with this node
 	unsigned int meshCount = sceneNode->mNumMeshes;
@@ -240,17 +262,17 @@ std::shared_ptr<Node> ResourceManager::CreateNodes(aiNode * sceneNode)
 	return node;
 }
 
-std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
+std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(NameId modelName)
 {
-	ComPtr<ID3D11Buffer> vertexBuffer;
-	ComPtr<ID3D11Buffer> indexBuffer;
-    std::wstring * materials = nullptr;
+	std::vector<NameId> materials;
+
+	const std::wstring& modelPath = NameTable::GetString(modelName);
 	
 	Importer importer;
 
 	unsigned int postProcessSteps = aiProcess_Triangulate |
 		                            aiProcess_ConvertToLeftHanded;
-	std::string modelNameUTF8 = ws2s(modelName);
+	std::string modelNameUTF8 = ws2s(modelPath);
 	const aiScene * scene = importer.ReadFile(modelNameUTF8.c_str(), postProcessSteps);
 
 	if (!scene || !scene->HasMeshes())
@@ -262,23 +284,23 @@ std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
     if (scene->HasMaterials())
     {
 		// dirty hack to get directory
-        std::string::size_type slashIndex = modelNameUTF8.find_last_of("\\");
-        std::string directory;
-        if (slashIndex == std::string::npos) 
+        std::wstring::size_type slashIndex = modelPath.find_last_of(L"\\");
+        std::wstring directory;
+        if (slashIndex == std::wstring::npos) 
         {
-            directory = ".";
+            directory = L".";
         }
         else if (slashIndex == 0) 
         {
-            directory = "/";
+            directory = L"/";
         }
         else 
         {
-            directory = modelNameUTF8.substr(0, slashIndex);
+            directory = modelPath.substr(0, slashIndex);
         }
 
         // deal with the materials/textures first
-        materials = new std::wstring[scene->mNumMaterials];
+        materials.resize(scene->mNumMaterials);
         for (unsigned int i = 0; i < scene->mNumMaterials; i++)
         {
             // get the core material properties. 
@@ -304,7 +326,7 @@ std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
 			bool defaultTwoSided = false;
 			bool& twoSided = defaultTwoSided;
 			material->Get(AI_MATKEY_TWOSIDED, twoSided);
-			std::string fullTextureNamePath = "";
+			std::wstring fullTextureNamePath = L"";
             if (material->GetTextureCount(aiTextureType_DIFFUSE) > 0)
             {
                 aiString textureName;
@@ -314,35 +336,47 @@ std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
                 {
                     // get full path to texture by prepending the same folder as included in the model name.
                     // assumes that textures are in the same folder as the model files (not ideal)
-                    fullTextureNamePath = directory + "\\" + textureName.data;
+                    fullTextureNamePath = directory + L"\\" + s2ws(textureName.data);
                 }
             }
 
             // create a unique name for the material
-            std::stringstream materialNameStream;
-            materialNameStream << modelNameUTF8 << i;
-            std::string materialName = materialNameStream.str();
-			std::wstring materialNameWS = s2ws(materialName);
+			NameId materialName = NameTable::Intern(modelPath + std::to_wstring(i));
 
-			CreateMaterial(
-				materialNameWS,
+			InitialiseMaterial(
+				materialName,
 				XMFLOAT4(diffuseColour.r, diffuseColour.g, diffuseColour.b, 1.0f),
 				XMFLOAT4(specularColour.r, specularColour.g, specularColour.b, 1.0f),
 				shininess,
 				opacity, 
-				s2ws(fullTextureNamePath)
+				fullTextureNamePath
 			);
 
-            materials[i] = materialNameWS;
+            materials[i] = materialName;
         }
     }
 
 	// === build up mesh === //
 	std::shared_ptr<Mesh> resourceMesh = std::make_shared<Mesh>();
 
+	// totals over every sub-mesh, reported once the model's loaded
+	unsigned int verticesBefore = 0;
+	unsigned int verticesAfter = 0;
+	float missesBefore = 0.0f;
+	float missesAfter = 0.0f;
+	unsigned int triangles = 0;
+
+	// and for building levels of detail
+	unsigned long long lodTriangles = 0;
+	double lodSeconds = 0.0;
+
     for (unsigned int sm = 0; sm < scene->mNumMeshes; sm++)
     {
 	    aiMesh * subMesh = scene->mMeshes[sm];
+
+		// grown to fit every vertex as we go, for culling
+		XMVECTOR boundsMin = XMVectorReplicate(FLT_MAX);
+		XMVECTOR boundsMax = XMVectorReplicate(-FLT_MAX);
 	    unsigned int numVertices = subMesh->mNumVertices;
 	    bool hasNormals = subMesh->HasNormals();
 	    bool hasTexCoords = subMesh->HasTextureCoords(0);
@@ -365,6 +399,10 @@ std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
 			currentVertex->Position = XMFLOAT3(subMeshVertices->x, subMeshVertices->y, subMeshVertices->z);
 			currentVertex->Normal = XMFLOAT3(subMeshNormals->x, subMeshNormals->y, subMeshNormals->z);
 
+			XMVECTOR position = XMLoadFloat3(&currentVertex->Position);
+			boundsMin = XMVectorMin(boundsMin, position);
+			boundsMax = XMVectorMax(boundsMax, position);
+
 		    subMeshVertices++;
 		    subMeshNormals++;
 
@@ -397,23 +435,6 @@ std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
 		    currentVertex++;
 	    }
 
-		D3D11_BUFFER_DESC vertexBufferDescriptor;
-
-		vertexBufferDescriptor.Usage =					D3D11_USAGE_IMMUTABLE;
-		vertexBufferDescriptor.ByteWidth =				sizeof(VERTEX) * numVertices;
-		vertexBufferDescriptor.BindFlags =				D3D11_BIND_VERTEX_BUFFER;
-		vertexBufferDescriptor.CPUAccessFlags =			0;
-		vertexBufferDescriptor.MiscFlags =				0;
-		vertexBufferDescriptor.StructureByteStride =	0;
-
-		D3D11_SUBRESOURCE_DATA vertexInitialisationData;
-		vertexInitialisationData.pSysMem = modelVertices;
-
-		HRESULT result
-			= device_->CreateBuffer(&vertexBufferDescriptor, &vertexInitialisationData, vertexBuffer.GetAddressOf());
-
-		if (FAILED(result)) return nullptr;
-
 		// extract indices
 	    unsigned int numberOfFaces = subMesh->mNumFaces;
 	    unsigned int numberOfIndices = numberOfFaces * 3;
@@ -422,10 +443,11 @@ std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
 	    if (subMeshFaces->mNumIndices != 3)
 	    {
 			// we can only handle tris for now
+			delete[] modelVertices;
 		    return nullptr;
 	    }
 
-	    unsigned int * modelIndices = new unsigned int[numberOfIndices * 3];
+	    unsigned int * modelIndices = new unsigned int[numberOfIndices];
 	    unsigned int * currentIndex  = modelIndices;
 
 	    for (unsigned int i = 0; i < numberOfFaces; i++)
@@ -436,25 +458,24 @@ std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
 		    subMeshFaces++;
 	    }
 
-		// create our index buffer
-		D3D11_BUFFER_DESC indexBufferDescriptor;
-		indexBufferDescriptor.Usage = D3D11_USAGE_IMMUTABLE;
-		indexBufferDescriptor.ByteWidth = sizeof(UINT) * numberOfIndices * 3;
-		indexBufferDescriptor.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		indexBufferDescriptor.CPUAccessFlags = 0;
-		indexBufferDescriptor.MiscFlags = 0;
-		indexBufferDescriptor.StructureByteStride = 0;
-
-		D3D11_SUBRESOURCE_DATA indexInitialisationData;
-		indexInitialisationData.pSysMem = modelIndices;
-
-		result = device_->CreateBuffer(
-			&indexBufferDescriptor, 
-			&indexInitialisationData, 
-			indexBuffer.GetAddressOf()
-		);
+		if (MESH_OPTIMISATION)
+		{
+			// weld, then reorder for the vertex cache, overdraw and vertex
+			// fetch. the triangles stay the same, just fewer vertices.
+			std::vector<unsigned int> indices(modelIndices, modelIndices + numberOfIndices);
+			MeshOptimiserStats stats = OptimiseMesh(modelVertices, numVertices, sizeof(VERTEX), indices);
+			std::copy(indices.begin(), indices.end(), modelIndices);
+			numVertices = stats.VerticesAfter;
+
+			verticesBefore += stats.VerticesBefore;
+			verticesAfter += stats.VerticesAfter;
+			missesBefore += stats.AcmrBefore * stats.Triangles;
+			missesAfter += stats.AcmrAfter * stats.Triangles;
+			triangles += stats.Triangles;
+		}
 
-		if (FAILED(result)) return nullptr;
+		// copy both into the shared geometry pool
+		GeometryAllocation geometry = geometryPool_->Add(modelVertices, numVertices, modelIndices, numberOfIndices);
 
 		// do we have a material associated with this mesh?
 		
@@ -466,19 +487,71 @@ std::shared_ptr<Mesh> ResourceManager::LoadModelFromFile(std::wstring modelName)
 
 	    std::shared_ptr<SubMesh> resourceSubMesh 
 			= std::make_shared<SubMesh>(
-				vertexBuffer, 
-				indexBuffer, 
+				geometryPool_, 
+				geometry, 
 				numVertices, 
 				numberOfIndices, 
 				material
 			);
 
+		BoundingBox bounds;
+		BoundingBox::CreateFromPoints(bounds, boundsMin, boundsMax);
+		resourceSubMesh->SetBounds(bounds);
+
+		if (MESH_LOD_LEVELS > 0)
+		{
+			// every level is simplified from the original, so its error is
+			// measured against what was loaded rather than the level before
+			std::vector<unsigned int> indices(modelIndices, modelIndices + numberOfIndices);
+			std::vector<unsigned int> lodIndices;
+			size_t previousCount = numberOfIndices;
+			float maxError = XMVectorGetX(XMVector3Length(XMLoadFloat3(&bounds.Extents))) * MESH_LOD_MAX_ERROR;
+			float target = (float)numberOfIndices;
+
+			for (unsigned int level = 1; level <= MESH_LOD_LEVELS; level++)
+			{
+				target *= MESH_LOD_REDUCTION;
+
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+				float error = SimplifyMesh(modelVertices, numVertices, sizeof(VERTEX), indices, (unsigned int)target / 3 * 3, maxError, lodIndices);
+				lodSeconds += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+				lodTriangles += numberOfFaces;
+
+				// nothing much left that can go without breaking the error
+				// limit, so any further levels would be the same again
+				if (lodIndices.empty() || lodIndices.size() > previousCount * 9 / 10) break;
+
+				if (MESH_LOD_VERIFY)
+				{
+					std::cout << "LOD " << level << " error " << error << " (measured " << MeasureSimplificationError(modelVertices, sizeof(VERTEX), indices, lodIndices) << ")... ";
+				}
+
+				OptimiseVertexCache(lodIndices, numVertices);
+
+				GeometryAllocation lodGeometry = geometryPool_->Add(nullptr, 0, lodIndices.data(), (UINT)lodIndices.size());
+				resourceSubMesh->AddLod(lodGeometry, lodIndices.size(), error);
+				previousCount = lodIndices.size();
+			}
+		}
+
 	    resourceMesh->AddSubMesh(resourceSubMesh);
 		delete[] modelVertices;
 		delete[] modelIndices;
     }
 
-	// build our hierarchy
+	if (MESH_OPTIMISATION && triangles > 0)
+	{
+		std::cout << "vertices " << verticesBefore << " -> " << verticesAfter
+			<< ", ACMR " << missesBefore / triangles << " -> " << missesAfter / triangles << "... ";
+	}
+
+	if (lodSeconds > 0.0)
+	{
+		std::cout << "LODs at " << (unsigned long long)(lodTriangles / lodSeconds) << " triangles/s... ";
+	}
+
+	// build our hierarchy, then flatten it for drawing
 	resourceMesh->SetRootNode(CreateNodes(scene->mRootNode));
+	resourceMesh->Bake();
 	return resourceMesh;
 }
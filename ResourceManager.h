@@ -1,6 +1,7 @@
 #pragma once
 #include "Mesh.h"
 #include "Renderer.h"
+#include "NameTable.h"
 #include <map>
 #include <assimp\importer.hpp>
 #include <assimp\scene.h>
@@ -19,7 +20,7 @@ struct MeshResourceStruct
 	std::shared_ptr<Mesh>		MeshPointer;
 };
 
-typedef std::map<std::wstring, MeshResourceStruct>			MeshResourceMap;
+typedef std::map<NameId, MeshResourceStruct>			MeshResourceMap;
 
 struct MaterialResourceStruct
 {
@@ -27,9 +28,9 @@ struct MaterialResourceStruct
 	std::shared_ptr<Material>	MaterialPointer;
 };
 
-typedef std::map<std::wstring, MaterialResourceStruct>		MaterialResourceMap;
+typedef std::map<NameId, MaterialResourceStruct>		MaterialResourceMap;
 
-typedef std::map<std::wstring, std::shared_ptr<Renderer>>	RendererResourceMap;
+typedef std::map<NameId, std::shared_ptr<Renderer>>	RendererResourceMap;
 
 class ResourceManager
 {
@@ -37,16 +38,16 @@ public:
 	ResourceManager();
 	~ResourceManager();
 				
-	std::shared_ptr<Renderer>					GetRenderer(std::wstring rendererName);
+	std::shared_ptr<Renderer>					GetRenderer(const std::wstring& rendererName);
 
-	std::shared_ptr<Mesh>						GetMesh(std::wstring modelName);
-	void										ReleaseMesh(std::wstring modelName);
+	std::shared_ptr<Mesh>						GetMesh(NameId modelName);
+	void										ReleaseMesh(NameId modelName);
 
-	void										CreateMaterialFromTexture(std::wstring textureName);
-    void										CreateMaterialWithNoTexture(std::wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity);
-    void										CreateMaterial(std::wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, std::wstring textureName);
-	std::shared_ptr<Material>					GetMaterial(std::wstring materialName);
-	void										ReleaseMaterial(std::wstring materialName);
+	void										CreateMaterialFromTexture(const std::wstring& textureName);
+    void										CreateMaterialWithNoTexture(const std::wstring& materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity);
+    void										CreateMaterial(const std::wstring& materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, const std::wstring& textureName);
+	std::shared_ptr<Material>					GetMaterial(NameId materialName);
+	void										ReleaseMaterial(NameId materialName);
 
 private:
 	MeshResourceMap								meshResources_;
@@ -57,9 +58,11 @@ private:
 	ComPtr<ID3D11DeviceContext>					deviceContext_;
 
 	ComPtr<ID3D11ShaderResourceView>			defaultTexture_;
+
+	std::shared_ptr<GeometryPool>				geometryPool_;
     
 	std::shared_ptr<Node>						CreateNodes(aiNode * sceneNode);
-	std::shared_ptr<Mesh>						LoadModelFromFile(std::wstring modelName);
-    void										InitialiseMaterial(std::wstring materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, std::wstring textureName);
+	std::shared_ptr<Mesh>						LoadModelFromFile(NameId modelName);
+    void										InitialiseMaterial(NameId materialName, XMFLOAT4 diffuseColour, XMFLOAT4 specularColour, float shininess, float opacity, const std::wstring& textureName);
 };
 
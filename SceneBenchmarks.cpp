@@ -0,0 +1,417 @@
+#include "SceneBenchmarks.h"
+#include "SceneGraph.h"
+#include "SceneFile.h"
+#include "MeshNode.h"
+#include "DirectXFramework.h"
+#include <chrono>
+#include <iostream>
+#include <vector>
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	// a node with nothing to draw, so all we time is the graph itself
+	class BenchmarkNode : public SceneNode
+	{
+	public:
+		BenchmarkNode(NameId name) : SceneNode(name) {};
+
+		bool Initialise()	{ return true; }
+		void Start()		{}
+		void Render()		{}
+		void Shutdown()		{}
+
+		// what Update did before the transform hierarchy, for comparison
+		void CombineWorld(FXMMATRIX parentWorld)
+		{
+			XMStoreFloat4x4(&worldTransformation_, transform_->GetWorldTransform() * parentWorld);
+		}
+	};
+
+	double SecondsSince(Clock::time_point start)
+	{
+		return std::chrono::duration<double>(Clock::now() - start).count();
+	}
+
+	void PrintRate(const char* what, size_t count, double seconds)
+	{
+		std::cout << "  " << what << ": " << count << " in " << (seconds * 1000.0) << "ms ("
+			<< (unsigned long long)(count / seconds) << "/s)" << std::endl;
+	}
+
+	// names are interned up front so that isn't part of any timing
+	std::vector<NameId> MakeNames(const std::wstring& prefix, size_t count)
+	{
+		std::vector<NameId> names(count);
+		for (size_t i = 0; i < count; i++) {
+			names[i] = NameTable::Intern(prefix + std::to_wstring(i));
+		}
+		return names;
+	}
+
+	// how Find worked before graphs kept an index
+	SceneNode* FindByWalking(SceneGraph* graph, NameId name)
+	{
+		for (size_t i = 0; i < graph->GetChildCount(); i++) {
+			SceneNodePointer child = graph->GetChild(i);
+			if (child->GetNameId() == name) return child.get();
+
+			SceneGraph* childGraph = dynamic_cast<SceneGraph*>(child.get());
+			if (childGraph == nullptr) continue;
+
+			SceneNode* found = FindByWalking(childGraph, name);
+			if (found != nullptr) return found;
+		}
+
+		return nullptr;
+	}
+
+	// every level but the last is graphs, the last is benchmark nodes
+	SceneGraphPointer MakeTree(const std::wstring& name, size_t fanOut, int depth)
+	{
+		SceneGraphPointer graph = std::make_shared<SceneGraph>(name);
+		graph->Reserve(fanOut);
+
+		for (size_t i = 0; i < fanOut; i++) {
+			if (depth > 1)	graph->Add(MakeTree(name + L"_" + std::to_wstring(i), fanOut, depth - 1));
+			else			graph->Add(std::make_shared<BenchmarkNode>(NAME_NONE));
+		}
+
+		return graph;
+	}
+
+	// how world matrices were worked out before the hierarchy, each
+	// node combining its parent's on the way down the tree
+	void UpdateByRecursion(SceneGraph* graph, FXMMATRIX parentWorld, int depth)
+	{
+		XMMATRIX world = graph->GetTransform()->GetWorldTransform() * parentWorld;
+
+		for (size_t i = 0; i < graph->GetChildCount(); i++) {
+			SceneNode* child = (*graph)[i].get();
+
+			if (depth > 1)	UpdateByRecursion(static_cast<SceneGraph*>(child), world, depth - 1);
+			else			static_cast<BenchmarkNode*>(child)->CombineWorld(world);
+		}
+	}
+
+	// moves every node at the bottom of the tree a little
+	void MoveLeaves(SceneGraph* graph, int depth)
+	{
+		for (size_t i = 0; i < graph->GetChildCount(); i++) {
+			SceneNode* child = (*graph)[i].get();
+
+			if (depth > 1)	MoveLeaves(static_cast<SceneGraph*>(child), depth - 1);
+			else			child->GetTransform()->Rotate(0.0f, 0.01f, 0.0f);
+		}
+	}
+
+	void BenchmarkFind()
+	{
+		const size_t groupCount = 100;
+		const size_t groupSize = 1000;
+		const size_t walkCount = 100;
+
+		std::cout << "find: " << (groupCount * groupSize) << " nodes in " << groupCount << " graphs" << std::endl;
+
+		std::vector<NameId> names = MakeNames(L"benchmark_find_", groupCount * groupSize);
+		std::vector<std::wstring> strings(names.size());
+		for (size_t i = 0; i < names.size(); i++) {
+			strings[i] = NameTable::GetString(names[i]);
+		}
+
+		SceneGraphPointer graph = std::make_shared<SceneGraph>(L"benchmark_find");
+		graph->Reserve(groupCount);
+
+		for (size_t i = 0; i < groupCount; i++) {
+			SceneGraphPointer group = std::make_shared<SceneGraph>(L"benchmark_find_group_" + std::to_wstring(i));
+			group->Reserve(groupSize);
+
+			for (size_t j = 0; j < groupSize; j++) {
+				group->Add(std::make_shared<BenchmarkNode>(names[i * groupSize + j]));
+			}
+
+			graph->Add(group);
+		}
+
+		size_t found = 0;
+
+		Clock::time_point start = Clock::now();
+		for (NameId name : names) {
+			if (graph->Find(name) != nullptr) found++;
+		}
+		PrintRate("by id", names.size(), SecondsSince(start));
+
+		start = Clock::now();
+		for (const std::wstring& string : strings) {
+			if (graph->Find(string) != nullptr) found++;
+		}
+		PrintRate("by string", strings.size(), SecondsSince(start));
+
+		// the old tree walk is far too slow to do all of them, so just
+		// do a spread of them
+		start = Clock::now();
+		for (size_t i = 0; i < walkCount; i++) {
+			if (FindByWalking(graph.get(), names[i * names.size() / walkCount]) != nullptr) found++;
+		}
+		PrintRate("by walking the tree", walkCount, SecondsSince(start));
+
+		if (found != names.size() * 2 + walkCount) std::cout << "  only found " << found << " nodes" << std::endl;
+
+		graph->OnDetached();
+	}
+
+	void BenchmarkTransforms()
+	{
+		const size_t fanOut = 100;
+		const int depth = 3;
+
+		std::shared_ptr<TransformHierarchy> hierarchy = DirectXFramework::GetDXFramework()->GetTransformHierarchy();
+		SceneGraphPointer graph = MakeTree(L"benchmark_transforms", fanOut, depth);
+
+		// give the top of the tree an entry of its own, as if it had
+		// been added to the scene
+		graph->OnAttached();
+
+		// the first pass puts everything in depth order
+		hierarchy->Update();
+
+		std::cout << "transforms: " << (fanOut * fanOut * fanOut) << " nodes, " << hierarchy->GetCount() << " matrices" << std::endl;
+
+		// every node has moved, so the nodes hand their matrices over and
+		// the hierarchy rebuilds them all
+		MoveLeaves(graph.get(), depth);
+
+		Clock::time_point start = Clock::now();
+		graph->Update();
+		PrintRate("scene update, every node moved", fanOut * fanOut * fanOut, SecondsSince(start));
+
+		start = Clock::now();
+		unsigned int rebuilt = hierarchy->Update();
+		PrintRate("flat pass, every node moved", rebuilt, SecondsSince(start));
+
+		// moving the top of the tree dirties every matrix below it
+		graph->GetTransform()->Rotate(0.0f, 0.01f, 0.0f);
+		graph->Update();
+
+		start = Clock::now();
+		rebuilt = hierarchy->Update();
+		PrintRate("flat pass, root moved", rebuilt, SecondsSince(start));
+
+		// nothing moved, so the nodes and the hierarchy only have to
+		// check their versions and flags
+		start = Clock::now();
+		graph->Update();
+		rebuilt = hierarchy->Update();
+		double seconds = SecondsSince(start);
+		std::cout << "  scene update and flat pass, nothing moved: " << rebuilt << " rebuilt in " << (seconds * 1000.0) << "ms" << std::endl;
+
+		// the old recursion had no way of knowing what moved, so it
+		// always did everything
+		MoveLeaves(graph.get(), depth);
+
+		start = Clock::now();
+		UpdateByRecursion(graph.get(), XMMatrixIdentity(), depth);
+		PrintRate("recursion, every node moved", fanOut * fanOut * fanOut, SecondsSince(start));
+
+		start = Clock::now();
+		UpdateByRecursion(graph.get(), XMMatrixIdentity(), depth);
+		PrintRate("recursion, nothing moved", fanOut * fanOut * fanOut, SecondsSince(start));
+
+		graph->OnDetached();
+	}
+
+	void BenchmarkUpdate()
+	{
+		const size_t nodeCount = 100000;
+		const int repeats = 10;
+
+		std::shared_ptr<JobSystem> jobSystem = DirectXFramework::GetDXFramework()->GetJobSystem();
+		SceneGraphPointer graph = MakeTree(L"benchmark_update", nodeCount, 1);
+		graph->OnAttached();
+
+		std::cout << "update: " << nodeCount << " nodes in one graph, " << jobSystem->GetWorkerCount() << " queues" << std::endl;
+
+		// every node has moved, so every one rebuilds its local matrix
+		// and hands it over
+		double seconds = 0.0;
+		for (int i = 0; i < repeats; i++) {
+			MoveLeaves(graph.get(), 1);
+
+			Clock::time_point start = Clock::now();
+			for (size_t j = 0; j < graph->GetChildCount(); j++) {
+				(*graph)[j]->Update();
+			}
+			seconds += SecondsSince(start);
+		}
+		PrintRate("serial", nodeCount * repeats, seconds);
+
+		unsigned long long stolen = jobSystem->GetJobsStolen();
+
+		seconds = 0.0;
+		for (int i = 0; i < repeats; i++) {
+			MoveLeaves(graph.get(), 1);
+
+			Clock::time_point start = Clock::now();
+			graph->Update();
+			seconds += SecondsSince(start);
+		}
+		PrintRate("parallel", nodeCount * repeats, seconds);
+		std::cout << "  " << (jobSystem->GetJobsStolen() - stolen) << " batches stolen" << std::endl;
+
+		graph->OnDetached();
+	}
+
+	// adds count nodes to the graph, made by make, then takes them all
+	// out again and lets them go
+	template<typename MakeNode>
+	void SpawnAndDestroy(const char* what, SceneGraph* graph, const std::vector<NameId>& names, MakeNode make)
+	{
+		std::shared_ptr<TransformHierarchy> hierarchy = DirectXFramework::GetDXFramework()->GetTransformHierarchy();
+		std::vector<SceneNodePointer> nodes;
+		nodes.reserve(names.size());
+
+		Clock::time_point start = Clock::now();
+		for (NameId name : names) {
+			nodes.push_back(make(name));
+			graph->Add(nodes.back());
+		}
+		double spawnSeconds = SecondsSince(start);
+
+		start = Clock::now();
+		graph->RemoveChildren(nodes.data(), nodes.size());
+		nodes.clear();
+
+		// the hierarchy compacts out the destroyed entries on its next pass
+		hierarchy->Update();
+		double destroySeconds = SecondsSince(start);
+
+		std::cout << "  " << what << ":" << std::endl;
+		PrintRate("  spawn", names.size(), spawnSeconds);
+		PrintRate("  destroy", names.size(), destroySeconds);
+	}
+
+	void BenchmarkSpawn()
+	{
+		const size_t nodeCount = 100000;
+
+		std::cout << "spawn: " << nodeCount << " nodes with colliders, added to and removed from a graph" << std::endl;
+
+		std::vector<NameId> names = MakeNames(L"benchmark_spawn_", nodeCount);
+		SceneGraphPointer graph = std::make_shared<SceneGraph>(L"benchmark_spawn");
+		graph->OnAttached();
+
+		// the first round has to fill the pools, the second reuses them
+		for (int round = 0; round < 2; round++) {
+			SpawnAndDestroy((round == 0) ? "pooled, empty pools" : "pooled", graph.get(), names, [](NameId name) {
+				SceneNodePointer node = MakePooled<BenchmarkNode>(name);
+				node->CreateCollider(0.0f, 1.0f, XMFLOAT3(0, 0, 0), false);
+				return node;
+			});
+		}
+
+		// make_shared still pools the transform and collider, so this only
+		// shows what pooling the node itself saves
+		SpawnAndDestroy("make_shared", graph.get(), names, [](NameId name) {
+			SceneNodePointer node = std::make_shared<BenchmarkNode>(name);
+			node->CreateCollider(0.0f, 1.0f, XMFLOAT3(0, 0, 0), false);
+			return node;
+		});
+
+		graph->OnDetached();
+	}
+
+	void BenchmarkSceneLoad()
+	{
+		const size_t groupCount = 100;
+		const size_t groupSize = 1000;
+
+		std::cout << "sceneload: " << (groupCount * groupSize) << " mesh nodes with colliders in " << groupCount << " graphs, saved and loaded back" << std::endl;
+
+		// the same sort of thing a baked scene holds, just far more of it
+		std::vector<NameId> names = MakeNames(L"benchmark_sceneload_", groupCount * groupSize);
+		NameId model = NameTable::Intern(L"benchmark_sceneload_model");
+
+		SceneGraphPointer scene = std::make_shared<SceneGraph>(L"benchmark_sceneload");
+		scene->Reserve(groupCount);
+
+		for (size_t i = 0; i < groupCount; i++) {
+			SceneGraphPointer group = std::make_shared<SceneGraph>(L"benchmark_sceneload_group_" + std::to_wstring(i));
+			group->Reserve(groupSize);
+
+			for (size_t j = 0; j < groupSize; j++) {
+				SceneNodePointer node = MakePooled<MeshNode>(names[i * groupSize + j], model);
+				node->GetTransform()->SetPosition((float)j, 0.0f, (float)i);
+				node->GetTransform()->Rotate(0.0f, 0.01f * j, 0.0f);
+				node->CreateCollider(10.0f, 1.0f, XMFLOAT3(0, 0, 0), false);
+				group->Add(node);
+			}
+
+			scene->Add(group);
+		}
+
+		wchar_t directory[MAX_PATH];
+		GetTempPathW(MAX_PATH, directory);
+		std::wstring path = std::wstring(directory) + L"benchmark_sceneload.scene";
+
+		if (!SaveScene(path, scene)) {
+			std::wcout << L"  couldn't write " << path << std::endl;
+			scene->OnDetached();
+			return;
+		}
+
+		// load into a graph that's already in the scene, the way the
+		// palms are, so adding the nodes counts too
+		SceneGraphPointer loaded = std::make_shared<SceneGraph>(L"benchmark_sceneload_loaded");
+		loaded->OnAttached();
+
+		size_t nodeCount = 0;
+
+		Clock::time_point start = Clock::now();
+		bool read = LoadScene(path, loaded, &nodeCount);
+		double seconds = SecondsSince(start);
+
+		if (read)	PrintRate("load", nodeCount, seconds);
+		else		std::wcout << L"  couldn't load " << path << std::endl;
+
+		DeleteFileW(path.c_str());
+
+		loaded->OnDetached();
+		scene->OnDetached();
+	}
+}
+
+bool RunSceneBenchmark(const std::wstring& name)
+{
+	bool all = (name == L"all");
+	bool ran = false;
+
+	if (all || name == L"find") {
+		BenchmarkFind();
+		ran = true;
+	}
+
+	if (all || name == L"transforms") {
+		BenchmarkTransforms();
+		ran = true;
+	}
+
+	if (all || name == L"update") {
+		BenchmarkUpdate();
+		ran = true;
+	}
+
+	if (all || name == L"spawn") {
+		BenchmarkSpawn();
+		ran = true;
+	}
+
+	if (all || name == L"sceneload") {
+		BenchmarkSceneLoad();
+		ran = true;
+	}
+
+	if (!ran) std::wcout << L"no benchmark called " << name << std::endl;
+
+	return ran;
+}
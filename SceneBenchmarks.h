@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+
+// Timings for the scene graph on synthetic scenes far bigger than the one
+// we ship, run with -benchmark <name> instead of a replay. Like replays
+// they run headless, after the real scene has been set up, so the job
+// system, transform hierarchy and spatial index are the ones the game
+// uses. Each benchmark builds its own graph off to the side and tears it
+// down again, and prints its results to the console.
+//
+//	find		looking up every node of a 100k node graph by name
+//	transforms	world matrices for 1M nodes, from the flat hierarchy and
+//				from the recursive walk it replaced
+//	update		a graph of 100k moving nodes updated on one thread, and
+//				split up across the job system
+//	spawn		making 100k nodes, adding them to the scene, and taking
+//				them out and freeing them again
+//	sceneload	loading a saved 100k node scene into a graph in the scene
+
+// runs the named benchmark, or all of them for "all". returns false if
+// there's no benchmark by that name.
+bool	RunSceneBenchmark(const std::wstring& name);
@@ -0,0 +1,145 @@
+#include "SceneCommandBuffer.h"
+#include <algorithm>
+
+SceneCommandBuffer::SceneCommandBuffer()
+{
+}
+
+SceneCommandBuffer::~SceneCommandBuffer()
+{
+}
+
+void SceneCommandBuffer::Add(SceneGraphPointer parent, SceneNodePointer node)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	commands_.push_back({ CommandType::Add, node, parent });
+}
+
+void SceneCommandBuffer::Remove(SceneNodePointer node)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	commands_.push_back({ CommandType::Remove, node, nullptr });
+}
+
+void SceneCommandBuffer::Reparent(SceneNodePointer node, SceneGraphPointer parent)
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	commands_.push_back({ CommandType::Reparent, node, parent });
+}
+
+size_t SceneCommandBuffer::GetPendingCount()
+{
+	std::lock_guard<std::mutex> lock(mutex_);
+	return commands_.size();
+}
+
+void SceneCommandBuffer::Apply()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex_);
+		applying_.swap(commands_);
+	}
+
+	size_t i = 0;
+	while (i < applying_.size()) {
+		Command& command = applying_[i];
+
+		switch (command.Type) {
+		case CommandType::Add:
+			command.Parent->Add(command.Node);
+			command.Node->Initialise();
+			command.Node->Start();
+			i++;
+			break;
+
+		case CommandType::Remove: {
+			// gather up the whole run of removals and do them together
+			size_t end = i;
+			while (end < applying_.size() && applying_[end].Type == CommandType::Remove) end++;
+
+			ApplyRemovals(i, end);
+			i = end;
+			break;
+		}
+
+		case CommandType::Reparent: {
+			// a node can't go inside itself, so leave it where it is
+			if (IsInSubtree(command.Parent.get(), command.Node.get())) {
+				i++;
+				break;
+			}
+
+			SceneGraph* oldParent = dynamic_cast<SceneGraph*>(command.Node->GetParent());
+			if (oldParent != nullptr) oldParent->RemoveChildren(&command.Node, 1);
+
+			command.Parent->Add(command.Node);
+			i++;
+			break;
+		}
+		}
+	}
+
+	// let go of our references now, rather than next frame
+	applying_.clear();
+}
+
+bool SceneCommandBuffer::IsInSubtree(SceneNode* node, SceneNode* root)
+{
+	for (SceneNode* ancestor = node; ancestor != nullptr; ancestor = ancestor->GetParent()) {
+		if (ancestor == root) return true;
+	}
+
+	return false;
+}
+
+void SceneCommandBuffer::ApplyRemovals(size_t begin, size_t end)
+{
+	// removing a node takes everything below it too, so drop anything
+	// whose ancestor is also going, or it would be shut down twice.
+	// ancestors that aren't in a graph can't be removed, so don't count.
+	queued_.clear();
+	for (size_t i = begin; i < end; i++) {
+		if (applying_[i].Node->GetParent() != nullptr) queued_.push_back(applying_[i].Node.get());
+	}
+	std::sort(queued_.begin(), queued_.end());
+
+	end = std::remove_if(applying_.begin() + begin, applying_.begin() + end, [this](const Command& command) {
+		for (SceneNode* ancestor = command.Node->GetParent(); ancestor != nullptr; ancestor = ancestor->GetParent()) {
+			if (std::binary_search(queued_.begin(), queued_.end(), ancestor)) return true;
+		}
+		return false;
+	}) - applying_.begin();
+
+	// sort the run by parent, so each parent gets one sweep over its children
+	std::sort(applying_.begin() + begin, applying_.begin() + end, [](const Command& a, const Command& b) {
+		if (a.Node->GetParent() != b.Node->GetParent()) return a.Node->GetParent() < b.Node->GetParent();
+		return a.Node < b.Node;
+	});
+
+	size_t i = begin;
+	while (i < end) {
+		SceneNode* parent = applying_[i].Node->GetParent();
+
+		batch_.clear();
+		while (i < end && applying_[i].Node->GetParent() == parent) {
+			// the same node queued twice sorts next to itself
+			if (batch_.empty() || batch_.back() != applying_[i].Node) batch_.push_back(applying_[i].Node);
+			i++;
+		}
+
+		// nodes that were never added, or were already removed
+		if (parent == nullptr) continue;
+
+		SceneGraph* graph = dynamic_cast<SceneGraph*>(parent);
+		if (graph == nullptr) continue;
+
+		graph->RemoveChildren(batch_.data(), batch_.size());
+
+		for (auto&& node : batch_) {
+			node->Shutdown();
+		}
+	}
+
+	batch_.clear();
+	queued_.clear();
+}
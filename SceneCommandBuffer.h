@@ -0,0 +1,58 @@
+#pragma once
+#include "SceneGraph.h"
+#include <vector>
+#include <mutex>
+
+// Queues structural changes to the scene graph so they can be made at a
+// safe point in the frame, rather than while the graph is being walked.
+// Commands are applied in the order they were queued, and runs of removals
+// are batched so that each parent is only swept once.
+//
+// Nodes added through the buffer are initialised and started when they're
+// applied, and removed nodes are shut down, since the rest of the scene
+// has been through those already. Reparenting does neither, and is
+// ignored if it would move a node into its own subtree.
+//
+// Safe to queue from any thread.
+
+class SceneCommandBuffer
+{
+public:
+	SceneCommandBuffer();
+	~SceneCommandBuffer();
+
+	void						Add(SceneGraphPointer parent, SceneNodePointer node);
+	void						Remove(SceneNodePointer node);
+	void						Reparent(SceneNodePointer node, SceneGraphPointer parent);
+
+	// make every queued change. call from the main thread.
+	void						Apply();
+
+	size_t						GetPendingCount();
+
+private:
+	enum class CommandType {
+		Add,
+		Remove,
+		Reparent
+	};
+
+	struct Command {
+		CommandType				Type;
+		SceneNodePointer		Node;
+		SceneGraphPointer		Parent;
+	};
+
+	void						ApplyRemovals(size_t begin, size_t end);
+
+	// true if node is root or somewhere below it
+	static bool					IsInSubtree(SceneNode* node, SceneNode* root);
+
+	std::mutex					mutex_;
+	std::vector<Command>		commands_;
+
+	// what's being applied. kept around so its capacity is reused.
+	std::vector<Command>		applying_;
+	std::vector<SceneNodePointer>	batch_;
+	std::vector<SceneNode*>		queued_;
+};
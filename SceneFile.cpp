@@ -0,0 +1,285 @@
+#include "SceneFile.h"
+#include "MeshNode.h"
+#include "PlayerNode.h"
+#include <vector>
+#include <unordered_map>
+#include <fstream>
+#include <cstring>
+
+// === file format === //
+// header:	"BSCN", version, node count, string count, character count
+// nodes:	node count x SceneFileNode							(80 bytes each)
+// strings:	string count + 1 offsets into the characters, then the
+//			UTF-16 characters themselves, with no terminators
+
+const char			SCENE_MAGIC[4] =		{ 'B', 'S', 'C', 'N' };
+const unsigned int	SCENE_VERSION =			1;
+
+const unsigned int	NODE_GRAPH =			0;
+const unsigned int	NODE_MESH =				1;
+
+const unsigned int	NODE_HAS_COLLIDER =		1 << 0;
+const unsigned int	NODE_PUSHABLE =			1 << 1;
+
+const unsigned int	NO_STRING =				0xffffffff;
+
+static_assert(sizeof(wchar_t) == 2, "scene files store UTF-16 strings");
+
+struct SceneFileHeader {
+	char				Magic[4];
+	unsigned int		Version;
+	unsigned int		NodeCount;
+	unsigned int		StringCount;
+	unsigned int		CharacterCount;
+};
+
+struct SceneFileNode {
+	unsigned int		Type;
+	int					Parent;			// earlier record, or -1 for the top level
+	unsigned int		Name;
+	unsigned int		Model;
+
+	XMFLOAT3			Position;
+	XMFLOAT4			Rotation;
+	XMFLOAT3			Scale;
+
+	unsigned int		Flags;
+	float				ColliderHeight;
+	float				ColliderRadius;
+	XMFLOAT3			ColliderOffset;
+};
+
+static_assert(sizeof(SceneFileNode) == 80, "scene file records must stay the same size");
+
+// === saving === //
+
+struct SceneWriter {
+	std::vector<SceneFileNode>					Nodes;
+	std::vector<NameId>							Strings;
+	std::unordered_map<NameId, unsigned int>	StringIndices;
+
+	unsigned int AddString(NameId name)
+	{
+		auto found = StringIndices.find(name);
+		if (found != StringIndices.end()) return found->second;
+
+		unsigned int index = (unsigned int)Strings.size();
+		Strings.push_back(name);
+		StringIndices[name] = index;
+		return index;
+	}
+
+	void AddNode(SceneNode* node, int parent)
+	{
+		SceneGraph* graph = dynamic_cast<SceneGraph*>(node);
+		MeshNode* mesh = dynamic_cast<MeshNode*>(node);
+
+		// players are mesh nodes too, but need more than we can give them
+		if (dynamic_cast<PlayerNode*>(node) != nullptr) mesh = nullptr;
+		if (graph == nullptr && mesh == nullptr) return;
+
+		SceneFileNode record;
+		memset(&record, 0, sizeof(record));
+
+		record.Type = (graph != nullptr) ? NODE_GRAPH : NODE_MESH;
+		record.Parent = parent;
+		record.Name = AddString(node->GetNameId());
+		record.Model = (mesh != nullptr) ? AddString(mesh->GetModelName()) : NO_STRING;
+
+		std::shared_ptr<Transform> transform = node->GetTransform();
+		XMStoreFloat3(&record.Position, transform->GetPosition());
+		XMStoreFloat4(&record.Rotation, transform->GetRotation());
+		XMStoreFloat3(&record.Scale, transform->GetScale());
+
+		std::shared_ptr<Collider> collider = node->GetCollider();
+		if (collider != nullptr) {
+			record.Flags |= NODE_HAS_COLLIDER;
+			if (collider->IsPushable()) record.Flags |= NODE_PUSHABLE;
+
+			record.ColliderHeight = collider->GetHeight();
+			record.ColliderRadius = collider->GetRadius();
+			record.ColliderOffset = collider->GetOffset();
+		}
+
+		int index = (int)Nodes.size();
+		Nodes.push_back(record);
+
+		if (graph == nullptr) return;
+
+		for (size_t i = 0; i < graph->GetChildCount(); i++) {
+			AddNode(graph->GetChild(i).get(), index);
+		}
+	}
+};
+
+bool SaveScene(const std::wstring& filename, SceneGraphPointer scene)
+{
+	SceneWriter writer;
+
+	for (size_t i = 0; i < scene->GetChildCount(); i++) {
+		writer.AddNode(scene->GetChild(i).get(), -1);
+	}
+
+	std::vector<unsigned int> offsets;
+	std::wstring characters;
+
+	offsets.reserve(writer.Strings.size() + 1);
+	for (NameId name : writer.Strings) {
+		offsets.push_back((unsigned int)characters.size());
+		characters += NameTable::GetString(name);
+	}
+	offsets.push_back((unsigned int)characters.size());
+
+	SceneFileHeader header;
+	memcpy(header.Magic, SCENE_MAGIC, sizeof(SCENE_MAGIC));
+	header.Version = SCENE_VERSION;
+	header.NodeCount = (unsigned int)writer.Nodes.size();
+	header.StringCount = (unsigned int)writer.Strings.size();
+	header.CharacterCount = (unsigned int)characters.size();
+
+	std::ofstream output;
+	output.open(filename.c_str(), std::ios_base::binary | std::ios_base::trunc);
+	if (!output) return false;
+
+	output.write((const char*)&header, sizeof(header));
+	output.write((const char*)writer.Nodes.data(), writer.Nodes.size() * sizeof(SceneFileNode));
+	output.write((const char*)offsets.data(), offsets.size() * sizeof(unsigned int));
+	output.write((const char*)characters.data(), characters.size() * sizeof(wchar_t));
+
+	return output.good();
+}
+
+// === loading === //
+
+// a read-only view of a whole file, unmapped when it goes out of scope
+class MappedFile
+{
+public:
+	MappedFile(const std::wstring& filename)
+	{
+		file_ = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file_ == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(file_, &size) || size.QuadPart == 0) return;
+
+		mapping_ = CreateFileMappingW(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (mapping_ == nullptr) return;
+
+		data_ = (const char*)MapViewOfFile(mapping_, FILE_MAP_READ, 0, 0, 0);
+		if (data_ != nullptr) size_ = (size_t)size.QuadPart;
+	}
+
+	~MappedFile()
+	{
+		if (data_ != nullptr) UnmapViewOfFile(data_);
+		if (mapping_ != nullptr) CloseHandle(mapping_);
+		if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+	}
+
+	inline const char*	GetData() const { return data_; }
+	inline size_t		GetSize() const { return size_; }
+
+private:
+	HANDLE				file_ = INVALID_HANDLE_VALUE;
+	HANDLE				mapping_ = nullptr;
+	const char*			data_ = nullptr;
+	size_t				size_ = 0;
+};
+
+bool LoadScene(const std::wstring& filename, SceneGraphPointer parent, size_t* nodeCount)
+{
+	MappedFile file(filename);
+	if (file.GetData() == nullptr || file.GetSize() < sizeof(SceneFileHeader)) return false;
+
+	const SceneFileHeader* header = (const SceneFileHeader*)file.GetData();
+	if (memcmp(header->Magic, SCENE_MAGIC, sizeof(SCENE_MAGIC)) != 0 || header->Version != SCENE_VERSION) return false;
+
+	// make sure every section fits before touching any of them
+	unsigned long long expected = sizeof(SceneFileHeader)
+		+ (unsigned long long)header->NodeCount * sizeof(SceneFileNode)
+		+ ((unsigned long long)header->StringCount + 1) * sizeof(unsigned int)
+		+ (unsigned long long)header->CharacterCount * sizeof(wchar_t);
+
+	if (file.GetSize() < expected) return false;
+
+	const SceneFileNode* records = (const SceneFileNode*)(file.GetData() + sizeof(SceneFileHeader));
+	const unsigned int* offsets = (const unsigned int*)(records + header->NodeCount);
+	const wchar_t* characters = (const wchar_t*)(offsets + header->StringCount + 1);
+
+	unsigned int nodes = header->NodeCount;
+	unsigned int strings = header->StringCount;
+
+	// intern every string once, rather than once per node that uses it
+	std::vector<NameId> names(strings);
+
+	for (unsigned int i = 0; i < strings; i++) {
+		if (offsets[i] > offsets[i + 1] || offsets[i + 1] > header->CharacterCount) return false;
+
+		names[i] = NameTable::Intern(std::wstring(characters + offsets[i], characters + offsets[i + 1]));
+	}
+
+	// check the records, and count children so every graph can make room
+	// for all of them in one go
+	std::vector<unsigned int> childCounts(nodes, 0);
+	size_t topLevel = 0;
+
+	for (unsigned int i = 0; i < nodes; i++) {
+		const SceneFileNode& record = records[i];
+
+		if (record.Type != NODE_GRAPH && record.Type != NODE_MESH) return false;
+		if (record.Name >= strings) return false;
+		if (record.Type == NODE_MESH && record.Model >= strings) return false;
+
+		// parents always come first, and have to be graphs
+		if (record.Parent >= (int)i) return false;
+
+		if (record.Parent < 0) {
+			topLevel++;
+		}
+		else {
+			if (records[record.Parent].Type != NODE_GRAPH) return false;
+			childCounts[record.Parent]++;
+		}
+	}
+
+	// then build everything. parents are added before their children, so
+	// every node is attached exactly once.
+	std::vector<SceneGraph*> graphs(nodes, nullptr);
+	parent->Reserve(parent->GetChildCount() + topLevel);
+
+	for (unsigned int i = 0; i < nodes; i++) {
+		const SceneFileNode& record = records[i];
+		SceneNodePointer node;
+
+		if (record.Type == NODE_GRAPH) {
+			std::shared_ptr<SceneGraph> graph = std::make_shared<SceneGraph>(names[record.Name]);
+			graph->Reserve(childCounts[i]);
+			graphs[i] = graph.get();
+			node = graph;
+		}
+		else {
+			node = MakePooled<MeshNode>(names[record.Name], names[record.Model]);
+		}
+
+		std::shared_ptr<Transform> transform = node->GetTransform();
+		transform->SetPosition(record.Position);
+		transform->SetRotation(record.Rotation);
+		transform->SetScale(record.Scale);
+
+		if (record.Flags & NODE_HAS_COLLIDER) {
+			node->CreateCollider(
+				record.ColliderHeight,
+				record.ColliderRadius,
+				record.ColliderOffset,
+				(record.Flags & NODE_PUSHABLE) != 0
+			);
+		}
+
+		if (record.Parent < 0)	parent->Add(node);
+		else					graphs[record.Parent]->Add(node);
+	}
+
+	if (nodeCount != nullptr) *nodeCount = nodes;
+	return true;
+}
@@ -0,0 +1,22 @@
+#pragma once
+#include "SceneGraph.h"
+#include <string>
+
+// Compact binary scene files. A file holds a flat list of fixed-size node
+// records in parent-first order, followed by one table of every string
+// they use, so loading maps the file and builds nodes straight out of it
+// without parsing anything per node.
+//
+// Graphs and mesh nodes are saved along with their transforms and
+// colliders. Anything else (the terrain, the player, the skybox) needs
+// more set up than a file can give it, and is left out along with
+// everything below it.
+
+// writes out everything below scene, but not scene itself
+bool	SaveScene(const std::wstring& filename, SceneGraphPointer scene);
+
+// adds everything in the file below parent. nodes are added, not
+// initialised, so either load before the scene graph is initialised or
+// initialise them afterwards. returns false if the file is missing or
+// malformed, in which case nothing is added.
+bool	LoadScene(const std::wstring& filename, SceneGraphPointer parent, size_t* nodeCount = nullptr);
@@ -1,5 +1,8 @@
 #pragma once
 #include "SceneGraph.h"
+#include "DirectXFramework.h"
+#include "GameConstants.h"
+#include <algorithm>
 
 SceneNodePointer SceneGraph::operator[](const size_t index) const
 {
@@ -26,15 +29,62 @@ void SceneGraph::Start(void)
 	}
 }
 
-void SceneGraph::Update(FXMMATRIX & currentWorldTransformation)
+void SceneGraph::Update(void)
 {
+	SceneNode::Update();
+
+	std::shared_ptr<JobSystem> jobSystem = DirectXFramework::GetDXFramework()->GetJobSystem();
+
+	// small graphs, and graphs we reach from inside a job, aren't worth
+	// splitting up
+	if (!PARALLEL_UPDATE || children_.size() < PARALLEL_UPDATE_MIN_CHILDREN || !jobSystem->IsMainThread()) {
+		for (auto&& child : children_) {
+			child->Update();
+		}
+		return;
+	}
+
+	safeChildren_.clear();
+	unsafeChildren_.clear();
+
 	for (auto&& child : children_) {
-		child->Update(currentWorldTransformation);
+		if (child->IsThreadSafe())	safeChildren_.push_back(child.get());
+		else						unsafeChildren_.push_back(child.get());
+	}
+
+	JobCounter counter;
+	jobSystem->ParallelFor(safeChildren_.size(), PARALLEL_UPDATE_BATCH, UpdateChildren, this, &counter);
+	jobSystem->Wait(&counter);
+
+	// then everything that needs the main thread, once the workers are
+	// done and can't see what these nodes get up to
+	for (auto&& child : unsafeChildren_) {
+		child->Update();
+	}
+}
+
+void SceneGraph::UpdateChildren(void* data, size_t begin, size_t end)
+{
+	SceneGraph* graph = (SceneGraph*)data;
+
+	for (size_t i = begin; i < end; i++) {
+		graph->safeChildren_[i]->Update();
 	}
 }
 
+bool SceneGraph::IsThreadSafe(void)
+{
+	return unsafeNodes_ == 0;
+}
+
 void SceneGraph::Render(void)
 {
+	// one test for the whole subtree
+	if (bounded_ && !DirectXFramework::GetDXFramework()->GetCullingSystem()->IsVisible(worldBounds_)) {
+		DirectXFramework::GetDXFramework()->GetFrameStats().SubtreesCulled++;
+		return;
+	}
+
 	for (auto&& child : children_) {
 		child->Render();
 	}
@@ -47,36 +97,282 @@ void SceneGraph::Shutdown(void)
 	}
 }
 
+void SceneGraph::OnAttached(void)
+{
+	SceneNode::OnAttached();
+
+	for (auto&& child : children_) {
+		child->OnAttached();
+	}
+}
+
+void SceneGraph::OnDetached(void)
+{
+	// children go first, so the hierarchy never has an orphaned entry
+	for (auto&& child : children_) {
+		child->OnDetached();
+	}
+
+	SceneNode::OnDetached();
+}
+
 void SceneGraph::Add(SceneNodePointer node)
 {
 	children_.push_back(node);
+	node->SetParent(this);
+
+	BoundingBox previous = worldBounds_;
+	bool grew = false;
+	if (node->IsBounded())	grew = MergeChildBounds(node.get());
+	else					unboundedChildren_++;
+
+	UpdateBounded(grew, previous);
+
+	// index the new node, and everything under it if it's a graph itself
+	AddToIndex(node->GetNameId(), node);
+	AddUnsafeNodes((int)CountUnsafeNodes(node.get()));
+
+	SceneGraph* graph = dynamic_cast<SceneGraph*>(node.get());
+	if (graph != nullptr) {
+		for (auto&& entry : graph->index_) {
+			AddToIndex(entry.first, entry.second);
+		}
+	}
+
+	node->OnAttached();
 }
 
 void SceneGraph::Remove(SceneNodePointer node)
 {
-	for (int i = 0; i < children_.size(); i++) {
-		children_[i]->Remove(node);
+	// only do anything if the node is somewhere below us
+	SceneNode* ancestor = node->GetParent();
+	while (ancestor != nullptr && ancestor != this) {
+		ancestor = ancestor->GetParent();
+	}
+
+	if (ancestor == nullptr) return;
+
+	// then let its own parent take it out, rather than searching for it
+	SceneGraph* parent = dynamic_cast<SceneGraph*>(node->GetParent());
+	if (parent != nullptr) parent->RemoveChildren(&node, 1);
+}
+
+void SceneGraph::RemoveChildren(const SceneNodePointer* nodes, size_t count)
+{
+	bool removedAny = false;
+
+	for (size_t i = 0; i < count; i++) {
+		if (nodes[i]->GetParent() != this) continue;
+
+		DetachChild(nodes[i]);
+		removedAny = true;
+	}
 
-		if (children_[i] == node) {
-			children_.erase(children_.begin() + i);
-			return;
+	if (!removedAny) return;
+
+	// detached children no longer point at us, so one pass clears them all out
+	children_.erase(
+		std::remove_if(children_.begin(), children_.end(), [this](const SceneNodePointer& child) {
+			return child->GetParent() != this;
+		}),
+		children_.end()
+	);
+
+	UpdateBounded(false, worldBounds_);
+}
+
+void SceneGraph::DetachChild(const SceneNodePointer& node)
+{
+	node->OnDetached();
+
+	SceneGraph* graph = dynamic_cast<SceneGraph*>(node.get());
+	if (graph != nullptr) {
+		for (auto&& entry : graph->index_) {
+			SceneNodePointer indexed = entry.second.lock();
+			RemoveFromIndex(entry.first, indexed.get());
 		}
 	}
+
+	RemoveFromIndex(node->GetNameId(), node.get());
+	AddUnsafeNodes(-(int)CountUnsafeNodes(node.get()));
+
+	// only a child holding one of the sides of our box leaves it too big
+	if (!node->IsBounded()) unboundedChildren_--;
+	else if (LeavesSpace(worldBounds_, node->GetWorldBounds(), nullptr)) MarkBoundsLoose();
+
+	node->SetParent(nullptr);
 }
 
-SceneNodePointer SceneGraph::Find(std::wstring name)
+SceneNodePointer SceneGraph::Find(NameId name)
 {
-	SceneNodePointer foundNode;
+	NameIndex::iterator found = index_.find(name);
+	if (found == index_.end()) return nullptr;
 
-	for (auto&& child : children_) {
-		foundNode = child->Find(name);
+	return found->second.lock();
+}
+
+void SceneGraph::AddToIndex(NameId name, const std::weak_ptr<SceneNode>& node)
+{
+	index_.emplace(name, node);
+
+	SceneGraph* parent = dynamic_cast<SceneGraph*>(parent_);
+	if (parent != nullptr) parent->AddToIndex(name, node);
+}
 
-		if (foundNode != nullptr) {
-			return foundNode;
+size_t SceneGraph::CountUnsafeNodes(SceneNode* node)
+{
+	SceneGraph* graph = dynamic_cast<SceneGraph*>(node);
+	if (graph != nullptr) return graph->unsafeNodes_;
+
+	return node->IsThreadSafe() ? 0 : 1;
+}
+
+void SceneGraph::AddUnsafeNodes(int count)
+{
+	if (count == 0) return;
+
+	unsafeNodes_ += count;
+
+	SceneGraph* parent = dynamic_cast<SceneGraph*>(parent_);
+	if (parent != nullptr) parent->AddUnsafeNodes(count);
+}
+
+void SceneGraph::RemoveFromIndex(NameId name, SceneNode* node)
+{
+	auto range = index_.equal_range(name);
+
+	for (NameIndex::iterator entry = range.first; entry != range.second; ++entry) {
+		if (entry->second.lock().get() == node) {
+			index_.erase(entry);
+			break;
 		}
 	}
 
-	return nullptr;
+	SceneGraph* parent = dynamic_cast<SceneGraph*>(parent_);
+	if (parent != nullptr) parent->RemoveFromIndex(name, node);
+}
+
+void SceneGraph::OnChildBoundsChanged(SceneNode* child, bool wasBounded, const BoundingBox& previous)
+{
+	BoundingBox ours = worldBounds_;
+	bool grew = false;
+
+	if (child->IsBounded()) {
+		if (!wasBounded) unboundedChildren_--;
+
+		// if it was inside our box, our box still covers everything
+		// else, so merging its new box in is all we need
+		else if (LeavesSpace(worldBounds_, previous, &child->GetWorldBounds())) MarkBoundsLoose();
+
+		grew = MergeChildBounds(child);
+	}
+	else if (wasBounded) {
+		unboundedChildren_++;
+		if (LeavesSpace(worldBounds_, previous, nullptr)) MarkBoundsLoose();
+	}
+
+	UpdateBounded(grew, ours);
+}
+
+bool SceneGraph::LeavesSpace(const BoundingBox& bounds, const BoundingBox& previous, const BoundingBox* current)
+{
+	XMVECTOR centre = XMLoadFloat3(&bounds.Center);
+	XMVECTOR extents = XMLoadFloat3(&bounds.Extents);
+
+	// boxes are stored as centres and extents, so a side shared with a
+	// merged box may be off by a rounding error
+	XMVECTOR tolerance = (extents + XMVectorReplicate(1.0f)) * 1e-4f;
+	XMVECTOR minimum = centre - extents + tolerance;
+	XMVECTOR maximum = centre + extents - tolerance;
+
+	XMVECTOR previousCentre = XMLoadFloat3(&previous.Center);
+	XMVECTOR previousExtents = XMLoadFloat3(&previous.Extents);
+	XMVECTOR heldMinimum = XMVectorLessOrEqual(previousCentre - previousExtents, minimum);
+	XMVECTOR heldMaximum = XMVectorGreaterOrEqual(previousCentre + previousExtents, maximum);
+
+	XMVECTOR left;
+	if (current == nullptr) {
+		left = XMVectorOrInt(heldMinimum, heldMaximum);
+	}
+	else {
+		XMVECTOR currentCentre = XMLoadFloat3(&current->Center);
+		XMVECTOR currentExtents = XMLoadFloat3(&current->Extents);
+
+		left = XMVectorOrInt(
+			XMVectorAndInt(heldMinimum, XMVectorGreater(currentCentre - currentExtents, minimum)),
+			XMVectorAndInt(heldMaximum, XMVectorLess(currentCentre + currentExtents, maximum))
+		);
+	}
+
+	return !XMVector3EqualInt(left, XMVectorFalseInt());
+}
+
+bool SceneGraph::MergeChildBounds(SceneNode* child)
+{
+	if (!hasVolume_) {
+		worldBounds_ = child->GetWorldBounds();
+		hasVolume_ = true;
+		return true;
+	}
+
+	if (worldBounds_.Contains(child->GetWorldBounds()) == CONTAINS) return false;
+
+	BoundingBox::CreateMerged(worldBounds_, worldBounds_, child->GetWorldBounds());
+	return true;
+}
+
+void SceneGraph::UpdateBounded(bool changed, const BoundingBox& previous)
+{
+	bool wasBounded = bounded_;
+	bounded_ = hasVolume_ && unboundedChildren_ == 0 && !children_.empty();
+
+	// our parent only needs to hear about it if it can see the change
+	if (parent_ == nullptr) return;
+	if (bounded_ != wasBounded || (bounded_ && changed)) parent_->OnChildBoundsChanged(this, wasBounded, previous);
+}
+
+void SceneGraph::MarkBoundsLoose(void)
+{
+	if (boundsLoose_) return;
+
+	boundsLoose_ = true;
+	DirectXFramework::GetDXFramework()->GetCullingSystem()->AddLooseGraph(
+		std::static_pointer_cast<SceneGraph>(shared_from_this())
+	);
+}
+
+void SceneGraph::RefitBounds(void)
+{
+	boundsLoose_ = false;
+	hasVolume_ = false;
+
+	BoundingBox previous = worldBounds_;
+
+	for (auto&& child : children_) {
+		if (child->IsBounded()) MergeChildBounds(child.get());
+	}
+
+	// if we shrank, our parent's box is now loose in turn
+	bool changed = !hasVolume_
+		|| XMVector3NotEqual(XMLoadFloat3(&previous.Center), XMLoadFloat3(&worldBounds_.Center))
+		|| XMVector3NotEqual(XMLoadFloat3(&previous.Extents), XMLoadFloat3(&worldBounds_.Extents));
+
+	UpdateBounded(changed, previous);
+}
+
+void SceneGraph::QueryBounds(const BoundingBox& bounds, std::vector<SceneNode*>& results)
+{
+	// nothing below us can overlap if we don't
+	if (bounded_ && !worldBounds_.Intersects(bounds)) return;
+
+	for (auto&& child : children_) {
+		child->QueryBounds(bounds, results);
+	}
+}
+
+void SceneGraph::Reserve(size_t count)
+{
+	children_.reserve(count);
 }
 
 size_t SceneGraph::GetChildCount() const
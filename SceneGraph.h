@@ -1,5 +1,6 @@
 #pragma once
 #include <vector>
+#include <unordered_map>
 #include "SceneNode.h"
 
 class SceneGraph;
@@ -11,23 +12,92 @@ class SceneGraph : public SceneNode
 public:
 	SceneGraph() : SceneNode(L"Root") {};
 	SceneGraph(std::wstring name) : SceneNode(name) {};
+	SceneGraph(NameId name) : SceneNode(name) {};
 	~SceneGraph(void) {};
 
 	SceneNodePointer	operator[](const size_t index) const;
 
 	virtual bool		Initialise(void);
 	virtual void		Start(void);
-	virtual void		Update(FXMMATRIX& currentWorldTransformation);
+	virtual void		Update(void);
 	virtual void		Render(void);
 	virtual void		Shutdown(void);
 
+	// true if nothing below us needs the main thread
+	virtual bool		IsThreadSafe(void);
+
+	virtual void		OnAttached(void);
+	virtual void		OnDetached(void);
+
+	// our bounds are the merge of our children's. they grow straight
+	// away when a child moves outside them. they only shrink when
+	// RefitBounds is called, which the culling system does every so
+	// often, and only need to when a child that was holding one of
+	// their sides out moves away from it or goes.
+	virtual void		OnChildBoundsChanged(SceneNode* child, bool wasBounded, const BoundingBox& previous);
+	virtual void		QueryBounds(const BoundingBox& bounds, std::vector<SceneNode*>& results);
+	void				RefitBounds(void);
+
 	void				Add(SceneNodePointer node);
 	void				Remove(SceneNodePointer node);
-	SceneNodePointer	Find(std::wstring name);
+
+	// removes any of these that are our direct children in a single pass
+	void				RemoveChildren(const SceneNodePointer* nodes, size_t count);
+	// constant time. if several nodes share a name, which one comes back
+	// is unspecified.
+	virtual SceneNodePointer	Find(NameId name);
+	using				SceneNode::Find;
+
+	// make room for this many children up front
+	void				Reserve(size_t count);
 
 	size_t				GetChildCount()			const;
 	SceneNodePointer	GetChild(size_t index)	const;
 
 private:
+	typedef std::unordered_multimap<NameId, std::weak_ptr<SceneNode>> NameIndex;
+
+	void				AddToIndex(NameId name, const std::weak_ptr<SceneNode>& node);
+	void				RemoveFromIndex(NameId name, SceneNode* node);
+
+	void				DetachChild(const SceneNodePointer& node);
+
+	static size_t		CountUnsafeNodes(SceneNode* node);
+	void				AddUnsafeNodes(int count);
+
+	static void			UpdateChildren(void* data, size_t begin, size_t end);
+
+	// merges a bounded child into our box. returns true if it grew.
+	bool				MergeChildBounds(SceneNode* child);
+	// works out whether we're bounded, and tells our parent if that or
+	// our box changed. previous is our box before the change.
+	void				UpdateBounded(bool changed, const BoundingBox& previous);
+	void				MarkBoundsLoose(void);
+
+	// whether a child's box going from previous to current, or going
+	// altogether if current is null, could leave bounds bigger than they
+	// need to be. true if it was holding out one of their sides and now
+	// doesn't reach it.
+	static bool			LeavesSpace(const BoundingBox& bounds, const BoundingBox& previous, const BoundingBox* current);
+
 	std::vector<SceneNodePointer> children_;
+
+	// every node below this one, by name. kept up to date by Add and
+	// Remove, and pushed up through each parent graph as well.
+	NameIndex			index_;
+
+	// how many nodes below us aren't thread safe. kept up to date the
+	// same way as the index.
+	size_t				unsafeNodes_ = 0;
+
+	// children without bounds. we're only bounded while this is zero.
+	size_t				unboundedChildren_ = 0;
+	// whether worldBounds_ holds anything yet
+	bool				hasVolume_ = false;
+	// whether worldBounds_ might be bigger than it needs to be
+	bool				boundsLoose_ = false;
+
+	// scratch lists for the parallel update, kept to avoid reallocating
+	std::vector<SceneNode*>	safeChildren_;
+	std::vector<SceneNode*>	unsafeChildren_;
 };
@@ -1,15 +1,126 @@
 #include "SceneNode.h"
+#include "DirectXFramework.h"
 
 void SceneNode::CreateCollider(float height, float radius, XMFLOAT3 offset, bool pushable)
 {
-	collider_ = std::make_shared<Collider>(height, radius, offset, pushable);
+	// if we're already in the scene, swap the old collider out of the index
+	if (parent_ != nullptr) UnregisterCollider();
+
+	collider_ = MakePooled<Collider>(height, radius, offset, pushable);
+
+	if (parent_ != nullptr) RegisterCollider();
+
+	std::shared_ptr<EntityStore> store = DirectXFramework::GetDXFramework()->GetEntityStore();
+	if (store->IsAlive(entity_)) store->Add(entity_, DescribeCollider(*collider_));
+}
+
+void SceneNode::OnAttached()
+{
+	std::shared_ptr<TransformHierarchy> hierarchy = DirectXFramework::GetDXFramework()->GetTransformHierarchy();
+
+	// we may have been attached to a graph before it was itself attached,
+	// in which case our entry hangs off the wrong parent
+	if (transformHandle_ != INVALID_TRANSFORM) hierarchy->Destroy(transformHandle_);
+
+	TransformHandle parentHandle = (parent_ != nullptr) ? parent_->transformHandle_ : INVALID_TRANSFORM;
+	transformHandle_ = hierarchy->Create(parentHandle);
+
+	// hand our matrix over straight away, in case we've arrived after
+	// this frame's scene graph update
+	hierarchy->SetLocal(transformHandle_, transform_->GetWorldTransform());
+	transformVersion_ = transform_->GetVersion();
+	worldDirty_ = false;
+
+	RegisterCollider();
+
+	// the entity lives as long as we're in the scene, however many times
+	// we're attached on the way
+	std::shared_ptr<EntityStore> store = DirectXFramework::GetDXFramework()->GetEntityStore();
+	if (!store->IsAlive(entity_)) entity_ = AdoptSceneNode(*store, this);
+}
+
+void SceneNode::OnDetached()
+{
+	UnregisterCollider();
+
+	DirectXFramework::GetDXFramework()->GetEntityStore()->Destroy(entity_);
+	entity_ = INVALID_ENTITY;
+
+	if (transformHandle_ != INVALID_TRANSFORM) {
+		DirectXFramework::GetDXFramework()->GetTransformHierarchy()->Destroy(transformHandle_);
+		transformHandle_ = INVALID_TRANSFORM;
+	}
+}
+
+void SceneNode::RegisterCollider()
+{
+	if (collider_ == nullptr || collider_->GetProxy() != -1) return;
+
+	XMFLOAT3 worldPosition;
+	XMStoreFloat3(&worldPosition, transform_->GetPosition());
+	collider_->SetWorldPosition(worldPosition);
+
+	std::shared_ptr<SpatialIndex> index = DirectXFramework::GetDXFramework()->GetCollisionSystem()->GetSpatialIndex();
+	collider_->SetProxy(index->Insert(this, collider_.get()));
+}
+
+void SceneNode::UnregisterCollider()
+{
+	if (collider_ == nullptr || collider_->GetProxy() == -1) return;
+
+	std::shared_ptr<SpatialIndex> index = DirectXFramework::GetDXFramework()->GetCollisionSystem()->GetSpatialIndex();
+	index->Remove(collider_->GetProxy());
+	collider_->SetProxy(-1);
 }
 
-void SceneNode::Update(FXMMATRIX& currentWorldTransformation) {
-	XMStoreFloat4x4(&combinedWorldTransformation_, transform_->GetWorldTransform() * currentWorldTransformation);
+void SceneNode::Update() {
+	// only hand our matrix over if it has actually changed. the
+	// hierarchy works out which world matrices that affects.
+	if (transformHandle_ == INVALID_TRANSFORM) return;
+	if (transformVersion_ == transform_->GetVersion() && !worldDirty_) return;
+
+	transformVersion_ = transform_->GetVersion();
+	worldDirty_ = false;
+
+	DirectXFramework::GetDXFramework()->GetTransformHierarchy()->SetLocal(transformHandle_, transform_->GetWorldTransform());
+
 	if (collider_ != nullptr) {
+		// the spatial index picks this up in its refit pass, so
+		// all we touch here is our own collider
 		XMFLOAT3 worldPosition;
 		XMStoreFloat3(&worldPosition, transform_->GetPosition());
 		collider_->SetWorldPosition(worldPosition);
 	}
 };
+
+void SceneNode::SetWorldBounds(const BoundingBox& bounds)
+{
+	bool wasBounded = bounded_;
+	BoundingBox previous = worldBounds_;
+
+	worldBounds_ = bounds;
+	bounded_ = true;
+
+	if (parent_ != nullptr) parent_->OnChildBoundsChanged(this, wasBounded, previous);
+}
+
+void SceneNode::ClearWorldBounds()
+{
+	if (!bounded_) return;
+
+	bounded_ = false;
+
+	if (parent_ != nullptr) parent_->OnChildBoundsChanged(this, true, worldBounds_);
+}
+
+void SceneNode::QueryBounds(const BoundingBox& bounds, std::vector<SceneNode*>& results)
+{
+	if (bounded_ && worldBounds_.Intersects(bounds)) results.push_back(this);
+}
+
+XMMATRIX SceneNode::GetCombinedWorldTransformation()
+{
+	if (transformHandle_ == INVALID_TRANSFORM) return transform_->GetWorldTransform();
+
+	return DirectXFramework::GetDXFramework()->GetTransformHierarchy()->GetWorld(transformHandle_);
+}
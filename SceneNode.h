@@ -1,8 +1,13 @@
 #pragma once
-#include "core.h"
+#include "Core.h"
 #include "DirectXCore.h"
 #include "Transform.h"
 #include "Collider.h"
+#include "NameTable.h"
+#include "TransformHierarchy.h"
+#include "MemoryPool.h"
+#include "EntityStore.h"
+#include <vector>
 
 // Abstract base class for all nodes of the scene graph.  
 // This scene graph implements the Composite Design Pattern
@@ -14,9 +19,10 @@ typedef std::shared_ptr<SceneNode>	SceneNodePointer;
 class SceneNode : public std::enable_shared_from_this<SceneNode>
 {
 public:
-	SceneNode(std::wstring name) {
-		name_ = name; 
-		transform_ = std::make_shared<Transform>();
+	SceneNode(std::wstring name) : SceneNode(NameTable::Intern(name)) {};
+	SceneNode(NameId name) {
+		nameId_ = name;
+		transform_ = MakePooled<Transform>();
 
 		// by default, nodes don't have colliders
 		collider_ = nullptr;
@@ -28,25 +34,81 @@ public:
 	// core methods
 	virtual bool Initialise() = 0;
 	virtual void Start() = 0;
-	virtual void Update(FXMMATRIX& currentWorldTransformation);
+	virtual void Update();
+
+	// whether Update only touches this node's own state, so it can run
+	// on a worker alongside other nodes. nodes that reach out to shared
+	// state (the camera, the terrain, other nodes) should return false,
+	// and will be updated on the main thread instead.
+	virtual bool IsThreadSafe() { return true; }
 
 	virtual void CreateCollider(float height, float radius, XMFLOAT3 offset, bool pushable);
 
 	virtual void Render() = 0;
 	virtual void Shutdown() = 0;
 
+	// called by the owning graph when we're added to or removed from it
+	virtual void OnAttached();
+	virtual void OnDetached();
+
 	std::shared_ptr<Transform>	GetTransform()	{ return transform_; }
 	std::shared_ptr<Collider>	GetCollider()	{ return collider_; }
+
+	// our transform combined with all of our parents'. resolved by the
+	// transform hierarchy after the scene graph update.
+	XMMATRIX					GetCombinedWorldTransformation();
+
+	// a world-space box around everything this node draws. nodes without
+	// bounds could draw anywhere, so nothing above them can be culled.
+	inline bool					IsBounded()			{ return bounded_; }
+	inline const BoundingBox&	GetWorldBounds()	{ return worldBounds_; }
+	void						SetWorldBounds(const BoundingBox& bounds);
+	void						ClearWorldBounds();
+
+	// every bounded node overlapping the box
+	virtual void				QueryBounds(const BoundingBox& bounds, std::vector<SceneNode*>& results);
+
+	// called on the parent whenever a child's bounds change. previous is
+	// the box the child had before, if it was bounded.
+	virtual void				OnChildBoundsChanged(SceneNode* child, bool wasBounded, const BoundingBox& previous) {};
 		
 	virtual void Add(SceneNodePointer node) {};
 	virtual void Remove(SceneNodePointer node) {};
-	virtual	SceneNodePointer Find(std::wstring name) { return (name_ == name) ? shared_from_this() : nullptr; };
-	virtual std::wstring GetName() { return name_; }
+	virtual	SceneNodePointer Find(NameId name) { return (nameId_ == name) ? shared_from_this() : nullptr; };
+	SceneNodePointer Find(const std::wstring& name) {
+		// names nobody has interned can't belong to any node
+		NameId id = NameTable::Find(name);
+		return (id != NAME_NONE || name.empty()) ? Find(id) : nullptr;
+	}
+
+	inline const std::wstring&	GetName()	{ return NameTable::GetString(nameId_); }
+	inline NameId				GetNameId()	{ return nameId_; }
+
+	// our entity in the entity store, while we're attached
+	inline Entity				GetEntity()	{ return entity_; }
+
+	inline SceneNode*			GetParent()	{ return parent_; }
+	inline void					SetParent(SceneNode* parent) { parent_ = parent; }
 
 protected:
 	XMFLOAT4X4					worldTransformation_;
-	XMFLOAT4X4					combinedWorldTransformation_;
 	std::shared_ptr<Transform>	transform_;
 	std::shared_ptr<Collider>	collider_;
-	std::wstring				name_;
+	NameId						nameId_;
+	SceneNode*					parent_ = nullptr;
+
+	// our entry in the transform hierarchy, and the transform version
+	// it was last given. the first update always hands it over.
+	TransformHandle				transformHandle_ = INVALID_TRANSFORM;
+	unsigned int				transformVersion_ = 0;
+	bool						worldDirty_ = true;
+
+	BoundingBox					worldBounds_;
+	bool						bounded_ = false;
+
+	Entity						entity_ = INVALID_ENTITY;
+
+private:
+	void						RegisterCollider();
+	void						UnregisterCollider();
 };
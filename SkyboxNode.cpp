@@ -41,13 +41,6 @@ void SkyboxNode::Start(void)
 {
 }
 
-void SkyboxNode::Update(FXMMATRIX& currentWorldTransformation) {
-	XMStoreFloat4x4(
-		&combinedWorldTransformation_,
-		XMMatrixTranslationFromVector(DirectXFramework::GetDXFramework()->GetCamera()->GetCameraPosition())
-	);
-}
-
 void SkyboxNode::Render(void)
 {
 	XMFLOAT3 translation;
@@ -66,30 +59,29 @@ void SkyboxNode::Render(void)
 	cBuffer.CompleteTransformation	= XMMatrixTranspose(completeTransformation);
 
 	// set our buffer and shader resources
-	deviceContext_->PSSetShader(pixelShader_.Get(), 0, 0);
-	deviceContext_->VSSetShader(vertexShader_.Get(), 0, 0);
+	std::shared_ptr<RenderContext> context = DirectXFramework::GetDXFramework()->GetRenderContext();
 
-	deviceContext_->IASetInputLayout(layout_.Get());
+	context->SetPixelShader(pixelShader_.Get());
+	context->SetVertexShader(vertexShader_.Get());
 
-	deviceContext_->UpdateSubresource(constantBuffer_.Get(), 0, 0, &cBuffer, 0, 0);
-	deviceContext_->VSSetConstantBuffers(0, 1, constantBuffer_.GetAddressOf());
-	deviceContext_->PSSetConstantBuffers(0, 1, constantBuffer_.GetAddressOf());
+	context->SetInputLayout(layout_.Get());
 
-	deviceContext_->PSSetShaderResources(0, 1, texture_.GetAddressOf());
+	context->UpdateBuffer(constantBuffer_.Get(), &cBuffer, sizeof(cBuffer));
+	context->SetVSConstantBuffer(0, constantBuffer_.Get());
+	context->SetPSConstantBuffer(0, constantBuffer_.Get());
 
-	UINT stride = sizeof(VERTEX);
-	UINT offset = 0;
+	context->SetPSResource(0, texture_.Get());
 
-	deviceContext_->IASetVertexBuffers(0, 1, vertexBuffer_.GetAddressOf(), &stride, &offset);
-	deviceContext_->IASetIndexBuffer(indexBuffer_.Get(), DXGI_FORMAT_R32_UINT, 0);
-	deviceContext_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	context->SetVertexBuffer(vertexBuffer_.Get(), sizeof(VERTEX));
+	context->SetIndexBuffer(indexBuffer_.Get());
+	context->SetPrimitiveTopology(PrimitiveTopology::TriangleList);
 
-	deviceContext_->RSSetState(noCullRasteriserState_.Get());
-	deviceContext_->OMSetDepthStencilState(stencilState_.Get(), 1);
-	deviceContext_->DrawIndexed(indexCount_, 0, 0);
+	context->SetRasteriserState(noCullRasteriserState_.Get());
+	context->SetDepthStencilState(stencilState_.Get());
+	context->DrawIndexed(indexCount_, 0, 0);
 
-	deviceContext_->OMSetDepthStencilState(nullptr, 1);
-	deviceContext_->RSSetState(defaultRasteriserState_.Get());
+	context->SetDepthStencilState(nullptr);
+	context->SetRasteriserState(defaultRasteriserState_.Get());
 }
 
 void SkyboxNode::Shutdown(void)
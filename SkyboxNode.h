@@ -11,7 +11,6 @@ public:
 
 	bool Initialise(void);
 	void Start(void);
-	void Update(FXMMATRIX& currentWorldTransformation);
 	void Render(void);
 	void Shutdown(void);
 
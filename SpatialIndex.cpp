@@ -0,0 +1,720 @@
+#include "SpatialIndex.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+
+// how far leaves are inflated past their collider. colliders can move this
+// far before the tree has to be touched.
+const float	SPATIAL_MARGIN =		2.0f;
+
+// queries start on a fixed stack. the tree is kept balanced, so this is
+// far deeper than it should ever need to be.
+const int	SPATIAL_STACK_SIZE =	256;
+
+// the traversal stack for one query. it lives on the caller's stack, and
+// only moves anything to the heap if the tree gets deeper than that.
+class QueryStack
+{
+public:
+	inline bool		IsEmpty() const { return size_ == 0; }
+
+	inline void		Push(int index)
+	{
+		if (size_ < SPATIAL_STACK_SIZE)	fixed_[size_] = index;
+		else							overflow_.push_back(index);
+		size_++;
+	}
+
+	inline int		Pop()
+	{
+		size_--;
+		if (size_ < SPATIAL_STACK_SIZE) return fixed_[size_];
+
+		int index = overflow_.back();
+		overflow_.pop_back();
+		return index;
+	}
+
+private:
+	int					fixed_[SPATIAL_STACK_SIZE];
+	std::vector<int>	overflow_;
+	int					size_ = 0;
+};
+
+// === box helpers === //
+
+static inline XMFLOAT3 Minimum(XMFLOAT3 a, XMFLOAT3 b)
+{
+	return XMFLOAT3(std::min<float>(a.x, b.x), std::min<float>(a.y, b.y), std::min<float>(a.z, b.z));
+}
+
+static inline XMFLOAT3 Maximum(XMFLOAT3 a, XMFLOAT3 b)
+{
+	return XMFLOAT3(std::max<float>(a.x, b.x), std::max<float>(a.y, b.y), std::max<float>(a.z, b.z));
+}
+
+static inline float SurfaceArea(XMFLOAT3 minimum, XMFLOAT3 maximum)
+{
+	float w = maximum.x - minimum.x;
+	float h = maximum.y - minimum.y;
+	float d = maximum.z - minimum.z;
+	return 2.0f * (w * h + h * d + d * w);
+}
+
+static inline bool BoxesOverlap(XMFLOAT3 minA, XMFLOAT3 maxA, XMFLOAT3 minB, XMFLOAT3 maxB)
+{
+	return minA.x <= maxB.x && maxA.x >= minB.x
+		&& minA.y <= maxB.y && maxA.y >= minB.y
+		&& minA.z <= maxB.z && maxA.z >= minB.z;
+}
+
+static inline bool BoxContains(XMFLOAT3 outerMin, XMFLOAT3 outerMax, XMFLOAT3 innerMin, XMFLOAT3 innerMax)
+{
+	return outerMin.x <= innerMin.x && outerMin.y <= innerMin.y && outerMin.z <= innerMin.z
+		&& outerMax.x >= innerMax.x && outerMax.y >= innerMax.y && outerMax.z >= innerMax.z;
+}
+
+static inline float DistanceToBox(XMFLOAT3 point, XMFLOAT3 minimum, XMFLOAT3 maximum)
+{
+	float dx = std::max<float>(std::max<float>(minimum.x - point.x, 0.0f), point.x - maximum.x);
+	float dy = std::max<float>(std::max<float>(minimum.y - point.y, 0.0f), point.y - maximum.y);
+	float dz = std::max<float>(std::max<float>(minimum.z - point.z, 0.0f), point.z - maximum.z);
+	return sqrtf(dx * dx + dy * dy + dz * dz);
+}
+
+// slab test. returns the entry distance, or false if the ray misses
+static inline bool RayHitsBox(XMFLOAT3 origin, XMFLOAT3 inverseDirection, float maxDistance, XMFLOAT3 minimum, XMFLOAT3 maximum, float& entry)
+{
+	float t1 = (minimum.x - origin.x) * inverseDirection.x;
+	float t2 = (maximum.x - origin.x) * inverseDirection.x;
+	float tMin = std::min<float>(t1, t2);
+	float tMax = std::max<float>(t1, t2);
+
+	t1 = (minimum.y - origin.y) * inverseDirection.y;
+	t2 = (maximum.y - origin.y) * inverseDirection.y;
+	tMin = std::max<float>(tMin, std::min<float>(t1, t2));
+	tMax = std::min<float>(tMax, std::max<float>(t1, t2));
+
+	t1 = (minimum.z - origin.z) * inverseDirection.z;
+	t2 = (maximum.z - origin.z) * inverseDirection.z;
+	tMin = std::max<float>(tMin, std::min<float>(t1, t2));
+	tMax = std::min<float>(tMax, std::max<float>(t1, t2));
+
+	entry = std::max<float>(tMin, 0.0f);
+	return tMax >= entry && entry <= maxDistance;
+}
+
+// === collider helpers === //
+// colliders are vertical capsules, so most of these reduce to a
+// horizontal distance plus a clamped vertical one.
+
+static inline float DistanceToCollider(const Collider* collider, XMFLOAT3 point)
+{
+	XMFLOAT3 bottom = collider->GetBottomPoint();
+	XMFLOAT3 top = collider->GetTopPoint();
+
+	float dx = point.x - bottom.x;
+	float dy = point.y - std::min<float>(std::max<float>(point.y, bottom.y), top.y);
+	float dz = point.z - bottom.z;
+
+	return std::max<float>(sqrtf(dx * dx + dy * dy + dz * dz) - collider->GetRadius(), 0.0f);
+}
+
+static inline bool ColliderOverlapsBox(const Collider* collider, XMFLOAT3 minimum, XMFLOAT3 maximum)
+{
+	XMFLOAT3 bottom = collider->GetBottomPoint();
+	XMFLOAT3 top = collider->GetTopPoint();
+	float radius = collider->GetRadius();
+
+	float dx = std::max<float>(std::max<float>(minimum.x - bottom.x, 0.0f), bottom.x - maximum.x);
+	float dz = std::max<float>(std::max<float>(minimum.z - bottom.z, 0.0f), bottom.z - maximum.z);
+	float dy = std::max<float>(std::max<float>(minimum.y - top.y, 0.0f), bottom.y - maximum.y);
+
+	return (dx * dx + dy * dy + dz * dz) <= radius * radius;
+}
+
+static inline bool RayHitsSphere(XMFLOAT3 origin, XMFLOAT3 direction, XMFLOAT3 centre, float radius, float& distance)
+{
+	float ox = origin.x - centre.x;
+	float oy = origin.y - centre.y;
+	float oz = origin.z - centre.z;
+
+	float b = ox * direction.x + oy * direction.y + oz * direction.z;
+	float c = ox * ox + oy * oy + oz * oz - radius * radius;
+
+	// starting inside counts as an immediate hit
+	if (c <= 0.0f) {
+		distance = 0.0f;
+		return true;
+	}
+
+	float discriminant = b * b - c;
+	if (b > 0.0f || discriminant < 0.0f) return false;
+
+	distance = -b - sqrtf(discriminant);
+	return true;
+}
+
+// direction must be normalised
+static inline bool RayHitsCollider(const Collider* collider, XMFLOAT3 origin, XMFLOAT3 direction, float& distance)
+{
+	XMFLOAT3 bottom = collider->GetBottomPoint();
+	XMFLOAT3 top = collider->GetTopPoint();
+	float radius = collider->GetRadius();
+
+	bool hit = false;
+	float best = FLT_MAX;
+	float t;
+
+	// the cylindrical body
+	float a = direction.x * direction.x + direction.z * direction.z;
+	if (a > 1e-8f) {
+		float ox = origin.x - bottom.x;
+		float oz = origin.z - bottom.z;
+		float b = ox * direction.x + oz * direction.z;
+		float c = ox * ox + oz * oz - radius * radius;
+		float discriminant = b * b - a * c;
+
+		if (discriminant >= 0.0f) {
+			t = (c <= 0.0f) ? 0.0f : (-b - sqrtf(discriminant)) / a;
+			float y = origin.y + direction.y * t;
+
+			if (t >= 0.0f && y >= bottom.y && y <= top.y) {
+				best = t;
+				hit = true;
+			}
+		}
+	}
+
+	// and the two caps
+	if (RayHitsSphere(origin, direction, bottom, radius, t) && t < best) {
+		best = t;
+		hit = true;
+	}
+
+	if (RayHitsSphere(origin, direction, top, radius, t) && t < best) {
+		best = t;
+		hit = true;
+	}
+
+	distance = best;
+	return hit;
+}
+
+static inline void GetColliderBounds(const Collider* collider, XMFLOAT3& minimum, XMFLOAT3& maximum)
+{
+	float radius = collider->GetRadius();
+	XMFLOAT3 bottom = collider->GetBottomPoint();
+	XMFLOAT3 top = collider->GetTopPoint();
+
+	minimum = XMFLOAT3(bottom.x - radius, bottom.y - radius, bottom.z - radius);
+	maximum = XMFLOAT3(top.x + radius, top.y + radius, top.z + radius);
+}
+
+// === tree management === //
+
+SpatialIndex::SpatialIndex() :
+	root_(-1),
+	freeList_(-1),
+	proxyCount_(0)
+{
+}
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+int SpatialIndex::AllocateNode()
+{
+	int index;
+
+	if (freeList_ == -1) {
+		index = (int)nodes_.size();
+		nodes_.push_back(TreeNode());
+	}
+	else {
+		index = freeList_;
+		freeList_ = nodes_[index].Parent;
+	}
+
+	TreeNode& node = nodes_[index];
+	node.Parent = -1;
+	node.Left = -1;
+	node.Right = -1;
+	node.Height = 0;
+	node.Node = nullptr;
+	node.Shape = nullptr;
+
+	return index;
+}
+
+void SpatialIndex::FreeNode(int index)
+{
+	// free nodes are chained through their parent index
+	nodes_[index].Parent = freeList_;
+	nodes_[index].Height = -1;
+	freeList_ = index;
+}
+
+int SpatialIndex::Insert(SceneNode* node, Collider* collider)
+{
+	int proxy = AllocateNode();
+
+	XMFLOAT3 minimum;
+	XMFLOAT3 maximum;
+	GetColliderBounds(collider, minimum, maximum);
+
+	TreeNode& leaf = nodes_[proxy];
+	leaf.Minimum = XMFLOAT3(minimum.x - SPATIAL_MARGIN, minimum.y - SPATIAL_MARGIN, minimum.z - SPATIAL_MARGIN);
+	leaf.Maximum = XMFLOAT3(maximum.x + SPATIAL_MARGIN, maximum.y + SPATIAL_MARGIN, maximum.z + SPATIAL_MARGIN);
+	leaf.Node = node;
+	leaf.Shape = collider;
+
+	InsertLeaf(proxy);
+	collider->ClearMoved();
+	proxyCount_++;
+
+	return proxy;
+}
+
+void SpatialIndex::Remove(int proxy)
+{
+	if (proxy < 0 || proxy >= (int)nodes_.size() || nodes_[proxy].Height != 0) return;
+
+	RemoveLeaf(proxy);
+	FreeNode(proxy);
+	proxyCount_--;
+}
+
+void SpatialIndex::Refit()
+{
+	XMFLOAT3 minimum;
+	XMFLOAT3 maximum;
+
+	for (int i = 0; i < (int)nodes_.size(); i++) {
+		TreeNode& leaf = nodes_[i];
+		if (leaf.Height != 0 || !leaf.Shape->HasMoved()) continue;
+
+		leaf.Shape->ClearMoved();
+		GetColliderBounds(leaf.Shape, minimum, maximum);
+
+		// still inside our fat box, nothing to do
+		if (BoxContains(leaf.Minimum, leaf.Maximum, minimum, maximum)) continue;
+
+		RemoveLeaf(i);
+
+		nodes_[i].Minimum = XMFLOAT3(minimum.x - SPATIAL_MARGIN, minimum.y - SPATIAL_MARGIN, minimum.z - SPATIAL_MARGIN);
+		nodes_[i].Maximum = XMFLOAT3(maximum.x + SPATIAL_MARGIN, maximum.y + SPATIAL_MARGIN, maximum.z + SPATIAL_MARGIN);
+
+		InsertLeaf(i);
+	}
+}
+
+void SpatialIndex::InsertLeaf(int leaf)
+{
+	if (root_ == -1) {
+		root_ = leaf;
+		nodes_[root_].Parent = -1;
+		return;
+	}
+
+	XMFLOAT3 leafMin = nodes_[leaf].Minimum;
+	XMFLOAT3 leafMax = nodes_[leaf].Maximum;
+
+	// walk down the tree picking the cheapest sibling by surface area
+	int index = root_;
+	while (!nodes_[index].IsLeaf()) {
+		const TreeNode& current = nodes_[index];
+		int left = current.Left;
+		int right = current.Right;
+
+		float area = SurfaceArea(current.Minimum, current.Maximum);
+		float combinedArea = SurfaceArea(Minimum(current.Minimum, leafMin), Maximum(current.Maximum, leafMax));
+
+		// cost of making a new parent for this node and the leaf
+		float cost = 2.0f * combinedArea;
+
+		// minimum cost of pushing the leaf further down the tree
+		float inheritanceCost = 2.0f * (combinedArea - area);
+
+		float costLeft = SurfaceArea(Minimum(nodes_[left].Minimum, leafMin), Maximum(nodes_[left].Maximum, leafMax)) + inheritanceCost;
+		if (!nodes_[left].IsLeaf())
+			costLeft -= SurfaceArea(nodes_[left].Minimum, nodes_[left].Maximum);
+
+		float costRight = SurfaceArea(Minimum(nodes_[right].Minimum, leafMin), Maximum(nodes_[right].Maximum, leafMax)) + inheritanceCost;
+		if (!nodes_[right].IsLeaf())
+			costRight -= SurfaceArea(nodes_[right].Minimum, nodes_[right].Maximum);
+
+		if (cost < costLeft && cost < costRight) break;
+
+		index = (costLeft < costRight) ? left : right;
+	}
+
+	int sibling = index;
+
+	// create a new parent to hold the sibling and the leaf
+	int oldParent = nodes_[sibling].Parent;
+	int newParent = AllocateNode();
+
+	nodes_[newParent].Parent = oldParent;
+	nodes_[newParent].Minimum = Minimum(leafMin, nodes_[sibling].Minimum);
+	nodes_[newParent].Maximum = Maximum(leafMax, nodes_[sibling].Maximum);
+	nodes_[newParent].Height = nodes_[sibling].Height + 1;
+	nodes_[newParent].Left = sibling;
+	nodes_[newParent].Right = leaf;
+
+	if (oldParent != -1) {
+		if (nodes_[oldParent].Left == sibling)
+			nodes_[oldParent].Left = newParent;
+		else
+			nodes_[oldParent].Right = newParent;
+	}
+	else {
+		root_ = newParent;
+	}
+
+	nodes_[sibling].Parent = newParent;
+	nodes_[leaf].Parent = newParent;
+
+	FitParents(newParent);
+}
+
+void SpatialIndex::RemoveLeaf(int leaf)
+{
+	if (leaf == root_) {
+		root_ = -1;
+		return;
+	}
+
+	int parent = nodes_[leaf].Parent;
+	int grandParent = nodes_[parent].Parent;
+	int sibling = (nodes_[parent].Left == leaf) ? nodes_[parent].Right : nodes_[parent].Left;
+
+	if (grandParent != -1) {
+		// connect our sibling to our grandparent and drop the parent
+		if (nodes_[grandParent].Left == parent)
+			nodes_[grandParent].Left = sibling;
+		else
+			nodes_[grandParent].Right = sibling;
+
+		nodes_[sibling].Parent = grandParent;
+		FreeNode(parent);
+
+		FitParents(grandParent);
+	}
+	else {
+		root_ = sibling;
+		nodes_[sibling].Parent = -1;
+		FreeNode(parent);
+	}
+
+	nodes_[leaf].Parent = -1;
+}
+
+void SpatialIndex::FitParents(int index)
+{
+	while (index != -1) {
+		index = Balance(index);
+
+		TreeNode& node = nodes_[index];
+		const TreeNode& left = nodes_[node.Left];
+		const TreeNode& right = nodes_[node.Right];
+
+		node.Height = 1 + std::max<int>(left.Height, right.Height);
+		node.Minimum = Minimum(left.Minimum, right.Minimum);
+		node.Maximum = Maximum(left.Maximum, right.Maximum);
+
+		index = node.Parent;
+	}
+}
+
+// rotate a branch up if the tree is lopsided at this node.
+// returns the index of the node that now sits where a did.
+int SpatialIndex::Balance(int a)
+{
+	TreeNode& nodeA = nodes_[a];
+	if (nodeA.IsLeaf() || nodeA.Height < 2) return a;
+
+	int b = nodeA.Left;
+	int c = nodeA.Right;
+	TreeNode& nodeB = nodes_[b];
+	TreeNode& nodeC = nodes_[c];
+
+	int balance = nodeC.Height - nodeB.Height;
+
+	// rotate c up
+	if (balance > 1) {
+		int f = nodeC.Left;
+		int g = nodeC.Right;
+		TreeNode& nodeF = nodes_[f];
+		TreeNode& nodeG = nodes_[g];
+
+		nodeC.Left = a;
+		nodeC.Parent = nodeA.Parent;
+		nodeA.Parent = c;
+
+		if (nodeC.Parent != -1) {
+			if (nodes_[nodeC.Parent].Left == a)
+				nodes_[nodeC.Parent].Left = c;
+			else
+				nodes_[nodeC.Parent].Right = c;
+		}
+		else {
+			root_ = c;
+		}
+
+		if (nodeF.Height > nodeG.Height) {
+			nodeC.Right = f;
+			nodeA.Right = g;
+			nodeG.Parent = a;
+		}
+		else {
+			nodeC.Right = g;
+			nodeA.Right = f;
+			nodeF.Parent = a;
+		}
+
+		const TreeNode& newRight = nodes_[nodeA.Right];
+		nodeA.Minimum = Minimum(nodeB.Minimum, newRight.Minimum);
+		nodeA.Maximum = Maximum(nodeB.Maximum, newRight.Maximum);
+		nodeA.Height = 1 + std::max<int>(nodeB.Height, newRight.Height);
+
+		const TreeNode& otherRight = nodes_[nodeC.Right];
+		nodeC.Minimum = Minimum(nodeA.Minimum, otherRight.Minimum);
+		nodeC.Maximum = Maximum(nodeA.Maximum, otherRight.Maximum);
+		nodeC.Height = 1 + std::max<int>(nodeA.Height, otherRight.Height);
+
+		return c;
+	}
+
+	// rotate b up
+	if (balance < -1) {
+		int d = nodeB.Left;
+		int e = nodeB.Right;
+		TreeNode& nodeD = nodes_[d];
+		TreeNode& nodeE = nodes_[e];
+
+		nodeB.Left = a;
+		nodeB.Parent = nodeA.Parent;
+		nodeA.Parent = b;
+
+		if (nodeB.Parent != -1) {
+			if (nodes_[nodeB.Parent].Left == a)
+				nodes_[nodeB.Parent].Left = b;
+			else
+				nodes_[nodeB.Parent].Right = b;
+		}
+		else {
+			root_ = b;
+		}
+
+		if (nodeD.Height > nodeE.Height) {
+			nodeB.Right = d;
+			nodeA.Left = e;
+			nodeE.Parent = a;
+		}
+		else {
+			nodeB.Right = e;
+			nodeA.Left = d;
+			nodeD.Parent = a;
+		}
+
+		const TreeNode& newLeft = nodes_[nodeA.Left];
+		nodeA.Minimum = Minimum(newLeft.Minimum, nodeC.Minimum);
+		nodeA.Maximum = Maximum(newLeft.Maximum, nodeC.Maximum);
+		nodeA.Height = 1 + std::max<int>(newLeft.Height, nodeC.Height);
+
+		const TreeNode& otherRight = nodes_[nodeB.Right];
+		nodeB.Minimum = Minimum(nodeA.Minimum, otherRight.Minimum);
+		nodeB.Maximum = Maximum(nodeA.Maximum, otherRight.Maximum);
+		nodeB.Height = 1 + std::max<int>(nodeA.Height, otherRight.Height);
+
+		return b;
+	}
+
+	return a;
+}
+
+// === queries === //
+
+size_t SpatialIndex::OverlapSphere(XMFLOAT3 centre, float radius, SceneNode** results, size_t maxResults) const
+{
+	if (root_ == -1 || maxResults == 0) return 0;
+
+	XMFLOAT3 queryMin(centre.x - radius, centre.y - radius, centre.z - radius);
+	XMFLOAT3 queryMax(centre.x + radius, centre.y + radius, centre.z + radius);
+
+	QueryStack stack;
+	size_t found = 0;
+
+	stack.Push(root_);
+
+	while (!stack.IsEmpty()) {
+		const TreeNode& node = nodes_[stack.Pop()];
+		if (!BoxesOverlap(node.Minimum, node.Maximum, queryMin, queryMax)) continue;
+
+		if (node.IsLeaf()) {
+			if (DistanceToCollider(node.Shape, centre) <= radius) {
+				results[found++] = node.Node;
+				if (found == maxResults) break;
+			}
+		}
+		else {
+			stack.Push(node.Left);
+			stack.Push(node.Right);
+		}
+	}
+
+	return found;
+}
+
+size_t SpatialIndex::OverlapBox(XMFLOAT3 minimum, XMFLOAT3 maximum, SceneNode** results, size_t maxResults) const
+{
+	if (root_ == -1 || maxResults == 0) return 0;
+
+	QueryStack stack;
+	size_t found = 0;
+
+	stack.Push(root_);
+
+	while (!stack.IsEmpty()) {
+		const TreeNode& node = nodes_[stack.Pop()];
+		if (!BoxesOverlap(node.Minimum, node.Maximum, minimum, maximum)) continue;
+
+		if (node.IsLeaf()) {
+			if (ColliderOverlapsBox(node.Shape, minimum, maximum)) {
+				results[found++] = node.Node;
+				if (found == maxResults) break;
+			}
+		}
+		else {
+			stack.Push(node.Left);
+			stack.Push(node.Right);
+		}
+	}
+
+	return found;
+}
+
+bool SpatialIndex::Raycast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, SpatialHit& hit) const
+{
+	if (root_ == -1) return false;
+
+	float length = sqrtf(direction.x * direction.x + direction.y * direction.y + direction.z * direction.z);
+	if (length <= 0.0f) return false;
+
+	direction = XMFLOAT3(direction.x / length, direction.y / length, direction.z / length);
+
+	// divide by zero is fine here, the slab test handles infinities
+	XMFLOAT3 inverseDirection(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+
+	QueryStack stack;
+
+	float closest = maxDistance;
+	bool anyHit = false;
+	float entry;
+
+	stack.Push(root_);
+
+	while (!stack.IsEmpty()) {
+		const TreeNode& node = nodes_[stack.Pop()];
+		if (!RayHitsBox(origin, inverseDirection, closest, node.Minimum, node.Maximum, entry)) continue;
+
+		if (node.IsLeaf()) {
+			float distance;
+			if (RayHitsCollider(node.Shape, origin, direction, distance) && distance <= closest) {
+				closest = distance;
+				hit.Node = node.Node;
+				hit.Distance = distance;
+				anyHit = true;
+			}
+		}
+		else {
+			stack.Push(node.Left);
+			stack.Push(node.Right);
+		}
+	}
+
+	return anyHit;
+}
+
+size_t SpatialIndex::Nearest(XMFLOAT3 point, SpatialHit* results, size_t count) const
+{
+	if (root_ == -1 || count == 0) return 0;
+
+	QueryStack stack;
+	size_t found = 0;
+
+	stack.Push(root_);
+
+	while (!stack.IsEmpty()) {
+		const TreeNode& node = nodes_[stack.Pop()];
+
+		// once the buffer is full, skip anything further than our worst result
+		float worst = (found == count) ? results[count - 1].Distance : FLT_MAX;
+		if (DistanceToBox(point, node.Minimum, node.Maximum) >= worst) continue;
+
+		if (node.IsLeaf()) {
+			float distance = DistanceToCollider(node.Shape, point);
+			if (distance >= worst) continue;
+
+			// insertion sort into the (small) result buffer
+			size_t slot = (found < count) ? found++ : count - 1;
+			while (slot > 0 && results[slot - 1].Distance > distance) {
+				results[slot] = results[slot - 1];
+				slot--;
+			}
+
+			results[slot].Node = node.Node;
+			results[slot].Distance = distance;
+		}
+		else {
+			// push the far child first so the near one is visited first
+			float leftDistance = DistanceToBox(point, nodes_[node.Left].Minimum, nodes_[node.Left].Maximum);
+			float rightDistance = DistanceToBox(point, nodes_[node.Right].Minimum, nodes_[node.Right].Maximum);
+
+			if (leftDistance < rightDistance) {
+				stack.Push(node.Right);
+				stack.Push(node.Left);
+			}
+			else {
+				stack.Push(node.Left);
+				stack.Push(node.Right);
+			}
+		}
+	}
+
+	return found;
+}
+
+void SpatialIndex::FindPairs(std::vector<SpatialPair>& pairs) const
+{
+	pairs.clear();
+	if (root_ == -1) return;
+
+	QueryStack stack;
+
+	for (int leaf = 0; leaf < (int)nodes_.size(); leaf++) {
+		const TreeNode& query = nodes_[leaf];
+
+		// free nodes have a height of -1
+		if (query.Height != 0 || !query.IsLeaf()) continue;
+
+		stack.Push(root_);
+
+		while (!stack.IsEmpty()) {
+			int index = stack.Pop();
+			const TreeNode& node = nodes_[index];
+			if (!BoxesOverlap(node.Minimum, node.Maximum, query.Minimum, query.Maximum)) continue;
+
+			if (node.IsLeaf()) {
+				// each pair is found from both ends, so keep just one
+				if (index > leaf) pairs.push_back({ query.Node, query.Shape, node.Node, node.Shape });
+			}
+			else {
+				stack.Push(node.Left);
+				stack.Push(node.Right);
+			}
+		}
+	}
+}
@@ -0,0 +1,87 @@
+#pragma once
+#include <DirectXMath.h>
+#include "Collider.h"
+#include <vector>
+
+using namespace DirectX;
+
+class SceneNode;
+
+struct SpatialHit {
+	SceneNode*	Node;
+	float		Distance;
+};
+
+// two colliders whose fat bounds overlap, so might be touching
+struct SpatialPair {
+	SceneNode*	First;
+	Collider*	FirstShape;
+	SceneNode*	Second;
+	Collider*	SecondShape;
+};
+
+// Dynamic AABB tree over every collider in the scene. Leaves hold a "fat"
+// box around the collider so that small movements don't touch the tree.
+//
+// Queries don't allocate: results go into caller-provided buffers and the
+// traversal stack lives on the caller's stack, only spilling onto the heap
+// if the tree is ever far deeper than balancing allows. They only read the
+// tree, so any number of threads may query at once as long as nothing is
+// inserting, removing or refitting - i.e. between simulation steps.
+
+class SpatialIndex
+{
+public:
+	SpatialIndex();
+	~SpatialIndex();
+
+	int					Insert(SceneNode* node, Collider* collider);
+	void				Remove(int proxy);
+
+	// move any leaves whose colliders have left their fat bounds
+	void				Refit();
+
+	inline size_t		GetProxyCount() const { return proxyCount_; }
+
+	// === queries === //
+	// overlap queries return the number of nodes written to results
+	size_t				OverlapSphere(XMFLOAT3 centre, float radius, SceneNode** results, size_t maxResults) const;
+	size_t				OverlapBox(XMFLOAT3 minimum, XMFLOAT3 maximum, SceneNode** results, size_t maxResults) const;
+
+	// closest hit along the ray, direction does not need to be normalised
+	bool				Raycast(XMFLOAT3 origin, XMFLOAT3 direction, float maxDistance, SpatialHit& hit) const;
+
+	// fills results with up to count nodes, closest first
+	size_t				Nearest(XMFLOAT3 point, SpatialHit* results, size_t count) const;
+
+	// replaces pairs with every pair of colliders whose fat bounds
+	// overlap, each once. the order only depends on the order colliders
+	// were inserted and removed in, so it's the same from run to run.
+	void				FindPairs(std::vector<SpatialPair>& pairs) const;
+
+private:
+	struct TreeNode {
+		XMFLOAT3		Minimum;
+		XMFLOAT3		Maximum;
+		int				Parent;
+		int				Left;
+		int				Right;
+		int				Height;
+		SceneNode*		Node;
+		Collider*		Shape;
+
+		inline bool		IsLeaf() const { return Left == -1; }
+	};
+
+	int					AllocateNode();
+	void				FreeNode(int index);
+	void				InsertLeaf(int leaf);
+	void				RemoveLeaf(int leaf);
+	int					Balance(int index);
+	void				FitParents(int index);
+
+	std::vector<TreeNode>	nodes_;
+	int						root_;
+	int						freeList_;
+	size_t					proxyCount_;
+};
@@ -0,0 +1,180 @@
+#include "StateCache.h"
+
+// marks a slot bound to a whole buffer rather than a range of one
+const unsigned int WHOLE_BUFFER = 0xffffffff;
+
+StateCache::StateCache(std::shared_ptr<RenderContext> context) :
+	context_(context),
+	issued_(0),
+	skipped_(0),
+	uploadedBytes_(0)
+{
+	Invalidate();
+}
+
+StateCache::~StateCache()
+{
+}
+
+void StateCache::Invalidate()
+{
+	Binding unknown = { nullptr, 0, false };
+
+	vertexShader_ = unknown;
+	pixelShader_ = unknown;
+	inputLayout_ = unknown;
+	blendState_ = unknown;
+	rasteriserState_ = unknown;
+	depthStencilState_ = unknown;
+	topology_ = unknown;
+	vertexBuffer_ = unknown;
+	indexBuffer_ = unknown;
+
+	for (unsigned int i = 0; i < STATE_CACHE_SLOTS; i++) {
+		vsConstantBuffers_[i] = unknown;
+		psConstantBuffers_[i] = unknown;
+		psResources_[i] = unknown;
+	}
+}
+
+void StateCache::ResetCounters()
+{
+	issued_ = 0;
+	skipped_ = 0;
+	uploadedBytes_ = 0;
+}
+
+bool StateCache::Change(Binding& binding, const void* object, unsigned int value)
+{
+	if (binding.Known && binding.Object == object && binding.Value == value) {
+		skipped_++;
+		return false;
+	}
+
+	binding.Object = object;
+	binding.Value = value;
+	binding.Known = true;
+
+	issued_++;
+	return true;
+}
+
+bool StateCache::ChangeSlot(Binding* bindings, unsigned int slot, const void* object, unsigned int value)
+{
+	if (slot >= STATE_CACHE_SLOTS) {
+		issued_++;
+		return true;
+	}
+
+	return Change(bindings[slot], object, value);
+}
+
+void StateCache::SetVertexShader(ID3D11VertexShader* shader)
+{
+	if (Change(vertexShader_, shader, 0)) context_->SetVertexShader(shader);
+}
+
+void StateCache::SetPixelShader(ID3D11PixelShader* shader)
+{
+	if (Change(pixelShader_, shader, 0)) context_->SetPixelShader(shader);
+}
+
+void StateCache::SetInputLayout(ID3D11InputLayout* layout)
+{
+	if (Change(inputLayout_, layout, 0)) context_->SetInputLayout(layout);
+}
+
+void StateCache::SetBlendState(ID3D11BlendState* state)
+{
+	if (Change(blendState_, state, 0)) context_->SetBlendState(state);
+}
+
+void StateCache::SetRasteriserState(ID3D11RasterizerState* state)
+{
+	if (Change(rasteriserState_, state, 0)) context_->SetRasteriserState(state);
+}
+
+void StateCache::SetDepthStencilState(ID3D11DepthStencilState* state)
+{
+	if (Change(depthStencilState_, state, 0)) context_->SetDepthStencilState(state);
+}
+
+void StateCache::SetPrimitiveTopology(PrimitiveTopology topology)
+{
+	if (Change(topology_, nullptr, (unsigned int)topology)) context_->SetPrimitiveTopology(topology);
+}
+
+void StateCache::SetVertexBuffer(ID3D11Buffer* buffer, unsigned int stride)
+{
+	if (Change(vertexBuffer_, buffer, stride)) context_->SetVertexBuffer(buffer, stride);
+}
+
+void StateCache::SetIndexBuffer(ID3D11Buffer* buffer)
+{
+	if (Change(indexBuffer_, buffer, 0)) context_->SetIndexBuffer(buffer);
+}
+
+void StateCache::SetVSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer)
+{
+	if (ChangeSlot(vsConstantBuffers_, slot, buffer, WHOLE_BUFFER)) context_->SetVSConstantBuffer(slot, buffer);
+}
+
+void StateCache::SetPSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer)
+{
+	if (ChangeSlot(psConstantBuffers_, slot, buffer, WHOLE_BUFFER)) context_->SetPSConstantBuffer(slot, buffer);
+}
+
+void StateCache::SetPSResource(unsigned int slot, ID3D11ShaderResourceView* view)
+{
+	if (ChangeSlot(psResources_, slot, view, 0)) context_->SetPSResource(slot, view);
+}
+
+void StateCache::SetVSConstantRange(unsigned int slot, const ConstantRange& range)
+{
+	// ranges always start on a multiple of 16 constants, so the first
+	// constant alone tells them apart
+	if (ChangeSlot(vsConstantBuffers_, slot, range.Buffer, range.FirstConstant)) context_->SetVSConstantRange(slot, range);
+}
+
+void StateCache::UpdateBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size)
+{
+	uploadedBytes_ += size;
+	context_->UpdateBuffer(buffer, data, size);
+}
+
+ConstantRange StateCache::UploadConstants(const void* data, unsigned int size)
+{
+	uploadedBytes_ += size;
+	return context_->UploadConstants(data, size);
+}
+
+void StateCache::SetInstanceData(const void* data, unsigned int stride, unsigned int count)
+{
+	uploadedBytes_ += (unsigned long long)stride * count;
+	context_->SetInstanceData(data, stride, count);
+}
+
+void StateCache::DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex)
+{
+	context_->DrawIndexed(indexCount, startIndex, baseVertex);
+}
+
+void StateCache::DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance)
+{
+	context_->DrawIndexedInstanced(indexCount, instanceCount, startIndex, baseVertex, startInstance);
+}
+
+void StateCache::BeginFrame()
+{
+	context_->BeginFrame();
+}
+
+void StateCache::EndFrame()
+{
+	context_->EndFrame();
+}
+
+UploadStats StateCache::GetUploadStats() const
+{
+	return context_->GetUploadStats();
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include "RenderContext.h"
+#include <memory>
+
+// Sits in front of another render context and drops any call that would
+// bind what's already bound. Uploads and draws always go through.
+//
+// It only knows about calls made through it, so anything that touches
+// the device context directly has to be followed by an Invalidate. Until
+// a binding has been made through the cache it's treated as unknown, and
+// the first call for it always goes through.
+
+// constant buffer and shader resource slots past this are never filtered
+const unsigned int STATE_CACHE_SLOTS = 8;
+
+class StateCache : public RenderContext
+{
+public:
+	StateCache(std::shared_ptr<RenderContext> context);
+	~StateCache();
+
+	void				SetVertexShader(ID3D11VertexShader* shader);
+	void				SetPixelShader(ID3D11PixelShader* shader);
+	void				SetInputLayout(ID3D11InputLayout* layout);
+
+	void				SetBlendState(ID3D11BlendState* state);
+	void				SetRasteriserState(ID3D11RasterizerState* state);
+	void				SetDepthStencilState(ID3D11DepthStencilState* state);
+
+	void				SetPrimitiveTopology(PrimitiveTopology topology);
+	void				SetVertexBuffer(ID3D11Buffer* buffer, unsigned int stride);
+	void				SetIndexBuffer(ID3D11Buffer* buffer);
+
+	void				SetVSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer);
+	void				SetPSConstantBuffer(unsigned int slot, ID3D11Buffer* buffer);
+	void				SetPSResource(unsigned int slot, ID3D11ShaderResourceView* view);
+	void				SetVSConstantRange(unsigned int slot, const ConstantRange& range);
+
+	void				UpdateBuffer(ID3D11Buffer* buffer, const void* data, unsigned int size);
+	ConstantRange		UploadConstants(const void* data, unsigned int size);
+
+	void				SetInstanceData(const void* data, unsigned int stride, unsigned int count);
+
+	void				DrawIndexed(unsigned int indexCount, unsigned int startIndex, int baseVertex);
+	void				DrawIndexedInstanced(unsigned int indexCount, unsigned int instanceCount, unsigned int startIndex, int baseVertex, unsigned int startInstance);
+
+	void				BeginFrame();
+	void				EndFrame();
+	UploadStats			GetUploadStats() const;
+
+	// forget everything, so the next call for each binding goes through
+	void				Invalidate();
+
+	// state calls passed on and dropped, and bytes uploaded, since the
+	// last ResetCounters
+	inline unsigned int	GetIssued() const { return issued_; }
+	inline unsigned int	GetSkipped() const { return skipped_; }
+	inline unsigned long long	GetUploadedBytes() const { return uploadedBytes_; }
+	void				ResetCounters();
+
+private:
+	// one binding, and whether we actually know what it is
+	struct Binding {
+		const void*		Object;
+		unsigned int	Value;
+		bool			Known;
+	};
+
+	// true, and remembers the binding, if it's a change
+	bool				Change(Binding& binding, const void* object, unsigned int value);
+	bool				ChangeSlot(Binding* bindings, unsigned int slot, const void* object, unsigned int value);
+
+	std::shared_ptr<RenderContext>	context_;
+
+	Binding				vertexShader_;
+	Binding				pixelShader_;
+	Binding				inputLayout_;
+	Binding				blendState_;
+	Binding				rasteriserState_;
+	Binding				depthStencilState_;
+	Binding				topology_;
+	Binding				vertexBuffer_;
+	Binding				indexBuffer_;
+	Binding				vsConstantBuffers_[STATE_CACHE_SLOTS];
+	Binding				psConstantBuffers_[STATE_CACHE_SLOTS];
+	Binding				psResources_[STATE_CACHE_SLOTS];
+
+	unsigned int		issued_;
+	unsigned int		skipped_;
+	unsigned long long	uploadedBytes_;
+};
@@ -3,6 +3,7 @@
 #include "DirectXFramework.h"
 #include "DDSTextureLoader.h"
 #include <algorithm>
+#include <cfloat>
 
 
 struct CBUFFER {
@@ -40,6 +41,7 @@ bool TerrainNode::Initialise()
 
 	BuildTerrainData();
 	CalculateTerrainNormals();
+	BuildOccluders();
 
 	BuildGeometryBuffers();
 	BuildVertexLayout();
@@ -83,31 +85,30 @@ void TerrainNode::Render()
 	cBuffer.Padding					= XMFLOAT2(0.0f, 0.0f);
 
 	// set our buffer and shader resources
-	deviceContext_->PSSetShader(pixelShader_.Get(), 0, 0);
-	deviceContext_->VSSetShader(vertexShader_.Get(), 0, 0);
-	deviceContext_->IASetInputLayout(layout_.Get());
+	std::shared_ptr<RenderContext> context = DirectXFramework::GetDXFramework()->GetRenderContext();
 
-	deviceContext_->UpdateSubresource(constantBuffer_.Get(), 0, 0, &cBuffer, 0, 0);
+	context->SetPixelShader(pixelShader_.Get());
+	context->SetVertexShader(vertexShader_.Get());
+	context->SetInputLayout(layout_.Get());
 
-	deviceContext_->VSSetConstantBuffers(0, 1, constantBuffer_.GetAddressOf());
-	deviceContext_->PSSetConstantBuffers(0, 1, constantBuffer_.GetAddressOf());
+	context->UpdateBuffer(constantBuffer_.Get(), &cBuffer, sizeof(cBuffer));
 
-	deviceContext_->PSSetShaderResources(0, 1, blendMapResourceView_.GetAddressOf());
-	deviceContext_->PSSetShaderResources(1, 1, texturesResourceView_.GetAddressOf());
+	context->SetVSConstantBuffer(0, constantBuffer_.Get());
+	context->SetPSConstantBuffer(0, constantBuffer_.Get());
 
-	// render our boi!
-	UINT stride = sizeof(TERRAIN_VERTEX);
-	UINT offset = 0;
+	context->SetPSResource(0, blendMapResourceView_.Get());
+	context->SetPSResource(1, texturesResourceView_.Get());
 
-	deviceContext_->IASetVertexBuffers(0, 1, vertexBuffer_.GetAddressOf(), &stride, &offset);
-	deviceContext_->IASetIndexBuffer(indexBuffer_.Get(), DXGI_FORMAT_R32_UINT, 0);
-	deviceContext_->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+	// render our boi!
+	context->SetVertexBuffer(vertexBuffer_.Get(), sizeof(TERRAIN_VERTEX));
+	context->SetIndexBuffer(indexBuffer_.Get());
+	context->SetPrimitiveTopology(PrimitiveTopology::TriangleList);
 
-	deviceContext_->RSSetState(defaultRasteriserState_.Get());
-	deviceContext_->DrawIndexed(INDEX_TARGET, 0, 0);
+	context->SetRasteriserState(defaultRasteriserState_.Get());
+	context->DrawIndexed(INDEX_TARGET, 0, 0);
 }
 
-void TerrainNode::Update(FXMMATRIX& currentWorldTransformation)
+void TerrainNode::Update()
 {
 }
 
@@ -397,6 +398,96 @@ void TerrainNode::BuildTerrainData(void)
 	UpdateStatbar(100);
 }
 
+void TerrainNode::BuildOccluders(void)
+{
+	std::cout << "building occluders...\t\t";
+
+	int cells = GRID_SIZE - 1;
+	int quads = (cells + OCCLUDER_STEP - 1) / OCCLUDER_STEP;
+	int half = GRID_SIZE / 2;
+
+	// the lowest point under each coarse quad
+	std::vector<float> quadMin(quads * quads, FLT_MAX);
+
+	for (int qx = 0; qx < quads; qx++) {
+		for (int qz = 0; qz < quads; qz++) {
+			float& lowest = quadMin[qx * quads + qz];
+
+			for (int x = qx * OCCLUDER_STEP; x <= std::min<int>((qx + 1) * OCCLUDER_STEP, cells); x++) {
+				for (int z = qz * OCCLUDER_STEP; z <= std::min<int>((qz + 1) * OCCLUDER_STEP, cells); z++) {
+					lowest = std::min<float>(lowest, heightmap_[(x * GRID_SIZE) + z]);
+				}
+			}
+		}
+	}
+
+	// each coarse point takes the lowest of the quads around it, so the
+	// proxy never pokes out above the real terrain and can't hide
+	// anything that should show
+	int points = quads + 1;
+	std::vector<XMFLOAT3> grid(points * points);
+
+	for (int px = 0; px < points; px++) {
+		for (int pz = 0; pz < points; pz++) {
+			float lowest = FLT_MAX;
+
+			for (int qx = std::max<int>(px - 1, 0); qx <= std::min<int>(px, quads - 1); qx++) {
+				for (int qz = std::max<int>(pz - 1, 0); qz <= std::min<int>(pz, quads - 1); qz++) {
+					lowest = std::min<float>(lowest, quadMin[qx * quads + qz]);
+				}
+			}
+
+			int x = std::min<int>(px * OCCLUDER_STEP, cells);
+			int z = std::min<int>(pz * OCCLUDER_STEP, cells);
+
+			XMStoreFloat3(&grid[px * points + pz], XMVector3Transform(
+				XMVectorSet((x - half) * GRID_STEP, lowest * GRID_MAGNITUDE, (z - half) * GRID_STEP, 1.0f),
+				XMLoadFloat4x4(&worldTransformation_)
+			));
+		}
+	}
+
+	// then cut it into chunks, so the ones out of view can be skipped
+	std::shared_ptr<OcclusionBuffer> occlusion = DirectXFramework::GetDXFramework()->GetOcclusionBuffer();
+
+	std::vector<XMFLOAT3> vertices;
+	std::vector<unsigned int> indices;
+
+	for (int cx = 0; cx < quads; cx += OCCLUDER_CHUNK) {
+		for (int cz = 0; cz < quads; cz += OCCLUDER_CHUNK) {
+			int width = std::min<int>(OCCLUDER_CHUNK, quads - cx);
+			int depth = std::min<int>(OCCLUDER_CHUNK, quads - cz);
+
+			vertices.clear();
+			indices.clear();
+
+			for (int x = 0; x <= width; x++) {
+				for (int z = 0; z <= depth; z++) {
+					vertices.push_back(grid[(cx + x) * points + (cz + z)]);
+				}
+			}
+
+			for (int x = 0; x < width; x++) {
+				for (int z = 0; z < depth; z++) {
+					unsigned int corner = x * (depth + 1) + z;
+
+					// same split as the real terrain
+					indices.push_back(corner);
+					indices.push_back(corner + 1);
+					indices.push_back(corner + depth + 1);
+					indices.push_back(corner + depth + 1);
+					indices.push_back(corner + 1);
+					indices.push_back(corner + depth + 2);
+				}
+			}
+
+			occlusion->AddOccluder(vertices, indices);
+		}
+	}
+
+	std::cout << "done." << std::endl;
+}
+
 void TerrainNode::CalculateTerrainNormals(void)
 {
 	std::cout << "calculating normals:\t\t";
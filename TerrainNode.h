@@ -22,7 +22,7 @@ public:
 	bool Initialise(void);
 	void Start(void);
 	void Render(void);
-	void Update(DirectX::FXMMATRIX& currentWorldTransformation);
+	void Update();
 	void Shutdown(void);
 	void SetWorldTransform(DirectX::FXMMATRIX& worldTransformation) { XMStoreFloat4x4(&worldTransformation_, worldTransformation); }
 	float GetHeightAtPoint(float x, float z);
@@ -38,6 +38,7 @@ private:
 	void BuildShaders(void);
 	void BuildConstantBuffer(void);
 	void BuildRendererStates(void);
+	void BuildOccluders(void);
 
 	std::vector<float>									heightmap_;
 	std::array<TERRAIN_VERTEX, VERTEX_TARGET>			vertices_;
@@ -21,6 +21,7 @@ void Transform::Translate(XMFLOAT3 offset)
 		&position_,
 		XMLoadFloat3(&offset) + XMLoadFloat3(&position_)
 	);
+	MarkDirty();
 }
 
 void Transform::Translate(float x, float y, float z)
@@ -39,6 +40,7 @@ void Transform::Rotate(XMFLOAT3 rotation)
 			)
 		)
 	);
+	MarkDirty();
 }
 
 void Transform::Rotate(float roll, float pitch, float yaw)
@@ -52,6 +54,7 @@ void Transform::Scale(XMFLOAT3 scale)
 		&scale_,
 		XMLoadFloat3(&scale) * XMLoadFloat3(&scale_)
 	);
+	MarkDirty();
 }
 
 void Transform::Scale(float x, float y, float z)
@@ -67,6 +70,7 @@ void Transform::Scale(float scale)
 void Transform::SetPosition(XMFLOAT3 position)
 {
 	XMStoreFloat3(&position_, XMLoadFloat3(&position));
+	MarkDirty();
 }
 
 void Transform::SetPosition(float x, float y, float z)
@@ -82,6 +86,7 @@ void Transform::SetRotation(XMFLOAT3 rotation)
 			XMLoadFloat3(&rotation)
 		)
 	);
+	MarkDirty();
 }
 
 void Transform::SetRotation(float roll, float pitch, float yaw)
@@ -89,9 +94,16 @@ void Transform::SetRotation(float roll, float pitch, float yaw)
 	SetRotation(XMFLOAT3(roll, pitch, yaw));
 }
 
+void Transform::SetRotation(XMFLOAT4 quaternion)
+{
+	rotation_ = quaternion;
+	MarkDirty();
+}
+
 void Transform::SetScale(XMFLOAT3 scale)
 {
 	XMStoreFloat3(&scale_, XMLoadFloat3(&scale));
+	MarkDirty();
 }
 
 void Transform::SetScale(float x, float y, float z)
@@ -121,7 +133,21 @@ XMVECTOR Transform::GetScale()
 
 XMMATRIX Transform::GetWorldTransform(void)
 {
-	return XMMatrixScalingFromVector(XMLoadFloat3(&scale_))
-		* XMMatrixRotationQuaternion(XMLoadFloat4(&rotation_))
-		* XMMatrixTranslationFromVector(XMLoadFloat3(&position_));
+	if (dirty_) {
+		XMStoreFloat4x4(
+			&localMatrix_,
+			XMMatrixScalingFromVector(XMLoadFloat3(&scale_))
+				* XMMatrixRotationQuaternion(XMLoadFloat4(&rotation_))
+				* XMMatrixTranslationFromVector(XMLoadFloat3(&position_))
+		);
+		dirty_ = false;
+	}
+
+	return XMLoadFloat4x4(&localMatrix_);
+}
+
+void Transform::MarkDirty()
+{
+	dirty_ = true;
+	version_++;
 }
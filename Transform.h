@@ -24,6 +24,7 @@ public:
 
 	void SetRotation(XMFLOAT3 rotation);
 	void SetRotation(float roll, float pitch, float yaw);
+	void SetRotation(XMFLOAT4 quaternion);
 
 	void SetScale(XMFLOAT3 scale);
 	void SetScale(float x, float y, float z);
@@ -34,10 +35,22 @@ public:
 	XMVECTOR GetRotation();
 	XMVECTOR GetScale();
 
+	// cached, and only rebuilt after the transform has been changed
 	XMMATRIX GetWorldTransform(void);
+
+	// bumped on every change, so owners can tell whether anything
+	// moved since they last looked
+	inline unsigned int GetVersion() const { return version_; }
+
 private:
+	void MarkDirty();
+
 	XMFLOAT4 rotation_;
 	XMFLOAT3 position_;
 	XMFLOAT3 scale_;
+
+	XMFLOAT4X4 localMatrix_;
+	bool dirty_ = true;
+	unsigned int version_ = 0;
 };
 
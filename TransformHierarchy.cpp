@@ -0,0 +1,161 @@
+#include "TransformHierarchy.h"
+#include <algorithm>
+#include <cstring>
+
+TransformHierarchy::TransformHierarchy() :
+	rebuildNeeded_(false)
+{
+}
+
+TransformHierarchy::~TransformHierarchy()
+{
+}
+
+TransformHandle TransformHierarchy::Create(TransformHandle parent)
+{
+	TransformHandle handle;
+
+	if (freeHandles_.empty()) {
+		handle = (TransformHandle)handleToSlot_.size();
+		handleToSlot_.push_back(-1);
+	}
+	else {
+		handle = freeHandles_.back();
+		freeHandles_.pop_back();
+	}
+
+	int parentSlot = (parent == INVALID_TRANSFORM) ? -1 : handleToSlot_[parent];
+
+	// appending always puts us after our parent. the depth order is only
+	// put back together on the next update.
+	int slot = (int)parents_.size();
+	handleToSlot_[handle] = slot;
+	slotToHandle_.push_back(handle);
+
+	XMFLOAT4X4A identity;
+	XMStoreFloat4x4A(&identity, XMMatrixIdentity());
+
+	locals_.push_back(identity);
+	worlds_.push_back(identity);
+	parents_.push_back(parentSlot);
+	depths_.push_back(parentSlot == -1 ? 0 : depths_[parentSlot] + 1);
+	dirty_.push_back(1);
+
+	if (slot > 0 && depths_[slot] < depths_[slot - 1]) rebuildNeeded_ = true;
+
+	return handle;
+}
+
+void TransformHierarchy::Destroy(TransformHandle handle)
+{
+	int slot = handleToSlot_[handle];
+
+	// leave the entry in place until the next rebuild, so that slots
+	// don't shuffle around between updates
+	slotToHandle_[slot] = INVALID_TRANSFORM;
+	handleToSlot_[handle] = -1;
+	freeHandles_.push_back(handle);
+
+	rebuildNeeded_ = true;
+}
+
+void TransformHierarchy::SetLocal(TransformHandle handle, FXMMATRIX local)
+{
+	int slot = handleToSlot_[handle];
+
+	XMStoreFloat4x4A(&locals_[slot], local);
+	dirty_[slot] = 1;
+}
+
+XMMATRIX TransformHierarchy::GetWorld(TransformHandle handle) const
+{
+	return XMLoadFloat4x4A(&worlds_[handleToSlot_[handle]]);
+}
+
+unsigned int TransformHierarchy::Update()
+{
+	if (rebuildNeeded_) Rebuild();
+
+	rebuilt_.clear();
+	size_t count = parents_.size();
+
+	XMFLOAT4X4A* locals = locals_.data();
+	XMFLOAT4X4A* worlds = worlds_.data();
+	const int* parents = parents_.data();
+	unsigned char* dirty = dirty_.data();
+
+	// parents always come first, so by the time we reach an entry its
+	// parent's world matrix and dirty flag are final for this frame
+	for (size_t i = 0; i < count; i++) {
+		int parent = parents[i];
+
+		if (parent != -1 && dirty[parent]) dirty[i] = 1;
+		if (!dirty[i]) continue;
+
+		XMMATRIX local = XMLoadFloat4x4A(&locals[i]);
+
+		if (parent == -1) {
+			XMStoreFloat4x4A(&worlds[i], local);
+		}
+		else {
+			XMStoreFloat4x4A(&worlds[i], XMMatrixMultiply(local, XMLoadFloat4x4A(&worlds[parent])));
+		}
+
+		rebuilt_.push_back(slotToHandle_[i]);
+	}
+
+	if (count > 0) memset(dirty, 0, count);
+
+	return (unsigned int)rebuilt_.size();
+}
+
+void TransformHierarchy::Rebuild()
+{
+	// live entries, in depth order. the sort is stable so siblings keep
+	// the order they were created in.
+	std::vector<int> order;
+	order.reserve(parents_.size());
+
+	for (int slot = 0; slot < (int)parents_.size(); slot++) {
+		if (slotToHandle_[slot] != INVALID_TRANSFORM) order.push_back(slot);
+	}
+
+	std::stable_sort(order.begin(), order.end(), [this](int a, int b) {
+		return depths_[a] < depths_[b];
+	});
+
+	std::vector<int> newSlots(parents_.size(), -1);
+	for (int i = 0; i < (int)order.size(); i++) {
+		newSlots[order[i]] = i;
+	}
+
+	std::vector<XMFLOAT4X4A> locals(order.size());
+	std::vector<XMFLOAT4X4A> worlds(order.size());
+	std::vector<int> parents(order.size());
+	std::vector<int> depths(order.size());
+	std::vector<unsigned char> dirty(order.size());
+	std::vector<TransformHandle> slotToHandle(order.size());
+
+	for (int i = 0; i < (int)order.size(); i++) {
+		int oldSlot = order[i];
+		int oldParent = parents_[oldSlot];
+
+		locals[i] = locals_[oldSlot];
+		worlds[i] = worlds_[oldSlot];
+		parents[i] = (oldParent == -1) ? -1 : newSlots[oldParent];
+		depths[i] = depths_[oldSlot];
+		dirty[i] = dirty_[oldSlot];
+		slotToHandle[i] = slotToHandle_[oldSlot];
+
+		handleToSlot_[slotToHandle[i]] = i;
+	}
+
+	locals_.swap(locals);
+	worlds_.swap(worlds);
+	parents_.swap(parents);
+	depths_.swap(depths);
+	dirty_.swap(dirty);
+	slotToHandle_.swap(slotToHandle);
+
+	rebuildNeeded_ = false;
+}
@@ -0,0 +1,60 @@
+#pragma once
+#include "DirectXCore.h"
+#include <vector>
+
+// A handle to an entry in the hierarchy. Handles stay valid while the
+// entries behind them get moved around.
+typedef int TransformHandle;
+
+const TransformHandle INVALID_TRANSFORM = -1;
+
+// Data-oriented store for the world matrices of the whole scene. Parent
+// indices, local matrices and world matrices live in flat arrays sorted
+// by depth, so every parent comes before its children and one linear pass
+// brings every world matrix up to date. Only entries whose local matrix
+// changed, or whose parent's world matrix changed, are recomputed.
+
+class TransformHierarchy
+{
+public:
+	TransformHierarchy();
+	~TransformHierarchy();
+
+	// parent may be INVALID_TRANSFORM for a root
+	TransformHandle			Create(TransformHandle parent);
+
+	// children have to be destroyed before their parent
+	void					Destroy(TransformHandle handle);
+
+	void					SetLocal(TransformHandle handle, FXMMATRIX local);
+	XMMATRIX				GetWorld(TransformHandle handle) const;
+
+	// recompute every world matrix that's out of date. returns how many
+	// were rebuilt.
+	unsigned int			Update();
+
+	inline size_t			GetCount() const { return parents_.size(); }
+
+	// the entries whose world matrix changed in the last update
+	inline const std::vector<TransformHandle>&	GetRebuilt() const { return rebuilt_; }
+
+private:
+	// removes destroyed entries and restores depth order
+	void					Rebuild();
+
+	std::vector<XMFLOAT4X4A>		locals_;
+	std::vector<XMFLOAT4X4A>		worlds_;
+	std::vector<int>				parents_;
+	std::vector<int>				depths_;
+	std::vector<unsigned char>		dirty_;
+
+	// handles are indices into handleToSlot_. slotToHandle_ maps back,
+	// and is INVALID_TRANSFORM for destroyed entries awaiting a rebuild.
+	std::vector<int>				handleToSlot_;
+	std::vector<TransformHandle>	slotToHandle_;
+	std::vector<TransformHandle>	freeHandles_;
+
+	std::vector<TransformHandle>	rebuilt_;
+
+	bool							rebuildNeeded_;
+};
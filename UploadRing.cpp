@@ -0,0 +1,110 @@
+#include "UploadRing.h"
+
+UploadRing::UploadRing(size_t capacity) :
+	capacity_(0),
+	head_(0),
+	tail_(0),
+	used_(0),
+	frame_(0),
+	frameBytes_(0)
+{
+	Resize(capacity);
+}
+
+UploadRing::~UploadRing()
+{
+}
+
+void UploadRing::Resize(size_t capacity)
+{
+	capacity_ = capacity;
+	stats_.Capacity = capacity;
+	Reset();
+}
+
+void UploadRing::BeginFrame(unsigned long long frame)
+{
+	frame_ = frame;
+	frameBytes_ = 0;
+
+	stats_.Stalls = 0;
+	stats_.Overflows = 0;
+}
+
+void UploadRing::EndFrame()
+{
+	// a frame that never allocated has nothing for the GPU to hold on to
+	if (frameBytes_ == 0) return;
+
+	Frame frame = { frame_, head_, frameBytes_ };
+	frames_.push_back(frame);
+	frameBytes_ = 0;
+}
+
+void UploadRing::Retire(unsigned long long frame)
+{
+	while (!frames_.empty() && frames_.front().Frame <= frame) {
+		tail_ = frames_.front().End;
+		used_ -= frames_.front().Bytes;
+		frames_.pop_front();
+	}
+
+	// once everything's back, start again at the front so the next
+	// frame doesn't have to wrap part way through
+	if (used_ == 0) {
+		head_ = 0;
+		tail_ = 0;
+	}
+}
+
+void UploadRing::Reset()
+{
+	frames_.clear();
+	head_ = 0;
+	tail_ = 0;
+	used_ = 0;
+	frameBytes_ = 0;
+}
+
+size_t UploadRing::Allocate(size_t size, size_t alignment)
+{
+	size_t offset = (head_ + alignment - 1) & ~(alignment - 1);
+	size_t end = offset + size;
+
+	bool fits;
+
+	if (used_ == 0 || head_ > tail_) {
+		// everything in use is behind us, so there's room up to the end,
+		// or failing that from the front up to the oldest frame
+		fits = end <= capacity_;
+
+		if (!fits && size <= tail_) {
+			offset = 0;
+			end = size;
+			fits = true;
+		}
+	}
+	else {
+		// we've wrapped, and the oldest frame is ahead of us
+		fits = (used_ < capacity_) && end <= tail_;
+	}
+
+	if (!fits) {
+		if (HasPending())	stats_.Stalls++;
+		else				stats_.Overflows++;
+
+		return UPLOAD_RING_FULL;
+	}
+
+	// anything skipped over at the end of the ring when wrapping is
+	// counted as used, and comes back along with the rest of the frame
+	size_t consumed = (offset >= head_) ? end - head_ : (capacity_ - head_) + end;
+
+	head_ = end;
+	used_ += consumed;
+	frameBytes_ += consumed;
+
+	if (used_ > stats_.HighWater) stats_.HighWater = used_;
+
+	return offset;
+}
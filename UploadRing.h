@@ -0,0 +1,89 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+
+// Bookkeeping for a ring of upload space shared between the CPU and GPU.
+// Each frame's data is sub-allocated linearly, one allocation after
+// another, wrapping back to the front once the end is reached. A frame's
+// space is only handed out again once whoever owns the ring says the GPU
+// is done with it, by retiring the frame.
+//
+// Only offsets are dealt with here. The memory itself, and knowing when
+// the GPU has finished a frame, are up to the owner, so none of this
+// needs a device.
+
+// what Allocate gives back when the ring is full
+const size_t UPLOAD_RING_FULL = (size_t)-1;
+
+// how much a ring has been asked to hold
+struct UploadStats {
+	size_t				Capacity;
+	size_t				HighWater;		// most bytes in flight at once, ever
+	unsigned int		Stalls;			// allocations that had to wait for
+	unsigned int		Overflows;		// the GPU, and frames that filled the
+										// ring on their own. since BeginFrame.
+
+	UploadStats() : Capacity(0), HighWater(0), Stalls(0), Overflows(0) {}
+};
+
+class UploadRing
+{
+public:
+	UploadRing(size_t capacity = 0);
+	~UploadRing();
+
+	// forget everything and start again with a different capacity
+	void				Resize(size_t capacity);
+
+	// everything allocated between these belongs to frame
+	void				BeginFrame(unsigned long long frame);
+	void				EndFrame();
+
+	// the GPU has finished with frame and everything before it
+	void				Retire(unsigned long long frame);
+
+	// drop every frame still in flight, along with everything allocated
+	// so far this frame. only safe once the memory behind them has been
+	// replaced.
+	void				Reset();
+
+	// the offset of size bytes aligned to alignment, which has to be a
+	// power of two. UPLOAD_RING_FULL if frames still in flight are in the
+	// way, in which case wait for the oldest, retire it and try again. if
+	// there's nothing in flight to wait for, this frame has filled the
+	// ring by itself.
+	size_t				Allocate(size_t size, size_t alignment);
+
+	// the oldest frame the GPU may still be reading from
+	inline bool			HasPending() const { return !frames_.empty(); }
+	inline unsigned long long	GetOldestPending() const { return frames_.front().Frame; }
+
+	inline size_t		GetCapacity() const { return capacity_; }
+	inline size_t		GetUsed() const { return used_; }
+	inline size_t		GetFrameBytes() const { return frameBytes_; }
+	inline const UploadStats&	GetStats() const { return stats_; }
+
+private:
+	// where a frame's space ends, and how much of the ring it took,
+	// counting anything skipped to align or to wrap
+	struct Frame {
+		unsigned long long	Frame;
+		size_t			End;
+		size_t			Bytes;
+	};
+
+	size_t				capacity_;
+
+	// allocations are made at head_, and everything from tail_ up to it
+	// is still in use. the two are only equal when the ring is empty
+	// or completely full, which used_ tells apart.
+	size_t				head_;
+	size_t				tail_;
+	size_t				used_;
+
+	unsigned long long	frame_;
+	size_t				frameBytes_;
+
+	std::deque<Frame>	frames_;
+	UploadStats			stats_;
+};
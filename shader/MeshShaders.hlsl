@@ -0,0 +1,131 @@
+// Textured mesh shaders, lit in world space by a single directional
+// light. VShader takes its world matrix from the per-object constants.
+// VShaderInstanced takes one per instance from the second vertex stream,
+// and the per-object matrix only places the sub-mesh within its mesh.
+//
+// These replace TexturedShaders.hlsl, which was never in the tree, so
+// the lighting here can't be compared against it directly. What the old
+// renderer sent it is kept to: LightVector is the direction the light
+// travels, as Lighting holds it, only now in world space rather than
+// rotated into the mesh's own. Normals go through the inverse transpose
+// of the world matrix, so with the uniform scales the scene uses the
+// diffuse term is the same as lighting in object space. Specular is
+// Blinn-Phong, which is a visual change: highlights are wider than a
+// Phong reflection at the same shininess.
+//
+// Constants are split by how often they change. The layouts match
+// MeshRenderer's FrameConstants and ObjectConstants, and Material's
+// MaterialConstants.
+
+cbuffer FrameConstants : register(b0)
+{
+	row_major float4x4	ViewProjection;
+	float4				CameraPosition;
+	float4				LightVector;
+	float4				LightColor;
+	float4				AmbientColor;
+};
+
+cbuffer ObjectConstants : register(b1)
+{
+	row_major float4x4	World;
+};
+
+cbuffer MaterialConstants : register(b2)
+{
+	float4				DiffuseCoefficient;
+	float4				SpecularCoefficient;
+	float				Shininess;
+	float				Opacity;
+	float2				Padding;
+};
+
+Texture2D Texture;
+SamplerState ss;
+
+struct VertexShaderInput
+{
+	float3 Position : POSITION;
+	float3 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD;
+};
+
+struct InstancedVertexShaderInput
+{
+	float3 Position : POSITION;
+	float3 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD;
+	float4 World0 : WORLD0;
+	float4 World1 : WORLD1;
+	float4 World2 : WORLD2;
+	float4 World3 : WORLD3;
+};
+
+struct PixelShaderInput
+{
+	float4 Position : SV_POSITION;
+	float4 WorldPosition : POSITION;
+	float3 Normal : NORMAL;
+	float2 TexCoord : TEXCOORD;
+};
+
+// the inverse transpose of a matrix's upper 3x3, up to scale, which is
+// all a normal needs since it's normalised afterwards. the determinant's
+// sign keeps normals facing out of mirrored meshes.
+float3x3 NormalMatrix(float4x4 world)
+{
+	float3 x = world[0].xyz;
+	float3 y = world[1].xyz;
+	float3 z = world[2].xyz;
+
+	float3x3 cofactors = float3x3(cross(y, z), cross(z, x), cross(x, y));
+	return cofactors * sign(dot(x, cross(y, z)));
+}
+
+PixelShaderInput Transform(float3 position, float3 normal, float2 texCoord, float4x4 world)
+{
+	PixelShaderInput output;
+
+	output.WorldPosition = mul(float4(position, 1.0f), world);
+	output.Position = mul(output.WorldPosition, ViewProjection);
+	output.Normal = normalize(mul(normal, NormalMatrix(world)));
+	output.TexCoord = texCoord;
+
+	return output;
+}
+
+PixelShaderInput VShader(VertexShaderInput input)
+{
+	return Transform(input.Position, input.Normal, input.TexCoord, World);
+}
+
+PixelShaderInput VShaderInstanced(InstancedVertexShaderInput input)
+{
+	float4x4 world = mul(World, float4x4(input.World0, input.World1, input.World2, input.World3));
+	return Transform(input.Position, input.Normal, input.TexCoord, world);
+}
+
+float4 PShader(PixelShaderInput input) : SV_TARGET
+{
+	float4 colour = Texture.Sample(ss, input.TexCoord);
+
+	float3 normal = normalize(input.Normal);
+	float3 toLight = normalize(-LightVector.xyz);
+	float3 toEye = normalize(CameraPosition.xyz - input.WorldPosition.xyz);
+
+	float diffuse = saturate(dot(normal, toLight));
+
+	float specular = 0.0f;
+	if (Shininess > 0.0f)
+	{
+		float3 halfway = normalize(toLight + toEye);
+		specular = pow(saturate(dot(normal, halfway)), Shininess);
+	}
+
+	float4 lighting = saturate(AmbientColor + DiffuseCoefficient * LightColor * diffuse);
+
+	float4 result = lighting * colour + SpecularCoefficient * LightColor * specular;
+	result.a = colour.a * Opacity;
+
+	return result;
+}
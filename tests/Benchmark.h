@@ -0,0 +1,32 @@
+#pragma once
+#include <chrono>
+#include <vector>
+
+// A minimal benchmark runner for the parts of the engine that don't need
+// a device or a window. Benchmarks register themselves with BENCHMARK and
+// print their own results, one line per measurement.
+
+typedef void (*BenchmarkFunction)();
+
+struct BenchmarkEntry {
+	const char*			Name;
+	BenchmarkFunction	Function;
+};
+
+std::vector<BenchmarkEntry>&	GetBenchmarks();
+
+struct BenchmarkRegistrar {
+	BenchmarkRegistrar(const char* name, BenchmarkFunction function) { GetBenchmarks().push_back({ name, function }); }
+};
+
+#define BENCHMARK(name) \
+	static void name(); \
+	static BenchmarkRegistrar name##Registrar(#name, name); \
+	static void name()
+
+typedef std::chrono::high_resolution_clock BenchmarkClock;
+
+double				SecondsSince(BenchmarkClock::time_point start);
+
+// prints how long count things took, and how many that is a second
+void				PrintRate(const char* what, size_t count, double seconds);
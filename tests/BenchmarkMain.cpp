@@ -0,0 +1,39 @@
+#include "Benchmark.h"
+#include <cstring>
+#include <iostream>
+
+std::vector<BenchmarkEntry>& GetBenchmarks()
+{
+	static std::vector<BenchmarkEntry> benchmarks;
+	return benchmarks;
+}
+
+double SecondsSince(BenchmarkClock::time_point start)
+{
+	return std::chrono::duration<double>(BenchmarkClock::now() - start).count();
+}
+
+void PrintRate(const char* what, size_t count, double seconds)
+{
+	std::cout << "  " << what << ": " << count << " in " << (seconds * 1000.0) << "ms ("
+		<< (unsigned long long)(count / seconds) << "/s, " << (seconds * 1e9 / count) << "ns each)" << std::endl;
+}
+
+// runs every benchmark, or just those whose names start with the first argument
+int main(int argc, char** argv)
+{
+	const char* filter = (argc > 1) ? argv[1] : "";
+	bool ran = false;
+
+	for (const BenchmarkEntry& benchmark : GetBenchmarks()) {
+		if (strncmp(benchmark.Name, filter, strlen(filter)) != 0) continue;
+
+		std::cout << benchmark.Name << std::endl;
+		benchmark.Function();
+		ran = true;
+	}
+
+	if (!ran) std::cout << "no benchmarks match " << filter << std::endl;
+
+	return ran ? 0 : 1;
+}
@@ -0,0 +1,57 @@
+#include "Benchmark.h"
+#include "../InstanceBatcher.h"
+#include <iostream>
+
+namespace
+{
+	const size_t INSTANCE_COUNT = 100000;
+	const size_t FRAMES = 20;
+	const unsigned int LOD_COUNT = 3;
+
+	// the batcher only ever compares mesh addresses
+	char meshes[256];
+
+	Mesh* FakeMesh(size_t i)
+	{
+		return (Mesh*)&meshes[i];
+	}
+
+	// a frame's worth of instances, spread over meshCount meshes and their
+	// levels of detail in the order a scene walk would find them
+	void BatchFrames(InstanceBatcher& batcher, size_t meshCount)
+	{
+		std::vector<XMFLOAT4X4> worlds(INSTANCE_COUNT);
+		for (size_t i = 0; i < INSTANCE_COUNT; i++) {
+			XMStoreFloat4x4(&worlds[i], XMMatrixTranslation((float)(i % 1000), 0.0f, (float)(i / 1000)));
+		}
+
+		size_t groups = 0;
+
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (size_t frame = 0; frame < FRAMES; frame++) {
+			batcher.Clear();
+
+			for (size_t i = 0; i < INSTANCE_COUNT; i++) {
+				batcher.Add(nullptr, FakeMesh(i % meshCount), (unsigned int)(i / meshCount) % LOD_COUNT, XMLoadFloat4x4(&worlds[i]));
+			}
+
+			batcher.Build();
+			groups += batcher.GetGroups().size();
+		}
+		double seconds = SecondsSince(start);
+
+		std::cout << "  " << meshCount << " meshes, " << (groups / FRAMES) << " groups a frame" << std::endl;
+		PrintRate("  add and build", INSTANCE_COUNT * FRAMES, seconds);
+	}
+}
+
+BENCHMARK(InstanceBatching)
+{
+	// the batcher keeps its memory between frames, as it does in the
+	// render queue, so only the first frame of the first run allocates
+	InstanceBatcher batcher;
+
+	for (size_t meshCount : { (size_t)1, (size_t)16, (size_t)256 }) {
+		BatchFrames(batcher, meshCount);
+	}
+}
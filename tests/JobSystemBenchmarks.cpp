@@ -0,0 +1,142 @@
+#include "Benchmark.h"
+#include "../JobSystem.h"
+#include <atomic>
+#include <cmath>
+#include <iostream>
+
+namespace
+{
+	const size_t SPAWN_COUNT = 100000;
+	const size_t ROUND_TRIPS = 10000;
+	const size_t FAN_OUT_ITEMS = 1000000;
+	const size_t FAN_OUT_BATCH = 1000;
+	const size_t FAN_OUT_REPEATS = 50;
+
+	void Nothing(void* data, size_t begin, size_t end)
+	{
+	}
+
+	// enough work per item that the batches aren't all overhead
+	void SumRoots(void* data, size_t begin, size_t end)
+	{
+		double* sums = static_cast<double*>(data);
+
+		double sum = 0.0;
+		for (size_t i = begin; i < end; i++) {
+			sum += std::sqrt((double)i);
+		}
+
+		sums[begin / FAN_OUT_BATCH] = sum;
+	}
+
+	// each job queues more jobs from whichever worker runs it, so work
+	// spreads out through steals rather than from one queue
+	struct Tree {
+		JobSystem*			Jobs;
+		JobCounter*			Counter;
+		std::atomic<size_t>	Leaves;
+	};
+
+	void Branch(void* data, size_t begin, size_t end)
+	{
+		Tree* tree = static_cast<Tree*>(data);
+
+		if (end - begin == 1) {
+			tree->Leaves.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+
+		size_t middle = begin + (end - begin) / 2;
+		tree->Jobs->Run({ Branch, data, begin, middle }, tree->Counter);
+		tree->Jobs->Run({ Branch, data, middle, end }, tree->Counter);
+	}
+
+	void PrintWorkers(const JobSystem& jobs)
+	{
+		std::cout << "  " << jobs.GetWorkerCount() << " queues, " << std::thread::hardware_concurrency() << " hardware threads" << std::endl;
+	}
+}
+
+BENCHMARK(JobSpawn)
+{
+	JobSystem jobs;
+	PrintWorkers(jobs);
+
+	// lots of empty jobs at once, so this is all queueing and bookkeeping
+	JobCounter counter;
+	BenchmarkClock::time_point start = BenchmarkClock::now();
+	for (size_t i = 0; i < SPAWN_COUNT; i++) {
+		jobs.Run({ Nothing, nullptr, 0, 1 }, &counter);
+	}
+	jobs.Wait(&counter);
+	PrintRate("run and wait, empty jobs", SPAWN_COUNT, SecondsSince(start));
+
+	// one job at a time, so each Wait has to notice the job finishing
+	start = BenchmarkClock::now();
+	for (size_t i = 0; i < ROUND_TRIPS; i++) {
+		JobCounter single;
+		jobs.Run({ Nothing, nullptr, 0, 1 }, &single);
+		jobs.Wait(&single);
+	}
+	PrintRate("round trips", ROUND_TRIPS, SecondsSince(start));
+}
+
+BENCHMARK(JobFanOut)
+{
+	JobSystem jobs;
+	PrintWorkers(jobs);
+
+	std::vector<double> sums(FAN_OUT_ITEMS / FAN_OUT_BATCH);
+
+	BenchmarkClock::time_point start = BenchmarkClock::now();
+	for (size_t repeat = 0; repeat < FAN_OUT_REPEATS; repeat++) {
+		SumRoots(sums.data(), 0, FAN_OUT_ITEMS);
+	}
+	PrintRate("serial", FAN_OUT_ITEMS * FAN_OUT_REPEATS, SecondsSince(start));
+
+	start = BenchmarkClock::now();
+	for (size_t repeat = 0; repeat < FAN_OUT_REPEATS; repeat++) {
+		JobCounter counter;
+		jobs.ParallelFor(FAN_OUT_ITEMS, FAN_OUT_BATCH, SumRoots, sums.data(), &counter);
+		jobs.Wait(&counter);
+	}
+	PrintRate("parallel for", FAN_OUT_ITEMS * FAN_OUT_REPEATS, SecondsSince(start));
+}
+
+BENCHMARK(JobSteal)
+{
+	// more workers than cores, so they're all fighting over the queues
+	for (unsigned int workers : { 0u, 4u, 8u }) {
+		JobSystem jobs(workers);
+		PrintWorkers(jobs);
+
+		// everything queued by the main thread, then taken off it by
+		// whoever gets there first
+		unsigned long long stolen = jobs.GetJobsStolen();
+		JobCounter counter;
+		BenchmarkClock::time_point start = BenchmarkClock::now();
+		for (size_t i = 0; i < SPAWN_COUNT; i++) {
+			jobs.Run({ Nothing, nullptr, 0, 1 }, &counter);
+		}
+		jobs.Wait(&counter);
+		double seconds = SecondsSince(start);
+		PrintRate("one queue", SPAWN_COUNT, seconds);
+		std::cout << "    " << (jobs.GetJobsStolen() - stolen) << " stolen" << std::endl;
+
+		// jobs that spawn jobs, so every queue is being pushed to and
+		// stolen from at once
+		stolen = jobs.GetJobsStolen();
+		JobCounter treeCounter;
+		Tree tree;
+		tree.Jobs = &jobs;
+		tree.Counter = &treeCounter;
+		tree.Leaves = 0;
+
+		start = BenchmarkClock::now();
+		jobs.Run({ Branch, &tree, 0, SPAWN_COUNT }, &treeCounter);
+		jobs.Wait(&treeCounter);
+		seconds = SecondsSince(start);
+		PrintRate("spawning tree", SPAWN_COUNT * 2 - 1, seconds);
+		std::cout << "    " << (jobs.GetJobsStolen() - stolen) << " stolen, " << tree.Leaves.load() << " leaves" << std::endl;
+	}
+}
@@ -0,0 +1,178 @@
+#include "Test.h"
+#include "../JobSystem.h"
+#include <atomic>
+#include <chrono>
+
+namespace
+{
+	void CountItems(void* data, size_t begin, size_t end)
+	{
+		std::atomic<int>* counts = static_cast<std::atomic<int>*>(data);
+
+		for (size_t i = begin; i < end; i++) {
+			counts[i].fetch_add(1);
+		}
+	}
+
+	struct Tree {
+		JobSystem*			Jobs;
+		JobCounter*			Counter;
+		std::atomic<size_t>	Leaves;
+	};
+
+	void Branch(void* data, size_t begin, size_t end)
+	{
+		Tree* tree = static_cast<Tree*>(data);
+
+		if (end - begin == 1) {
+			tree->Leaves.fetch_add(1);
+			return;
+		}
+
+		size_t middle = begin + (end - begin) / 2;
+		tree->Jobs->Run({ Branch, data, begin, middle }, tree->Counter);
+		tree->Jobs->Run({ Branch, data, middle, end }, tree->Counter);
+	}
+
+	struct Ordering {
+		std::atomic<bool>	FirstDone;
+		std::atomic<bool>	SecondSawFirst;
+	};
+
+	void First(void* data, size_t begin, size_t end)
+	{
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		static_cast<Ordering*>(data)->FirstDone = true;
+	}
+
+	void Second(void* data, size_t begin, size_t end)
+	{
+		Ordering* ordering = static_cast<Ordering*>(data);
+		ordering->SecondSawFirst = ordering->FirstDone.load();
+	}
+
+	struct MainThreadCheck {
+		JobSystem*			Jobs;
+		JobCounter*			Counter;
+		std::thread::id		RanOn;
+	};
+
+	void RecordThread(void* data, size_t begin, size_t end)
+	{
+		static_cast<MainThreadCheck*>(data)->RanOn = std::this_thread::get_id();
+	}
+
+	void QueueMainThreadJob(void* data, size_t begin, size_t end)
+	{
+		MainThreadCheck* check = static_cast<MainThreadCheck*>(data);
+		check->Jobs->RunOnMainThread({ RecordThread, data, 0, 1 }, check->Counter);
+	}
+}
+
+TEST(ParallelForRunsEveryItemOnce)
+{
+	const size_t count = 100000;
+
+	// batches of one, so the queues have to grow well past their
+	// starting size
+	for (size_t batchSize : { (size_t)1, (size_t)7, (size_t)1000 }) {
+		JobSystem jobs(4);
+		std::vector<std::atomic<int>> counts(count);
+		for (auto&& itemCount : counts) {
+			itemCount = 0;
+		}
+
+		JobCounter counter;
+		jobs.ParallelFor(count, batchSize, CountItems, counts.data(), &counter);
+		jobs.Wait(&counter);
+
+		bool allOnce = true;
+		for (auto&& itemCount : counts) {
+			allOnce &= (itemCount.load() == 1);
+		}
+
+		CHECK(counter.IsDone());
+		CHECK(allOnce);
+	}
+}
+
+TEST(JobsQueuedByJobsAllRun)
+{
+	const size_t leaves = 50000;
+
+	// every queue is pushed to, popped and stolen from at once
+	for (int repeat = 0; repeat < 20; repeat++) {
+		JobSystem jobs(8);
+		JobCounter counter;
+
+		Tree tree;
+		tree.Jobs = &jobs;
+		tree.Counter = &counter;
+		tree.Leaves = 0;
+
+		jobs.Run({ Branch, &tree, 0, leaves }, &counter);
+		jobs.Wait(&counter);
+
+		CHECK(tree.Leaves.load() == leaves);
+		CHECK(jobs.GetJobsRun() == leaves * 2 - 1);
+	}
+}
+
+TEST(DependentJobsWaitForTheirCounter)
+{
+	JobSystem jobs(2);
+
+	Ordering ordering;
+	ordering.FirstDone = false;
+	ordering.SecondSawFirst = false;
+
+	JobCounter first;
+	JobCounter second;
+	jobs.Run({ First, &ordering, 0, 1 }, &first);
+	jobs.Run({ Second, &ordering, 0, 1 }, &second, &first);
+	jobs.Wait(&second);
+
+	CHECK(first.IsDone());
+	CHECK(ordering.SecondSawFirst.load());
+}
+
+TEST(MainThreadJobsRunOnTheMainThread)
+{
+	JobSystem jobs(2);
+	JobCounter counter;
+
+	// queued from a worker while the main thread is waiting
+	MainThreadCheck check;
+	check.Jobs = &jobs;
+	check.Counter = &counter;
+
+	jobs.Run({ QueueMainThreadJob, &check, 0, 1 }, &counter);
+	jobs.Wait(&counter);
+
+	CHECK(check.RanOn == std::this_thread::get_id());
+}
+
+TEST(ThreadsOutsideTheSystemCanRunAndWait)
+{
+	const size_t count = 10000;
+
+	JobSystem jobs(2);
+	std::vector<std::atomic<int>> counts(count);
+	for (auto&& itemCount : counts) {
+		itemCount = 0;
+	}
+
+	std::thread outsider([&] {
+		JobCounter counter;
+		jobs.ParallelFor(count, 10, CountItems, counts.data(), &counter);
+		jobs.Wait(&counter);
+	});
+	outsider.join();
+
+	bool allOnce = true;
+	for (auto&& itemCount : counts) {
+		allOnce &= (itemCount.load() == 1);
+	}
+
+	CHECK(allOnce);
+}
@@ -0,0 +1,77 @@
+#include "Test.h"
+#include "../MemoryPool.h"
+#include <cstdint>
+
+namespace
+{
+	struct alignas(64) CacheLine {
+		float		Values[3];
+	};
+
+	struct alignas(16) Vector {
+		float		Values[4];
+	};
+
+	template<typename T>
+	bool IsAligned(const T* pointer)
+	{
+		return ((uintptr_t)pointer % alignof(T)) == 0;
+	}
+}
+
+TEST(PooledObjectsAreAligned)
+{
+	// enough of each to need several chunks
+	std::vector<std::shared_ptr<CacheLine>> lines;
+	std::vector<std::shared_ptr<Vector>> vectors;
+
+	for (size_t i = 0; i < POOL_BLOCKS_PER_CHUNK * 3; i++) {
+		lines.push_back(MakePooled<CacheLine>());
+		vectors.push_back(MakePooled<Vector>());
+	}
+
+	bool allAligned = true;
+	for (size_t i = 0; i < lines.size(); i++) {
+		allAligned &= IsAligned(lines[i].get());
+		allAligned &= IsAligned(vectors[i].get());
+	}
+
+	CHECK(allAligned);
+}
+
+TEST(AllocatorArraysAreAligned)
+{
+	PoolAllocator<CacheLine> allocator;
+
+	CacheLine* lines = allocator.allocate(5);
+	CHECK(IsAligned(lines));
+	allocator.deallocate(lines, 5);
+
+	for (size_t alignment = 1; alignment <= 4096; alignment *= 2) {
+		void* memory = AllocateAligned(100, alignment);
+		CHECK((uintptr_t)memory % alignment == 0);
+		FreeAligned(memory);
+	}
+}
+
+TEST(FreedBlocksAreReused)
+{
+	BlockPool pool(32, 16, 4);
+
+	void* first = pool.Allocate();
+	void* second = pool.Allocate();
+	CHECK(first != second);
+	CHECK(pool.GetLiveCount() == 2);
+
+	// the last block freed is the next one handed out
+	pool.Free(first);
+	CHECK(pool.GetLiveCount() == 1);
+	CHECK(pool.Allocate() == first);
+
+	// a fifth block needs a second chunk
+	for (int i = 0; i < 3; i++) {
+		pool.Allocate();
+	}
+	CHECK(pool.GetChunkCount() == 2);
+	CHECK(pool.GetLiveCount() == 5);
+}
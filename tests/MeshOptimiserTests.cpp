@@ -0,0 +1,159 @@
+#include "Test.h"
+#include "../MeshOptimiser.h"
+#include <algorithm>
+#include <array>
+#include <random>
+
+namespace
+{
+	struct Vertex {
+		float		Position[3];
+		float		TexCoord[2];
+	};
+
+	typedef std::array<float, 5> VertexKey;
+	typedef std::array<VertexKey, 3> TriangleKey;
+
+	// a flat grid of size x size quads, every triangle with its own copy
+	// of its vertices the way an importer without welding hands them over
+	struct Grid {
+		std::vector<Vertex>			Vertices;
+		std::vector<unsigned int>	Indices;
+	};
+
+	Grid MakeGrid(unsigned int size)
+	{
+		Grid grid;
+
+		auto corner = [size](unsigned int x, unsigned int z) {
+			Vertex vertex = { { (float)x, 0.0f, (float)z }, { (float)x / size, (float)z / size } };
+			return vertex;
+		};
+
+		for (unsigned int z = 0; z < size; z++) {
+			for (unsigned int x = 0; x < size; x++) {
+				Vertex quad[6] = {
+					corner(x, z), corner(x, z + 1), corner(x + 1, z + 1),
+					corner(x, z), corner(x + 1, z + 1), corner(x + 1, z)
+				};
+
+				for (const Vertex& vertex : quad) {
+					grid.Indices.push_back((unsigned int)grid.Vertices.size());
+					grid.Vertices.push_back(vertex);
+				}
+			}
+		}
+
+		return grid;
+	}
+
+	// the same triangles, drawn in a random order
+	void ShuffleTriangles(std::vector<unsigned int>& indices, unsigned int seed)
+	{
+		std::vector<unsigned int> order(indices.size() / 3);
+		for (unsigned int i = 0; i < order.size(); i++) order[i] = i;
+		std::shuffle(order.begin(), order.end(), std::mt19937(seed));
+
+		std::vector<unsigned int> shuffled;
+		for (unsigned int t : order) {
+			shuffled.insert(shuffled.end(), indices.begin() + t * 3, indices.begin() + t * 3 + 3);
+		}
+		indices.swap(shuffled);
+	}
+
+	VertexKey Key(const Vertex& vertex)
+	{
+		return { vertex.Position[0], vertex.Position[1], vertex.Position[2], vertex.TexCoord[0], vertex.TexCoord[1] };
+	}
+
+	// every triangle by what its corners hold rather than by index,
+	// rotated to start at its smallest corner so the winding still counts
+	std::vector<TriangleKey> GetTriangles(const std::vector<Vertex>& vertices, const std::vector<unsigned int>& indices)
+	{
+		std::vector<TriangleKey> triangles;
+
+		for (size_t t = 0; t < indices.size(); t += 3) {
+			TriangleKey triangle = { Key(vertices[indices[t]]), Key(vertices[indices[t + 1]]), Key(vertices[indices[t + 2]]) };
+			std::rotate(triangle.begin(), std::min_element(triangle.begin(), triangle.end()), triangle.end());
+			triangles.push_back(triangle);
+		}
+
+		std::sort(triangles.begin(), triangles.end());
+		return triangles;
+	}
+
+	bool IndicesInRange(const std::vector<unsigned int>& indices, unsigned int vertexCount)
+	{
+		for (unsigned int index : indices) {
+			if (index >= vertexCount) return false;
+		}
+		return true;
+	}
+}
+
+TEST(MeshOptimiserKeepsEveryTriangle)
+{
+	const unsigned int size = 32;
+
+	Grid grid = MakeGrid(size);
+	ShuffleTriangles(grid.Indices, 1);
+	std::vector<TriangleKey> before = GetTriangles(grid.Vertices, grid.Indices);
+
+	MeshOptimiserStats stats = OptimiseMesh(grid.Vertices.data(), (unsigned int)grid.Vertices.size(), sizeof(Vertex), grid.Indices);
+
+	// every corner is shared by up to six triangles, and welds down to one
+	CHECK(stats.VerticesBefore == size * size * 6);
+	CHECK(stats.VerticesAfter == (size + 1) * (size + 1));
+	CHECK(stats.Triangles == size * size * 2);
+	CHECK(grid.Indices.size() == size * size * 6);
+	CHECK(IndicesInRange(grid.Indices, stats.VerticesAfter));
+
+	grid.Vertices.resize(stats.VerticesAfter);
+	CHECK(GetTriangles(grid.Vertices, grid.Indices) == before);
+}
+
+TEST(MeshOptimiserOnlyWeldsIdenticalVertices)
+{
+	// two triangles sharing an edge, but with a texture seam down it
+	std::vector<Vertex> vertices = {
+		{ { 0, 0, 0 }, { 0, 0 } }, { { 0, 0, 1 }, { 0, 1 } }, { { 1, 0, 1 }, { 1, 1 } },
+		{ { 0, 0, 0 }, { 0, 0 } }, { { 1, 0, 1 }, { 0.5f, 1 } }, { { 1, 0, 0 }, { 1, 0 } }
+	};
+	std::vector<unsigned int> indices = { 0, 1, 2, 3, 4, 5 };
+
+	unsigned int welded = WeldVertices(vertices.data(), (unsigned int)vertices.size(), sizeof(Vertex), indices);
+
+	CHECK(welded == 5);
+	CHECK(indices[0] == indices[3]);
+	CHECK(indices[2] != indices[4]);
+	CHECK(IndicesInRange(indices, welded));
+}
+
+TEST(MeshOptimiserNeverMakesAGridsCacheWorse)
+{
+	const unsigned int size = 64;
+
+	// a grid drawn a row at a time is already fairly cache friendly, and
+	// a shuffled one about as bad as it gets
+	for (unsigned int seed : { 0u, 1u, 2u }) {
+		Grid grid = MakeGrid(size);
+		if (seed > 0) ShuffleTriangles(grid.Indices, seed);
+
+		MeshOptimiserStats stats = OptimiseMesh(grid.Vertices.data(), (unsigned int)grid.Vertices.size(), sizeof(Vertex), grid.Indices);
+
+		// measured against the welded input, since the unwelded one
+		// misses on every vertex whatever order it's in
+		Grid welded = MakeGrid(size);
+		if (seed > 0) ShuffleTriangles(welded.Indices, seed);
+		unsigned int weldedCount = WeldVertices(welded.Vertices.data(), (unsigned int)welded.Vertices.size(), sizeof(Vertex), welded.Indices);
+		float acmrBefore = CalculateACMR(welded.Indices, weldedCount);
+
+		CHECK(stats.AcmrBefore == 3.0f);
+		CHECK(stats.AcmrAfter <= acmrBefore);
+		CHECK(stats.AcmrAfter == CalculateACMR(grid.Indices, stats.VerticesAfter));
+
+		// Tipsify on a grid with a 16 entry cache lands at about 0.6
+		// misses a triangle, whichever order it started in
+		CHECK(stats.AcmrAfter < 0.7f);
+	}
+}
@@ -0,0 +1,69 @@
+#include "Benchmark.h"
+#include "../MeshSimplifier.h"
+#include <cmath>
+#include <iostream>
+#include <string>
+
+namespace
+{
+	const unsigned int REPEATS = 5;
+
+	struct Vertex {
+		float		Position[3];
+		float		Normal[3];
+		float		TexCoord[2];
+	};
+
+	// size x size quads of rolling hills, laid out like a mesh import
+	// would be, with a full vertex behind every position
+	void MakeTerrain(unsigned int size, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		for (unsigned int z = 0; z <= size; z++) {
+			for (unsigned int x = 0; x <= size; x++) {
+				float y = 4.0f * sinf(x * 0.15f) * cosf(z * 0.1f);
+				Vertex vertex = { { (float)x, y, (float)z }, { 0.0f, 1.0f, 0.0f }, { (float)x / size, (float)z / size } };
+				vertices.push_back(vertex);
+			}
+		}
+
+		for (unsigned int z = 0; z < size; z++) {
+			for (unsigned int x = 0; x < size; x++) {
+				unsigned int corner = z * (size + 1) + x;
+				unsigned int quad[6] = { corner, corner + size + 1, corner + size + 2, corner, corner + size + 2, corner + 1 };
+				indices.insert(indices.end(), quad, quad + 6);
+			}
+		}
+	}
+}
+
+BENCHMARK(MeshSimplify)
+{
+	for (unsigned int size : { 64u, 256u }) {
+		std::vector<Vertex> vertices;
+		std::vector<unsigned int> indices;
+		MakeTerrain(size, vertices, indices);
+
+		size_t triangles = indices.size() / 3;
+		std::cout << "  " << triangles << " triangles" << std::endl;
+
+		// the same steps the level of detail chain takes at import, each
+		// from the full mesh and held to the same share of its size. the
+		// hills are 8 high, so the bounds' extents are (size / 2, 4, size / 2).
+		float halfSize = size * 0.5f;
+		float maxError = sqrtf(halfSize * halfSize * 2.0f + 16.0f) * 0.05f;
+
+		for (unsigned int divisor : { 2u, 4u, 8u }) {
+			std::vector<unsigned int> simplified;
+			float error = 0.0f;
+
+			BenchmarkClock::time_point start = BenchmarkClock::now();
+			for (unsigned int repeat = 0; repeat < REPEATS; repeat++) {
+				error = SimplifyMesh(vertices.data(), (unsigned int)vertices.size(), sizeof(Vertex), indices, (unsigned int)indices.size() / divisor / 3 * 3, maxError, simplified);
+			}
+			double seconds = SecondsSince(start);
+
+			std::string what = "  to 1/" + std::to_string(divisor) + ", " + std::to_string(simplified.size() / 3) + " left, error " + std::to_string(error);
+			PrintRate(what.c_str(), triangles * REPEATS, seconds);
+		}
+	}
+}
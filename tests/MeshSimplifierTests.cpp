@@ -0,0 +1,113 @@
+#include "Test.h"
+#include "../MeshSimplifier.h"
+#include <cmath>
+#include <random>
+
+namespace
+{
+	struct Vertex {
+		float		Position[3];
+		float		TexCoord[2];
+	};
+
+	struct Terrain {
+		std::vector<Vertex>			Vertices;
+		std::vector<unsigned int>	Indices;
+	};
+
+	// size x size quads of rolling hills with a little noise on top, so
+	// there's some of everything from flat to rough to collapse
+	Terrain MakeTerrain(unsigned int size, float height, unsigned int seed)
+	{
+		Terrain terrain;
+		std::mt19937 random(seed);
+		std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+
+		for (unsigned int z = 0; z <= size; z++) {
+			for (unsigned int x = 0; x <= size; x++) {
+				float y = height * sinf(x * 0.3f) * cosf(z * 0.2f) + height * 0.2f * noise(random);
+				Vertex vertex = { { (float)x, y, (float)z }, { (float)x / size, (float)z / size } };
+				terrain.Vertices.push_back(vertex);
+			}
+		}
+
+		for (unsigned int z = 0; z < size; z++) {
+			for (unsigned int x = 0; x < size; x++) {
+				unsigned int corner = z * (size + 1) + x;
+				unsigned int quad[6] = { corner, corner + size + 1, corner + size + 2, corner, corner + size + 2, corner + 1 };
+				terrain.Indices.insert(terrain.Indices.end(), quad, quad + 6);
+			}
+		}
+
+		return terrain;
+	}
+
+	float Simplify(const Terrain& terrain, unsigned int targetIndexCount, float maxError, std::vector<unsigned int>& destination)
+	{
+		return SimplifyMesh(terrain.Vertices.data(), (unsigned int)terrain.Vertices.size(), sizeof(Vertex), terrain.Indices, targetIndexCount, maxError, destination);
+	}
+
+	float Measure(const Terrain& terrain, const std::vector<unsigned int>& simplified)
+	{
+		return MeasureSimplificationError(terrain.Vertices.data(), sizeof(Vertex), terrain.Indices, simplified);
+	}
+}
+
+TEST(SimplifiedMeshesStayWithinTheirErrorBound)
+{
+	// the bound and the measurement are both rounded to floats at the end
+	const float tolerance = 1e-4f;
+
+	bool allWithin = true;
+	bool allUnderMax = true;
+	bool allSimplified = true;
+
+	for (float height : { 0.5f, 2.0f, 5.0f }) {
+		for (unsigned int seed = 0; seed < 3; seed++) {
+			Terrain terrain = MakeTerrain(32, height, seed);
+
+			for (float maxError : { 0.05f, 0.5f, 2.0f }) {
+				std::vector<unsigned int> simplified;
+				float bound = Simplify(terrain, (unsigned int)terrain.Indices.size() / 10, maxError, simplified);
+
+				allWithin &= Measure(terrain, simplified) <= bound + tolerance;
+				allUnderMax &= bound <= maxError;
+				allSimplified &= simplified.size() <= terrain.Indices.size() && !simplified.empty();
+			}
+		}
+	}
+
+	CHECK(allWithin);
+	CHECK(allUnderMax);
+	CHECK(allSimplified);
+
+	// with nothing holding it back, a mesh goes down as far as it can
+	// without disappearing altogether
+	Terrain flat = MakeTerrain(16, 0.0f, 0);
+	std::vector<unsigned int> simplified;
+	float bound = Simplify(flat, 0, 1000.0f, simplified);
+
+	CHECK(!simplified.empty() && simplified.size() < flat.Indices.size() / 10);
+	CHECK(Measure(flat, simplified) <= bound + tolerance);
+}
+
+TEST(SimplifyingTheSameMeshGivesTheSameResult)
+{
+	Terrain terrain = MakeTerrain(32, 2.0f, 7);
+
+	std::vector<unsigned int> first;
+	float firstBound = Simplify(terrain, (unsigned int)terrain.Indices.size() / 4, 1.0f, first);
+
+	bool allSame = true;
+
+	for (int repeat = 0; repeat < 3; repeat++) {
+		// and into a destination that already holds something
+		std::vector<unsigned int> again(17, 3);
+		float bound = Simplify(terrain, (unsigned int)terrain.Indices.size() / 4, 1.0f, again);
+
+		allSame &= (again == first) && (bound == firstBound);
+	}
+
+	CHECK(first.size() < terrain.Indices.size());
+	CHECK(allSame);
+}
@@ -0,0 +1,134 @@
+#include "Test.h"
+#include "../RangeAllocator.h"
+
+TEST(RangeAllocatorTakesTheTightestFit)
+{
+	RangeAllocator ranges(100);
+
+	RangeHandle first = ranges.Allocate(10);
+	RangeHandle thirty = ranges.Allocate(30);
+	RangeHandle between = ranges.Allocate(5);
+	RangeHandle twenty = ranges.Allocate(20);
+	RangeHandle last = ranges.Allocate(5);
+
+	CHECK(ranges.GetOffset(first) == 0);
+	CHECK(ranges.GetOffset(between) == 40);
+	CHECK(ranges.GetOffset(last) == 65);
+
+	// leaves 30 free at 10, 20 at 45 and 30 at 70
+	ranges.Free(thirty);
+	ranges.Free(twenty);
+	CHECK(ranges.GetFreeRangeCount() == 3);
+
+	// the 20 fits best, even though the 30 before it is the first that fits
+	RangeHandle eighteen = ranges.Allocate(18);
+	CHECK(ranges.GetOffset(eighteen) == 45);
+
+	// an exact fit, and the first of the two
+	RangeHandle exact = ranges.Allocate(30);
+	CHECK(ranges.GetOffset(exact) == 10);
+
+	// 32 free in all, but no single range of 31
+	CHECK(ranges.GetFree() == 32);
+	CHECK(ranges.GetLargestFree() == 30);
+	CHECK(ranges.Allocate(31) == INVALID_RANGE);
+	CHECK(ranges.Allocate(0) == INVALID_RANGE);
+}
+
+TEST(RangeAllocatorMergesFreedRangesWithTheirNeighbours)
+{
+	RangeAllocator ranges(90);
+
+	RangeHandle first = ranges.Allocate(30);
+	RangeHandle second = ranges.Allocate(30);
+	RangeHandle third = ranges.Allocate(30);
+	CHECK(ranges.GetFreeRangeCount() == 0);
+
+	ranges.Free(first);
+	ranges.Free(third);
+	CHECK(ranges.GetFreeRangeCount() == 2);
+
+	// the middle joins both sides into one
+	ranges.Free(second);
+	CHECK(ranges.GetFreeRangeCount() == 1);
+	CHECK(ranges.GetLargestFree() == 90);
+	CHECK(ranges.GetUsed() == 0);
+
+	// freed space at the end joins up with what Grow adds
+	RangeHandle front = ranges.Allocate(60);
+	ranges.Grow(120);
+	CHECK(ranges.GetFreeRangeCount() == 1);
+	CHECK(ranges.GetLargestFree() == 60);
+
+	RangeHandle all = ranges.Allocate(60);
+	CHECK(ranges.GetOffset(front) == 0);
+	CHECK(ranges.GetOffset(all) == 60);
+}
+
+TEST(RangeAllocatorReusesFreedHandles)
+{
+	RangeAllocator ranges(100);
+
+	RangeHandle first = ranges.Allocate(10);
+	RangeHandle second = ranges.Allocate(10);
+	CHECK(first != second);
+
+	ranges.Free(first);
+
+	// the handle comes back, but for wherever the new range went
+	RangeHandle reused = ranges.Allocate(25);
+	CHECK(reused == first);
+	CHECK(ranges.GetOffset(reused) == 20);
+	CHECK(ranges.GetCount(reused) == 25);
+	CHECK(ranges.GetOffset(second) == 10);
+
+	// freeing twice, or freeing nothing, changes nothing
+	ranges.Free(second);
+	ranges.Free(second);
+	ranges.Free(INVALID_RANGE);
+	CHECK(ranges.GetUsed() == 25);
+
+	RangeHandle third = ranges.Allocate(5);
+	RangeHandle fourth = ranges.Allocate(5);
+	CHECK(third == second);
+	CHECK(fourth != first && fourth != second);
+}
+
+TEST(RangeAllocatorDefragmentPacksRangesInOrder)
+{
+	RangeAllocator ranges(100);
+
+	RangeHandle gone = ranges.Allocate(10);
+	RangeHandle first = ranges.Allocate(20);
+	RangeHandle alsoGone = ranges.Allocate(30);
+	RangeHandle second = ranges.Allocate(10);
+
+	ranges.Free(gone);
+	ranges.Free(alsoGone);
+	CHECK(ranges.GetFreeRangeCount() == 3 && ranges.GetLargestFree() == 30);
+
+	std::vector<RangeMove> moves;
+	ranges.Defragment(moves);
+
+	// every live range, in the order they sat in, slid to the front
+	CHECK(moves.size() == 2);
+	CHECK(moves[0].From == 10 && moves[0].To == 0 && moves[0].Count == 20);
+	CHECK(moves[1].From == 60 && moves[1].To == 20 && moves[1].Count == 10);
+
+	// handles still find their ranges
+	CHECK(ranges.GetOffset(first) == 0);
+	CHECK(ranges.GetOffset(second) == 20);
+
+	// all the free space is in one piece at the end
+	CHECK(ranges.GetFreeRangeCount() == 1);
+	CHECK(ranges.GetLargestFree() == 70);
+
+	RangeHandle big = ranges.Allocate(70);
+	CHECK(ranges.GetOffset(big) == 30);
+	CHECK(ranges.GetFree() == 0);
+
+	// with nothing free there's no free range left over
+	ranges.Defragment(moves);
+	CHECK(moves.size() == 3);
+	CHECK(ranges.GetFreeRangeCount() == 0);
+}
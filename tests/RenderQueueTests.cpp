@@ -0,0 +1,227 @@
+#include "Test.h"
+#include "../RenderQueue.h"
+#include "../Renderer.h"
+#include "../RecordingRenderContext.h"
+
+namespace
+{
+	// stands in for anything the queue and the context only compare the
+	// addresses of
+	template<typename T>
+	T* Fake(const void* address)
+	{
+		return (T*)address;
+	}
+
+	// binds the same things MeshRenderer does, and only when they change
+	// from the previous item in the run
+	class FakeRenderer : public Renderer
+	{
+	public:
+		bool Initialise() { return true; }
+
+		void BeginQueued(RenderContext& context)
+		{
+			context.SetVertexShader(Fake<ID3D11VertexShader>(&vertexShader_));
+			context.SetPixelShader(Fake<ID3D11PixelShader>(&pixelShader_));
+		}
+
+		void DrawQueued(RenderContext& context, const DrawItem& item, const DrawItem* previous)
+		{
+			if (previous == nullptr || previous->Surface != item.Surface) {
+				context.SetPSConstantBuffer(2, Fake<ID3D11Buffer>(item.Surface));
+			}
+
+			if (previous == nullptr || previous->Texture != item.Texture) {
+				context.SetPSResource(0, Fake<ID3D11ShaderResourceView>(item.Texture));
+			}
+
+			if (item.InstanceCount > 0)	context.DrawIndexedInstanced(item.IndexCount, item.InstanceCount, 0, 0, item.InstanceStart);
+			else						context.DrawIndexed(item.IndexCount, 0, 0);
+		}
+
+		// one sub-mesh per mesh, with the mesh standing in for it
+		void QueueInstances(RenderQueue& queue, const InstanceGroup& group)
+		{
+			DrawItem item = MakeItem(this, Fake<Material>(group.Model), group.Model, 30, 0.0f);
+			item.InstanceStart = group.Start;
+			item.InstanceCount = group.Count;
+			queue.Add(RenderPass::Opaque, item);
+		}
+
+		static DrawItem MakeItem(Renderer* owner, Material* surface, const void* texture, unsigned int indexCount, float depth)
+		{
+			DrawItem item = {};
+			item.Owner = owner;
+			item.Surface = surface;
+			item.Texture = texture;
+			item.IndexCount = indexCount;
+			XMStoreFloat4x4(&item.World, XMMatrixTranslation(0.0f, 0.0f, depth));
+			return item;
+		}
+
+	private:
+		char	vertexShader_;
+		char	pixelShader_;
+	};
+
+	struct QueuedItem {
+		RenderPass		Pass;
+		DrawItem		Item;
+	};
+
+	// what drawing straight from the scene graph did, one item after
+	// another in the order they came
+	void DrawInOrder(const std::vector<QueuedItem>& items, RenderContext& context)
+	{
+		Renderer* current = nullptr;
+		const DrawItem* previous = nullptr;
+
+		for (const QueuedItem& queued : items) {
+			const DrawItem& item = queued.Item;
+
+			if (item.Owner != current) {
+				if (current != nullptr) current->EndQueued(context);
+
+				current = item.Owner;
+				current->BeginQueued(context);
+				previous = nullptr;
+			}
+
+			current->DrawQueued(context, item, previous);
+			previous = &item;
+		}
+
+		if (current != nullptr) current->EndQueued(context);
+	}
+
+	// the draws a context was given, by index count
+	std::vector<unsigned int> GetDraws(const RecordingRenderContext& context)
+	{
+		std::vector<unsigned int> draws;
+
+		for (const RecordedCall& call : context.GetCalls()) {
+			if (call.Call == RenderCall::DrawIndexed) draws.push_back(call.Value);
+		}
+
+		return draws;
+	}
+}
+
+TEST(QueueSortsOpaqueItemsToCutStateChanges)
+{
+	FakeRenderer first;
+	FakeRenderer second;
+	char materials[3];
+	char textures[2];
+
+	Material* plain = Fake<Material>(&materials[0]);
+	Material* alsoPlain = Fake<Material>(&materials[1]);
+	Material* patterned = Fake<Material>(&materials[2]);
+
+	// the first two materials share a texture. items are interleaved the
+	// way a scene graph walk might leave them.
+	std::vector<QueuedItem> items = {
+		{ RenderPass::Opaque, FakeRenderer::MakeItem(&first, plain, &textures[0], 3, 10.0f) },
+		{ RenderPass::Opaque, FakeRenderer::MakeItem(&second, patterned, &textures[1], 6, 20.0f) },
+		{ RenderPass::Opaque, FakeRenderer::MakeItem(&first, alsoPlain, &textures[0], 9, 30.0f) },
+		{ RenderPass::Opaque, FakeRenderer::MakeItem(&second, patterned, &textures[1], 12, 40.0f) },
+		{ RenderPass::Opaque, FakeRenderer::MakeItem(&first, plain, &textures[0], 15, 50.0f) },
+		{ RenderPass::Opaque, FakeRenderer::MakeItem(&first, patterned, &textures[1], 18, 60.0f) },
+		{ RenderPass::Opaque, FakeRenderer::MakeItem(&second, alsoPlain, &textures[0], 21, 70.0f) },
+		{ RenderPass::Opaque, FakeRenderer::MakeItem(&first, alsoPlain, &textures[0], 24, 80.0f) },
+	};
+
+	// all but one item switches renderer, so binds shaders, a material
+	// and a texture. the one that doesn't still changes material and
+	// texture.
+	RecordingRenderContext unsorted;
+	DrawInOrder(items, unsorted);
+	CHECK(unsorted.GetCount(RenderCall::DrawIndexed) == 8);
+	CHECK(unsorted.GetStateChanges() == 30);
+
+	RenderQueue queue(1000.0f);
+	queue.Begin(XMMatrixIdentity());
+	for (const QueuedItem& queued : items) {
+		queue.Add(queued.Pass, queued.Item);
+	}
+
+	// each renderer's shaders once, and each of its materials once.
+	// materials sort by when they were first seen rather than by
+	// texture, so the first renderer's texture goes back and forth.
+	RecordingRenderContext sorted;
+	queue.Submit(sorted);
+	CHECK(sorted.GetCount(RenderCall::DrawIndexed) == 8);
+	CHECK(sorted.GetStateChanges() == 14);
+	CHECK(sorted.GetCount(RenderCall::InstanceData) == 1);
+
+	CHECK(queue.GetSubmittedCount() == 8);
+	CHECK(queue.GetRendererChanges() == 2);
+	CHECK(queue.GetMaterialChanges() == 5);
+	CHECK(queue.GetTextureChanges() == 5);
+	CHECK(queue.GetTriangleCount() == (3 + 6 + 9 + 12 + 15 + 18 + 21 + 24) / 3);
+
+	// within a material, nearest first
+	std::vector<unsigned int> draws = GetDraws(sorted);
+	std::vector<unsigned int> expected = { 3, 15, 18, 9, 24, 6, 12, 21 };
+	CHECK(draws == expected);
+
+	// the queue empties itself
+	RecordingRenderContext empty;
+	queue.Submit(empty);
+	CHECK(empty.GetCount(RenderCall::DrawIndexed) == 0);
+}
+
+TEST(QueueDrawsTransparentItemsLastAndFarthestFirst)
+{
+	FakeRenderer renderer;
+	char materials[2];
+	char texture;
+
+	RenderQueue queue(1000.0f);
+	queue.Begin(XMMatrixIdentity());
+	queue.Add(RenderPass::Transparent, FakeRenderer::MakeItem(&renderer, Fake<Material>(&materials[1]), &texture, 3, 10.0f));
+	queue.Add(RenderPass::Transparent, FakeRenderer::MakeItem(&renderer, Fake<Material>(&materials[1]), &texture, 6, 500.0f));
+	queue.Add(RenderPass::Opaque, FakeRenderer::MakeItem(&renderer, Fake<Material>(&materials[0]), &texture, 9, 900.0f));
+
+	// past the sort depth, everything sorts as if it were at it
+	queue.Add(RenderPass::Transparent, FakeRenderer::MakeItem(&renderer, Fake<Material>(&materials[1]), &texture, 12, 2000.0f));
+	queue.Add(RenderPass::Transparent, FakeRenderer::MakeItem(&renderer, Fake<Material>(&materials[1]), &texture, 15, 3000.0f));
+
+	RecordingRenderContext context;
+	queue.Submit(context);
+
+	std::vector<unsigned int> draws = GetDraws(context);
+	std::vector<unsigned int> expected = { 9, 12, 15, 6, 3 };
+	CHECK(draws == expected);
+}
+
+TEST(QueueDrawsEachMeshsInstancesTogether)
+{
+	FakeRenderer renderer;
+	char meshes[2];
+
+	RenderQueue queue(1000.0f);
+	queue.Begin(XMMatrixIdentity());
+
+	for (int i = 0; i < 5; i++) {
+		queue.AddInstance(&renderer, Fake<Mesh>(&meshes[0]), 0, XMMatrixTranslation((float)i, 0.0f, 0.0f));
+	}
+
+	// the same mesh at another level of detail is another group
+	queue.AddInstance(&renderer, Fake<Mesh>(&meshes[0]), 1, XMMatrixIdentity());
+	queue.AddInstance(&renderer, Fake<Mesh>(&meshes[1]), 0, XMMatrixIdentity());
+
+	RecordingRenderContext context;
+	queue.Submit(context);
+
+	CHECK(context.GetCount(RenderCall::DrawIndexedInstanced) == 3);
+	CHECK(context.GetCount(RenderCall::DrawIndexed) == 0);
+	CHECK(queue.GetInstanceCount() == 7);
+	CHECK(queue.GetInstanceGroupCount() == 3);
+	CHECK(queue.GetTriangleCount() == 7 * 10);
+
+	// all of the instance data goes up in one go
+	const std::vector<RecordedCall>& calls = context.GetCalls();
+	CHECK(calls.size() > 0 && calls[0].Call == RenderCall::InstanceData && calls[0].Value == 7);
+}
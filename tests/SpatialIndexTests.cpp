@@ -0,0 +1,113 @@
+#include "Test.h"
+#include "../SpatialIndex.h"
+#include <vector>
+
+namespace
+{
+	// the index only hands scene nodes back, it never looks inside them,
+	// so any distinct addresses will do
+	char nodes[4];
+
+	SceneNode* Node(int i)
+	{
+		return reinterpret_cast<SceneNode*>(&nodes[i]);
+	}
+
+	bool HasPair(const std::vector<SpatialPair>& pairs, SceneNode* a, SceneNode* b)
+	{
+		for (const SpatialPair& pair : pairs) {
+			if ((pair.First == a && pair.Second == b) || (pair.First == b && pair.Second == a)) return true;
+		}
+		return false;
+	}
+}
+
+TEST(SpatialIndexFindsEachOverlappingPairOnce)
+{
+	SpatialIndex index;
+
+	Collider a(2.0f, 1.0f, XMFLOAT3(0.0f, 0.0f, 0.0f), true);
+	Collider b(2.0f, 1.0f, XMFLOAT3(0.0f, 0.0f, 0.0f), false);
+	Collider far(2.0f, 1.0f, XMFLOAT3(0.0f, 0.0f, 0.0f), false);
+	a.SetWorldPosition(XMFLOAT3(0.0f, 0.0f, 0.0f));
+	b.SetWorldPosition(XMFLOAT3(1.5f, 0.0f, 0.0f));
+	far.SetWorldPosition(XMFLOAT3(50.0f, 0.0f, 0.0f));
+
+	a.SetProxy(index.Insert(Node(0), &a));
+	b.SetProxy(index.Insert(Node(1), &b));
+	far.SetProxy(index.Insert(Node(2), &far));
+
+	// and whatever was in there before is replaced
+	std::vector<SpatialPair> pairs(5);
+	index.FindPairs(pairs);
+
+	CHECK(pairs.size() == 1);
+	CHECK(HasPair(pairs, Node(0), Node(1)));
+	CHECK(pairs[0].FirstShape == (pairs[0].First == Node(0) ? &a : &b));
+
+	// removed colliders drop out
+	index.Remove(b.GetProxy());
+	index.FindPairs(pairs);
+	CHECK(pairs.empty());
+}
+
+TEST(SpatialIndexPairsFollowMovedColliders)
+{
+	SpatialIndex index;
+
+	// a palm a level down in its own graph: its collider only knows its
+	// world position, which its node pushes in every update
+	Collider palm(3.0f, 0.5f, XMFLOAT3(0.0f, 0.0f, 0.0f), false);
+	Collider player(2.0f, 0.5f, XMFLOAT3(0.0f, 0.0f, 0.0f), true);
+	palm.SetWorldPosition(XMFLOAT3(40.0f, 0.0f, 20.0f));
+	player.SetWorldPosition(XMFLOAT3(0.0f, 0.0f, 0.0f));
+
+	palm.SetProxy(index.Insert(Node(0), &palm));
+	player.SetProxy(index.Insert(Node(1), &player));
+
+	std::vector<SpatialPair> pairs;
+	index.FindPairs(pairs);
+	CHECK(pairs.empty());
+
+	// walk the player into the palm, the way a frame does: positions
+	// first, then the refit
+	player.SetWorldPosition(XMFLOAT3(40.5f, 0.0f, 20.0f));
+	CHECK(player.HasMoved());
+	index.Refit();
+	CHECK(!player.HasMoved());
+
+	index.FindPairs(pairs);
+	CHECK(pairs.size() == 1 && HasPair(pairs, Node(0), Node(1)));
+
+	// what Step does with a candidate
+	CollisionInfo info;
+	CHECK(pairs[0].FirstShape->IsIntersecting(*pairs[0].SecondShape, info));
+
+	// and back out again
+	player.SetWorldPosition(XMFLOAT3(0.0f, 0.0f, 0.0f));
+	index.Refit();
+	index.FindPairs(pairs);
+	CHECK(pairs.empty());
+}
+
+TEST(SpatialIndexPairsCloseCollidersThatDontTouch)
+{
+	SpatialIndex index;
+
+	// the fat bounds overlap, so the pair is a candidate, but the
+	// narrow phase has the final say
+	Collider a(2.0f, 0.5f, XMFLOAT3(0.0f, 0.0f, 0.0f), true);
+	Collider b(2.0f, 0.5f, XMFLOAT3(0.0f, 0.0f, 0.0f), true);
+	a.SetWorldPosition(XMFLOAT3(0.0f, 0.0f, 0.0f));
+	b.SetWorldPosition(XMFLOAT3(2.0f, 0.0f, 0.0f));
+
+	index.Insert(Node(0), &a);
+	index.Insert(Node(1), &b);
+
+	std::vector<SpatialPair> pairs;
+	index.FindPairs(pairs);
+
+	CollisionInfo info;
+	CHECK(pairs.size() == 1);
+	CHECK(!a.IsIntersecting(b, info));
+}
@@ -0,0 +1,148 @@
+#include "Test.h"
+#include "../StateCache.h"
+#include "../RecordingRenderContext.h"
+
+namespace
+{
+	// the cache only ever compares these, so any distinct addresses will do
+	char shaders[2];
+	char buffers[2];
+	char views[2];
+
+	ID3D11VertexShader* VertexShader(int i)	{ return (ID3D11VertexShader*)&shaders[i]; }
+	ID3D11Buffer* Buffer(int i)				{ return (ID3D11Buffer*)&buffers[i]; }
+	ID3D11ShaderResourceView* View(int i)	{ return (ID3D11ShaderResourceView*)&views[i]; }
+
+	struct CachedContext {
+		std::shared_ptr<RecordingRenderContext>	Recorder = std::make_shared<RecordingRenderContext>();
+		StateCache								Cache { Recorder };
+	};
+}
+
+TEST(StateCacheSkipsRedundantBinds)
+{
+	CachedContext context;
+
+	context.Cache.SetVertexShader(VertexShader(0));
+	context.Cache.SetVertexShader(VertexShader(0));
+	context.Cache.SetVertexShader(VertexShader(1));
+	context.Cache.SetVertexShader(VertexShader(1));
+
+	context.Cache.SetVertexBuffer(Buffer(0), 32);
+	context.Cache.SetVertexBuffer(Buffer(0), 32);
+
+	// the same buffer with another stride is a different binding
+	context.Cache.SetVertexBuffer(Buffer(0), 16);
+
+	context.Cache.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+	context.Cache.SetPrimitiveTopology(PrimitiveTopology::TriangleList);
+
+	CHECK(context.Recorder->GetCount(RenderCall::VertexShader) == 2);
+	CHECK(context.Recorder->GetCount(RenderCall::VertexBuffer) == 2);
+	CHECK(context.Recorder->GetCount(RenderCall::PrimitiveTopology) == 1);
+	CHECK(context.Cache.GetIssued() == 5);
+	CHECK(context.Cache.GetSkipped() == 4);
+
+	// uploads and draws always go through
+	char constants[64] = {};
+	context.Cache.UpdateBuffer(Buffer(0), constants, sizeof(constants));
+	context.Cache.UpdateBuffer(Buffer(0), constants, sizeof(constants));
+	context.Cache.DrawIndexed(3, 0, 0);
+	context.Cache.DrawIndexed(3, 0, 0);
+
+	CHECK(context.Recorder->GetCount(RenderCall::UpdateBuffer) == 2);
+	CHECK(context.Recorder->GetCount(RenderCall::DrawIndexed) == 2);
+	CHECK(context.Cache.GetUploadedBytes() == 2 * sizeof(constants));
+
+	context.Cache.ResetCounters();
+	CHECK(context.Cache.GetIssued() == 0 && context.Cache.GetSkipped() == 0);
+	CHECK(context.Cache.GetUploadedBytes() == 0);
+}
+
+TEST(StateCachePassesTheFirstCallAfterInvalidate)
+{
+	CachedContext context;
+
+	// nothing is known to start with, so even binding null goes through
+	context.Cache.SetPixelShader(nullptr);
+	context.Cache.SetPSResource(0, nullptr);
+	CHECK(context.Recorder->GetCount(RenderCall::PixelShader) == 1);
+	CHECK(context.Recorder->GetCount(RenderCall::PSResource) == 1);
+
+	context.Cache.SetVertexShader(VertexShader(0));
+	context.Cache.SetPSResource(0, View(0));
+	context.Cache.Invalidate();
+
+	// the device may have been changed behind our back since
+	context.Cache.SetVertexShader(VertexShader(0));
+	context.Cache.SetPSResource(0, View(0));
+	context.Cache.SetPixelShader(nullptr);
+	CHECK(context.Recorder->GetCount(RenderCall::VertexShader) == 2);
+	CHECK(context.Recorder->GetCount(RenderCall::PSResource) == 3);
+	CHECK(context.Recorder->GetCount(RenderCall::PixelShader) == 2);
+
+	// and after that it's known again
+	context.Cache.SetVertexShader(VertexShader(0));
+	context.Cache.SetPSResource(0, View(0));
+	CHECK(context.Recorder->GetCount(RenderCall::VertexShader) == 2);
+	CHECK(context.Recorder->GetCount(RenderCall::PSResource) == 3);
+}
+
+TEST(StateCacheNeverFiltersSlotsPastItsLimit)
+{
+	CachedContext context;
+
+	const unsigned int lastCached = STATE_CACHE_SLOTS - 1;
+
+	for (int i = 0; i < 3; i++) {
+		context.Cache.SetPSConstantBuffer(lastCached, Buffer(0));
+		context.Cache.SetPSConstantBuffer(STATE_CACHE_SLOTS, Buffer(0));
+		context.Cache.SetPSResource(STATE_CACHE_SLOTS + 5, View(1));
+		context.Cache.SetVSConstantBuffer(STATE_CACHE_SLOTS, Buffer(1));
+	}
+
+	// the last cached slot is bound once, and the ones past it every time,
+	// but to the slot they were asked for
+	CHECK(context.Recorder->GetCount(RenderCall::PSConstantBuffer) == 1 + 3);
+	CHECK(context.Recorder->GetCount(RenderCall::PSResource) == 3);
+	CHECK(context.Recorder->GetCount(RenderCall::VSConstantBuffer) == 3);
+	CHECK(context.Cache.GetIssued() == 1 + 3 * 3);
+	CHECK(context.Cache.GetSkipped() == 2);
+
+	bool slotsKept = true;
+	for (const RecordedCall& call : context.Recorder->GetCalls()) {
+		if (call.Call == RenderCall::PSResource) slotsKept &= (call.Value == STATE_CACHE_SLOTS + 5);
+		if (call.Call == RenderCall::VSConstantBuffer) slotsKept &= (call.Value == STATE_CACHE_SLOTS);
+	}
+	CHECK(slotsKept);
+}
+
+TEST(StateCacheTellsConstantRangesFromWholeBuffers)
+{
+	CachedContext context;
+
+	ConstantRange first = { Buffer(0), 0, 4 };
+	ConstantRange second = { Buffer(0), 16, 4 };
+
+	// a range starting at the front of a buffer isn't the whole buffer
+	context.Cache.SetVSConstantBuffer(1, Buffer(0));
+	context.Cache.SetVSConstantRange(1, first);
+	CHECK(context.Recorder->GetCount(RenderCall::VSConstantBuffer) == 1);
+	CHECK(context.Recorder->GetCount(RenderCall::VSConstantRange) == 1);
+
+	// the same range again is skipped, another part of the buffer isn't
+	context.Cache.SetVSConstantRange(1, first);
+	context.Cache.SetVSConstantRange(1, second);
+	CHECK(context.Recorder->GetCount(RenderCall::VSConstantRange) == 2);
+
+	// and going back to the whole buffer is a change too
+	context.Cache.SetVSConstantBuffer(1, Buffer(0));
+	context.Cache.SetVSConstantBuffer(1, Buffer(0));
+	CHECK(context.Recorder->GetCount(RenderCall::VSConstantBuffer) == 2);
+
+	// each slot is tracked on its own
+	context.Cache.SetVSConstantRange(2, second);
+	CHECK(context.Recorder->GetCount(RenderCall::VSConstantRange) == 3);
+
+	CHECK(context.Cache.GetSkipped() == 2);
+}
@@ -0,0 +1,30 @@
+#pragma once
+#include <vector>
+
+// A minimal test runner for the parts of the engine that don't need a
+// device or a window. Tests register themselves with TEST, and CHECK
+// records a failure without stopping the test, so one run shows every
+// check that's wrong.
+
+typedef void (*TestFunction)();
+
+struct TestEntry {
+	const char*		Name;
+	TestFunction	Function;
+};
+
+std::vector<TestEntry>&	GetTests();
+
+struct TestRegistrar {
+	TestRegistrar(const char* name, TestFunction function) { GetTests().push_back({ name, function }); }
+};
+
+#define TEST(name) \
+	static void name(); \
+	static TestRegistrar name##Registrar(#name, name); \
+	static void name()
+
+void					ReportFailure(const char* file, int line, const char* expression);
+
+#define CHECK(expression) \
+	do { if (!(expression)) ReportFailure(__FILE__, __LINE__, #expression); } while (false)
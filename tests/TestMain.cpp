@@ -0,0 +1,42 @@
+#include "Test.h"
+#include <cstring>
+#include <iostream>
+
+static int failures_ = 0;
+
+std::vector<TestEntry>& GetTests()
+{
+	static std::vector<TestEntry> tests;
+	return tests;
+}
+
+void ReportFailure(const char* file, int line, const char* expression)
+{
+	std::cout << "  " << file << "(" << line << "): CHECK(" << expression << ") failed" << std::endl;
+	failures_++;
+}
+
+// runs every test, or just those whose names start with the first argument
+int main(int argc, char** argv)
+{
+	const char* filter = (argc > 1) ? argv[1] : "";
+	int run = 0;
+	int failed = 0;
+
+	for (const TestEntry& test : GetTests()) {
+		if (strncmp(test.Name, filter, strlen(filter)) != 0) continue;
+
+		int before = failures_;
+		test.Function();
+		run++;
+
+		if (failures_ != before) {
+			std::cout << test.Name << " FAILED" << std::endl;
+			failed++;
+		}
+	}
+
+	std::cout << (run - failed) << "/" << run << " tests passed" << std::endl;
+
+	return (failed == 0 && run > 0) ? 0 : 1;
+}
@@ -0,0 +1,115 @@
+#include "Test.h"
+#include "../UploadRing.h"
+
+TEST(UploadRingWrapsToTheFrontPastRetiredFrames)
+{
+	UploadRing ring(1000);
+
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(400, 1) == 0);
+	ring.EndFrame();
+
+	ring.BeginFrame(2);
+	CHECK(ring.Allocate(400, 1) == 400);
+	ring.EndFrame();
+
+	ring.Retire(1);
+	CHECK(ring.GetUsed() == 400);
+
+	// too big for what's left at the end, so it goes at the front, and
+	// the 200 bytes skipped count as used until the frame retires
+	ring.BeginFrame(3);
+	CHECK(ring.Allocate(300, 1) == 0);
+	CHECK(ring.GetUsed() == 400 + 200 + 300);
+	CHECK(ring.GetFrameBytes() == 500);
+
+	// right up to frame 2, and then not a byte more
+	CHECK(ring.Allocate(100, 1) == 300);
+	CHECK(ring.GetUsed() == 1000);
+	CHECK(ring.Allocate(1, 1) == UPLOAD_RING_FULL);
+
+	ring.Retire(2);
+	CHECK(ring.Allocate(100, 1) == 400);
+	ring.EndFrame();
+
+	// once it's all back the next frame starts at the front again
+	ring.Retire(3);
+	CHECK(!ring.HasPending());
+	CHECK(ring.GetUsed() == 0);
+
+	ring.BeginFrame(4);
+	CHECK(ring.Allocate(10, 1) == 0);
+}
+
+TEST(UploadRingOverflowsWhenOneFrameFillsIt)
+{
+	UploadRing ring(256);
+
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(200, 1) == 0);
+
+	// nothing in flight to wait for, so no amount of retiring helps
+	CHECK(ring.Allocate(100, 1) == UPLOAD_RING_FULL);
+	CHECK(ring.Allocate(1000, 1) == UPLOAD_RING_FULL);
+	CHECK(!ring.HasPending());
+	CHECK(ring.GetStats().Overflows == 2);
+	CHECK(ring.GetStats().Stalls == 0);
+
+	// what did fit is still there
+	CHECK(ring.Allocate(56, 1) == 200);
+	ring.EndFrame();
+
+	// the counts are per frame
+	ring.BeginFrame(2);
+	CHECK(ring.GetStats().Overflows == 0);
+}
+
+TEST(UploadRingStallsUntilTheOldestFrameRetires)
+{
+	UploadRing ring(1000);
+
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(600, 1) == 0);
+	ring.EndFrame();
+
+	// frame 1 is in the way at both ends
+	ring.BeginFrame(2);
+	CHECK(ring.Allocate(600, 1) == UPLOAD_RING_FULL);
+	CHECK(ring.GetStats().Stalls == 1);
+	CHECK(ring.GetStats().Overflows == 0);
+
+	// what the owner does: wait for the oldest frame, retire it, retry
+	CHECK(ring.HasPending() && ring.GetOldestPending() == 1);
+	ring.Retire(ring.GetOldestPending());
+	CHECK(ring.Allocate(600, 1) == 0);
+	ring.EndFrame();
+
+	CHECK(ring.GetStats().Stalls == 1);
+	CHECK(ring.GetOldestPending() == 2);
+}
+
+TEST(UploadRingRemembersItsHighWaterMark)
+{
+	UploadRing ring(1024);
+
+	// the padding to align the second allocation counts as used
+	ring.BeginFrame(1);
+	CHECK(ring.Allocate(10, 1) == 0);
+	CHECK(ring.Allocate(16, 16) == 16);
+	ring.EndFrame();
+	CHECK(ring.GetStats().HighWater == 32);
+
+	ring.BeginFrame(2);
+	ring.Allocate(500, 1);
+	ring.EndFrame();
+	CHECK(ring.GetStats().HighWater == 532);
+
+	// retiring and smaller frames afterwards don't bring it down
+	ring.Retire(2);
+	ring.BeginFrame(3);
+	ring.Allocate(100, 1);
+	ring.EndFrame();
+	CHECK(ring.GetUsed() == 100);
+	CHECK(ring.GetStats().HighWater == 532);
+	CHECK(ring.GetStats().Capacity == 1024);
+}